@@ -0,0 +1,12 @@
+﻿/*
+ * Compiled part of LeptJSON for the leptjson library target: the parse and stringify core, the
+ * free functions and the container instantiations the header declares extern.
+ */
+#define LEPTJSON_IMPLEMENTATION
+#include "LeptJSON.hpp"
+
+#ifndef LEPTJSON_HEADER_ONLY
+template class LEPTJSON_TEMPLATE_API LeptJSON::SmallVector<LeptJSON::JsonValue, LEPTJSON_SMALL_CAPACITY>;
+template class LEPTJSON_TEMPLATE_API LeptJSON::SmallMap<LeptJSON::JsonValue, LEPTJSON_SMALL_CAPACITY>;
+template class LEPTJSON_TEMPLATE_API LeptJSON::SmallVector<double, LEPTJSON_SMALL_CAPACITY>;
+#endif
@@ -4,17 +4,111 @@
 
 #include <cassert>
 #include <cctype>
+#include <cstdint>
+#include <cstring>
 #include <utility>
 #include <variant>
 #include <cmath>
 #include <memory>
 #include <vector>
+#include <span>
+#include <stdexcept>
 #include <map>
+#include <set>
+#include <bitset>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <optional>
 #include <string>
 #include <charconv>
 #include <array>
+#include <algorithm>
+#include <bit>
+#include <limits>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#ifdef LEPTJSON_ENABLE_STATS
+#include <chrono>
+#endif
+#ifdef LEPTJSON_WITH_ZLIB
+#include <zlib.h>
+#endif
+#ifdef LEPTJSON_WITH_ZSTD
+#include <cstdio>
+#include <zstd.h>
+#endif
+#ifndef _WIN32
+struct iovec;		/* from <sys/uio.h>, which only the implementation below includes */
+#endif
 
-struct LeptJSON {
+/*
+ * Build modes. On its own the header is self-contained and everything in it is inline. The
+ * leptjson library target defines LEPTJSON_COMPILED_LIB instead, and the parse and stringify
+ * core below LEPTJSON_IMPLEMENTATION is then compiled once, in LeptJSON.cpp. LEPTJSON_API marks
+ * what a shared build exports.
+ */
+#if !defined(LEPTJSON_COMPILED_LIB) && !defined(LEPTJSON_HEADER_ONLY)
+#define LEPTJSON_HEADER_ONLY
+#endif
+#ifdef LEPTJSON_HEADER_ONLY
+#define LEPTJSON_INLINE inline
+#else
+#define LEPTJSON_INLINE
+#endif
+#if !defined(LEPTJSON_SHARED) || defined(LEPTJSON_HEADER_ONLY)
+#define LEPTJSON_API
+#define LEPTJSON_TEMPLATE_API
+#elif defined(_WIN32)
+#ifdef LEPTJSON_EXPORTS
+#define LEPTJSON_API __declspec(dllexport)
+#else
+#define LEPTJSON_API __declspec(dllimport)
+#endif
+#define LEPTJSON_TEMPLATE_API LEPTJSON_API		/* nested class templates are not exported with their enclosing class */
+#else
+#define LEPTJSON_API __attribute__((visibility("default")))
+#define LEPTJSON_TEMPLATE_API					/* instantiations take the visibility of LeptJSON */
+#endif
+
+/* elements an array or object keeps inline before its storage moves to the heap */
+#ifndef LEPTJSON_SMALL_CAPACITY
+#define LEPTJSON_SMALL_CAPACITY 4
+#endif
+
+/* instrumentation is compiled in only with LEPTJSON_ENABLE_STATS */
+#ifdef LEPTJSON_ENABLE_STATS
+#define LEPTJSON_STAT(...) __VA_ARGS__
+#else
+#define LEPTJSON_STAT(...)
+#endif
+
+/*
+ * LEPTJSON_DESCRIBE(Type, member...) binds the listed members of Type to JSON keys of the
+ * same name for LeptJSON::parse_into() and LeptJSON::stringify_from(). Use it at namespace
+ * scope in the namespace of Type, up to 64 members.
+ */
+#define LEPTJSON_PARENS ()
+#define LEPTJSON_EXPAND(...) LEPTJSON_EXPAND3(LEPTJSON_EXPAND3(LEPTJSON_EXPAND3(LEPTJSON_EXPAND3(__VA_ARGS__))))
+#define LEPTJSON_EXPAND3(...) LEPTJSON_EXPAND2(LEPTJSON_EXPAND2(LEPTJSON_EXPAND2(LEPTJSON_EXPAND2(__VA_ARGS__))))
+#define LEPTJSON_EXPAND2(...) LEPTJSON_EXPAND1(LEPTJSON_EXPAND1(LEPTJSON_EXPAND1(LEPTJSON_EXPAND1(__VA_ARGS__))))
+#define LEPTJSON_EXPAND1(...) __VA_ARGS__
+#define LEPTJSON_FOR_EACH(macro, type, ...) __VA_OPT__(LEPTJSON_EXPAND(LEPTJSON_FOR_EACH_STEP(macro, type, __VA_ARGS__)))
+#define LEPTJSON_FOR_EACH_STEP(macro, type, first, ...) \
+	macro(type, first) __VA_OPT__(, LEPTJSON_FOR_EACH_AGAIN LEPTJSON_PARENS (macro, type, __VA_ARGS__))
+#define LEPTJSON_FOR_EACH_AGAIN() LEPTJSON_FOR_EACH_STEP
+#define LEPTJSON_FIELD(type, member) LeptJSON::Field(#member, &type::member)
+#define LEPTJSON_DESCRIBE(Type, ...) \
+	[[maybe_unused]] constexpr auto leptjson_describe(const Type*) { \
+		return std::make_tuple(LEPTJSON_FOR_EACH(LEPTJSON_FIELD, Type, __VA_ARGS__)); \
+	}
+
+struct LEPTJSON_API LeptJSON {
 
 	enum class ValueType {
 		NULL_TYPE, FALSE_TYPE, TRUE_TYPE, NUMBER_TYPE, STRING_TYPE, ARRAY_TYPE, OBJECT_TYPE
@@ -34,635 +128,5873 @@ struct LeptJSON {
 		PARSE_MISS_COMMA_OR_SQUARE_BRACKET,
 		PARSE_MISS_KEY,
 		PARSE_MISS_COLON,
-		PARSE_MISS_COMMA_OR_CURLY_BRACKET
+		PARSE_MISS_COMMA_OR_CURLY_BRACKET,
+		PARSE_INVALID_UTF8,
+		PARSE_INVALID_BINARY,
+		PARSE_INVALID_TAPE,
+		PARSE_TYPE_MISMATCH,
+		PARSE_MISSING_FIELD,
+		PATCH_INVALID_OPERATION,
+		PATCH_PATH_NOT_FOUND,
+		PATCH_TEST_FAILED,
+		PATH_INVALID_EXPRESSION,
+		SCHEMA_INVALID,
+		PARSE_SCHEMA_VIOLATION,
+		PARSE_DEPTH_EXCEEDED,
+		PARSE_INVALID_COMPRESSED
 	};
 
-private:
+	enum class ParseFlag : unsigned {
+		PARSE_DEFAULT = 0,
+		PARSE_STRICT_UTF8 = 1u << 0,	/* reject ill-formed UTF-8 and lone surrogates in strings */
+		PARSE_PARALLEL = 1u << 1,		/* split a large top-level array across the thread pool */
+		PARSE_LAZY_NUMBERS = 1u << 2	/* keep number text, convert on first read and stringify it verbatim */
+	};
 
-	struct JsonValue;
+	friend constexpr ParseFlag operator|(ParseFlag lhs, ParseFlag rhs) {
+		return static_cast<ParseFlag>(static_cast<unsigned>(lhs) | static_cast<unsigned>(rhs));
+	}
 
-	using json_array_type = std::vector<JsonValue>;
-	using json_object_type = std::map<std::string, JsonValue>;
-	using jsonValueType = std::variant<std::nullptr_t, double, std::string, bool, json_array_type, json_object_type>;
+	friend constexpr ParseFlag operator&(ParseFlag lhs, ParseFlag rhs) {
+		return static_cast<ParseFlag>(static_cast<unsigned>(lhs) & static_cast<unsigned>(rhs));
+	}
 
-	struct JsonValue {
-		jsonValueType value;
-		ValueType type;
+	enum class StringifyFlag : unsigned {
+		STRINGIFY_DEFAULT = 0,
+		STRINGIFY_PARALLEL = 1u << 0	/* serialize large sibling subtrees on the thread pool */
+	};
 
-		JsonValue(jsonValueType v, ValueType t) : value(std::move(v)), type(t) {}
+	friend constexpr StringifyFlag operator|(StringifyFlag lhs, StringifyFlag rhs) {
+		return static_cast<StringifyFlag>(static_cast<unsigned>(lhs) | static_cast<unsigned>(rhs));
+	}
 
-		JsonValue() = default;
+	friend constexpr StringifyFlag operator&(StringifyFlag lhs, StringifyFlag rhs) {
+		return static_cast<StringifyFlag>(static_cast<unsigned>(lhs) & static_cast<unsigned>(rhs));
+	}
 
-		JsonValue(const JsonValue& rhs) = default;
+	static constexpr std::uint64_t fnv1a(std::string_view s) {
+		std::uint64_t h = 0xcbf29ce484222325;
+		for (char c : s) {
+			h = (h ^ static_cast<unsigned char>(c)) * 0x100000001b3;
+		}
+		return h;
+	}
 
-		JsonValue(JsonValue&& rhs) noexcept : value(std::move(rhs.value)), type(rhs.type) {
-			rhs.value = nullptr;
-			rhs.type = ValueType::NULL_TYPE;
+	/* one member bound by LEPTJSON_DESCRIBE, the key hash is fixed at compile time */
+	template <typename Class, typename Member>
+	struct Field {
+		std::string_view name;
+		std::uint64_t hash;
+		Member Class::* member;
+
+		constexpr Field(std::string_view name, Member Class::* member) : name(name), hash(fnv1a(name)), member(member) {}
+	};
+
+	/* string literal as a template argument, for embed() */
+	template <std::size_t N>
+	struct FixedString {
+		char text[N]{};
+
+		constexpr FixedString(const char(&s)[N]) {
+			std::copy_n(s, N, text);
 		}
 
-		JsonValue& operator=(const JsonValue& rhs) {
-			if (this != &rhs) {
-				value = rhs.value;
-				type = rhs.type;
+		[[nodiscard]] constexpr std::string_view view() const { return { text, N - 1 }; }
+	};
+
+#ifdef LEPTJSON_ENABLE_STATS
+	/* cost of the last parse() or stringify() call */
+	struct Stats {
+		std::size_t bytes;								/* input consumed or output produced */
+		std::array<std::size_t, 7> nodes;				/* indexed by ValueType */
+		std::size_t allocations;						/* heap acquisitions seen as capacity growth */
+		std::size_t allocated_bytes;
+		std::size_t max_depth;
+		std::chrono::nanoseconds string_time;
+		std::chrono::nanoseconds number_time;
+		std::chrono::nanoseconds container_time;		/* everything that is not a string or number */
+	};
+#endif
+
+	class TapeArray;
+	class TapeObject;
+	class Reader;
+
+	/*
+	 * Read-only view of a tape produced by to_tape(). Every node is two little-endian words:
+	 * tag << 56 | payload, then a second word. Numbers keep their bits in the second word,
+	 * strings hold a blob offset and a length, containers hold the index just past their
+	 * last descendant and the element count, object members are a string node then the value.
+	 */
+	class TapeView {
+	public:
+		static constexpr char magic[8] = { 'L', 'E', 'P', 'T', 'T', 'A', 'P', 'E' };
+		static constexpr std::uint64_t version = 1;
+		static constexpr std::size_t header_words = 4;	/* magic, version, node words, string bytes */
+
+		constexpr TapeView() = default;
+
+		constexpr TapeView(const std::uint64_t* words, const char* strings, std::size_t index = 0)
+			: words(words), strings(strings), index(index) {}
+
+		/* checks the header and every node, so a truncated or corrupted file is rejected rather than read out of bounds */
+		static Status load(std::string_view bytes, TapeView& view) {
+			if (bytes.size() < header_words * 8 || !bytes.starts_with(std::string_view(magic, 8)) ||
+				reinterpret_cast<std::uintptr_t>(bytes.data()) % alignof(std::uint64_t) != 0) {
+				return Status::PARSE_INVALID_TAPE;
 			}
-			return *this;
+			const auto* header = reinterpret_cast<const std::uint64_t*>(bytes.data());
+			const auto count = little_endian(header[2]), string_bytes = little_endian(header[3]);
+			const auto body = bytes.size() - header_words * 8;
+			if (little_endian(header[1]) != version || count < 2 || count > body / 8 || body - count * 8 != string_bytes) {
+				return Status::PARSE_INVALID_TAPE;
+			}
+			view = TapeView(header + header_words, bytes.data() + header_words * 8 + count * 8);
+			return view.valid(static_cast<std::size_t>(count), static_cast<std::size_t>(string_bytes)) ? Status::PARSE_OK : Status::PARSE_INVALID_TAPE;
 		}
 
-		JsonValue& operator=(JsonValue&& rhs) noexcept {
-			if (this != &rhs) {
-				value = std::move(rhs.value);
-				type = rhs.type;
-				rhs.value = nullptr;
-				rhs.type = ValueType::NULL_TYPE;
+		[[nodiscard]] constexpr ValueType get_type() const {
+			const auto tag = word(0) >> 56;
+			return tag == number_text_tag ? ValueType::NUMBER_TYPE : static_cast<ValueType>(tag);
+		}
+
+		[[nodiscard]] constexpr bool get_boolean() const {
+			assert(get_type() == ValueType::TRUE_TYPE || get_type() == ValueType::FALSE_TYPE);
+			return get_type() == ValueType::TRUE_TYPE;
+		}
+
+		[[nodiscard]] constexpr double get_number() const {
+			assert(get_type() == ValueType::NUMBER_TYPE);
+			if (word(0) >> 56 == number_text_tag) {
+				return std::strtod(strings + payload(), nullptr);
 			}
-			return *this;
+			return std::bit_cast<double>(word(1));
 		}
-	} jsonValue;
 
-	std::string_view json;
+		[[nodiscard]] constexpr std::string_view get_string() const {
+			assert(get_type() == ValueType::STRING_TYPE);
+			return { strings + payload(), static_cast<std::size_t>(word(1)) };
+		}
 
-public:
-	LeptJSON(std::string_view js = "", ValueType vt = ValueType::NULL_TYPE)
-		: jsonValue({}, vt), json(js) {}
+		[[nodiscard]] constexpr TapeArray get_array() const;
 
-	LeptJSON(const LeptJSON& rhs) = default;
+		[[nodiscard]] constexpr TapeObject get_object() const;
 
-	LeptJSON(LeptJSON&& rhs) noexcept : jsonValue(std::move(rhs.jsonValue)), json(rhs.json) {}
+		/* linear scan of the members, the last of equal keys wins as in from_tape() and parse() */
+		[[nodiscard]] constexpr std::optional<TapeView> find(std::string_view key) const;
 
-	LeptJSON& operator=(const LeptJSON& rhs) {
-		if (this != &rhs) {
-			jsonValue = rhs.jsonValue;
-			json = rhs.json;
+	private:
+		friend LeptJSON;
+		friend TapeArray;
+		friend TapeObject;
+
+		/* number kept as NUL-terminated text in the blob, for embed() and lazy numbers */
+		static constexpr std::uint64_t number_text_tag = 7;
+
+		static constexpr std::uint64_t little_endian(std::uint64_t w) {
+			if constexpr (std::endian::native == std::endian::little) {
+				return w;
+			}
+			else {
+				std::uint64_t r = 0;
+				for (int i = 0; i < 8; i++, w >>= 8) r = r << 8 | (w & 0xff);
+				return r;
+			}
 		}
-		return *this;
-	}
 
-	LeptJSON& operator=(LeptJSON&& rhs) noexcept {
-		if (this != &rhs) {
-			jsonValue = std::move(rhs.jsonValue);
-			json = rhs.json;
+		[[nodiscard]] constexpr std::uint64_t word(std::size_t i) const {
+			return little_endian(words[index + i]);
 		}
-		return *this;
-	}
 
-	[[nodiscard]] ValueType get_type() const {
-		return jsonValue.type;
-	}
+		[[nodiscard]] constexpr std::size_t payload() const {
+			return static_cast<std::size_t>(word(0) & 0x00ffffffffffffff);
+		}
 
-	[[nodiscard]] JsonValue get_value() const {
-		return jsonValue;
-	}
+		/* index of the following sibling */
+		[[nodiscard]] constexpr std::size_t next() const {
+			const auto type = get_type();
+			return type == ValueType::ARRAY_TYPE || type == ValueType::OBJECT_TYPE ? payload() : index + 2;
+		}
 
-	void set_json(const char* js) {
-		json = js;
-	}
+		[[nodiscard]] constexpr TapeView at(std::size_t i) const {
+			return { words, strings, i };
+		}
 
-	void set_nullptr() {
-		jsonValue = { nullptr, ValueType::NULL_TYPE };
-	}
+		/*
+		 * One pass over the count node words from this root: known tags, blob ranges in bounds with
+		 * number texts NUL-terminated, container extents nested inside their parent and holding as
+		 * many elements or members as they claim, and object keys that are strings.
+		 */
+		[[nodiscard]] bool valid(std::size_t count, std::size_t string_bytes) const {
+			struct Open {
+				std::size_t end;
+				std::uint64_t left;		/* elements, or members still to start */
+				bool object;
+				bool value;				/* a key was read and its value comes next */
+			};
+			std::vector<Open> open{ { count, 1, false, false } };
+			for (std::size_t i = 0; ; i += 2) {
+				while (i == open.back().end) {
+					if (open.back().left != 0 || open.back().value) return false;
+					open.pop_back();
+					if (open.empty()) return true;
+				}
+				auto& parent = open.back();
+				if (i + 2 > parent.end) return false;
+				const auto node = at(i);
+				const auto tag = node.word(0) >> 56;
+				if (tag > number_text_tag) return false;
+				if (parent.object && !parent.value) {
+					if (tag != static_cast<std::uint64_t>(ValueType::STRING_TYPE) || parent.left-- == 0) return false;
+					parent.value = true;
+				}
+				else if (parent.object) {
+					parent.value = false;
+				}
+				else if (parent.left-- == 0) {
+					return false;
+				}
+				const auto type = static_cast<ValueType>(tag);
+				if (tag == number_text_tag || type == ValueType::STRING_TYPE) {
+					const auto offset = node.payload();
+					const auto length = node.word(1);
+					if (offset > string_bytes || length > string_bytes - offset) return false;
+					if (tag == number_text_tag && (length == string_bytes - offset || strings[offset + length] != '\0')) return false;
+				}
+				else if (type == ValueType::ARRAY_TYPE || type == ValueType::OBJECT_TYPE) {
+					const auto end = node.payload();
+					if (end < i + 2 || end > parent.end || end % 2 != 0) return false;
+					open.push_back({ end, node.word(1), type == ValueType::OBJECT_TYPE, false });
+				}
+			}
+		}
 
-	[[nodiscard]] bool get_boolean() const {
-		assert(jsonValue.type == ValueType::TRUE_TYPE || jsonValue.type == ValueType::FALSE_TYPE);
-		return std::get<bool>(jsonValue.value);
-	}
+		const std::uint64_t* words = nullptr;
+		const char* strings = nullptr;
+		std::size_t index = 0;
+	};
 
-	void set_boolean(bool b) {
-		jsonValue = { b, b ? ValueType::TRUE_TYPE : ValueType::FALSE_TYPE };
-	}
+	class TapeArray {
+	public:
+		class iterator {
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = TapeView;
+			using difference_type = std::ptrdiff_t;
+			using pointer = void;
+			using reference = TapeView;
 
-	[[nodiscard]] double get_number() const {
-		assert(jsonValue.type == ValueType::NUMBER_TYPE);
-		return std::get<double>(jsonValue.value);
-	}
+			constexpr iterator() = default;
 
-	void set_number(double number) {
-		jsonValue = { number, ValueType::NUMBER_TYPE };
-	}
+			constexpr explicit iterator(TapeView node) : node(node) {}
 
-	[[nodiscard]] std::string_view get_string() const {
-		assert(jsonValue.type == ValueType::STRING_TYPE);
-		return std::string_view{ std::get<std::string>(jsonValue.value).data(),
-								std::get<std::string>(jsonValue.value).size() };
-	}
+			constexpr TapeView operator*() const { return node; }
 
-	void set_string(const char* str) {
-		jsonValue = { std::string{str}, ValueType::STRING_TYPE };
-	}
+			constexpr iterator& operator++() {
+				node = node.at(node.next());
+				return *this;
+			}
 
-	[[nodiscard]] const json_array_type& get_array() const {
-		assert(jsonValue.type == ValueType::ARRAY_TYPE);
-		return std::get<json_array_type>(jsonValue.value);
-	}
+			constexpr iterator operator++(int) {
+				auto old = *this;
+				++*this;
+				return old;
+			}
 
-	json_array_type& get_array() {
-		assert(jsonValue.type == ValueType::ARRAY_TYPE);
-		return std::get<json_array_type>(jsonValue.value);
-	}
+			constexpr bool operator==(const iterator& rhs) const {
+				return node.index == rhs.node.index;
+			}
 
-	void set_array(const json_array_type& arr) {
-		jsonValue = { arr, ValueType::ARRAY_TYPE };
-	}
+		private:
+			TapeView node;
+		};
 
-	[[nodiscard]] const json_object_type& get_object() const {
-		assert(jsonValue.type == ValueType::OBJECT_TYPE);
-		return std::get<json_object_type>(jsonValue.value);
-	}
+		constexpr explicit TapeArray(TapeView node) : node(node) {}
 
-	json_object_type& get_object() {
-		assert(jsonValue.type == ValueType::OBJECT_TYPE);
-		return std::get<json_object_type>(jsonValue.value);
-	}
+		[[nodiscard]] constexpr iterator begin() const { return iterator(node.at(node.index + 2)); }
 
-	void set_object(const json_object_type& obj) {
-		jsonValue = { obj, ValueType::OBJECT_TYPE };
-	}
+		[[nodiscard]] constexpr iterator end() const { return iterator(node.at(node.next())); }
 
-	Status parse() {
-		jsonValue.type = ValueType::NULL_TYPE;
-		parse_whitespace();
-		auto ret = parse_value();
-		if (ret == Status::PARSE_OK) {
-			parse_whitespace();
-			if (!json.empty() && !json.starts_with('\0')) {
-				jsonValue.type = ValueType::NULL_TYPE;
-				ret = Status::PARSE_ROOT_NOT_SINGULAR;
-			}
+		[[nodiscard]] constexpr std::size_t size() const { return static_cast<std::size_t>(node.word(1)); }
+
+		[[nodiscard]] constexpr bool empty() const { return size() == 0; }
+
+		/* elements have no offset table, so this walks i siblings */
+		[[nodiscard]] constexpr TapeView operator[](std::size_t i) const {
+			assert(i < size());
+			auto it = begin();
+			while (i--) ++it;
+			return *it;
 		}
-		return ret;
-	}
 
-	std::string stringify() {
-		std::string s;
-		stringify_value(s, jsonValue);
-		return std::move(s);
-	}
+	private:
+		TapeView node;
+	};
 
-	void swap(LeptJSON& rhs) {
-		std::swap(jsonValue, rhs.jsonValue);
-		std::swap(json, rhs.json);
-	}
+	class TapeObject {
+	public:
+		class iterator {
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = std::pair<std::string_view, TapeView>;
+			using difference_type = std::ptrdiff_t;
+			using pointer = void;
+			using reference = value_type;
 
-private:
-	/* value = null / false / true / number */
-	Status parse_value() {
-		if (json.empty())return Status::PARSE_EXPECT_VALUE;
-		switch (json[0]) {
-			case 't':
-				return parse_literal("true", ValueType::TRUE_TYPE);
-			case 'f':
-				return parse_literal("false", ValueType::FALSE_TYPE);
-			case 'n':
-				return parse_literal("null", ValueType::NULL_TYPE);
-			case '\0':
-				return Status::PARSE_EXPECT_VALUE;
-			case '"':
-				return parse_string();
-			case '[':
-				return parse_array();
-			case '{':
-				return parse_object();
-			default:
-				return parse_number();
+			constexpr iterator() = default;
+
+			constexpr explicit iterator(TapeView key) : key(key) {}
+
+			constexpr value_type operator*() const { return { key.get_string(), key.at(key.index + 2) }; }
+
+			constexpr iterator& operator++() {
+				key = key.at(key.at(key.index + 2).next());
+				return *this;
+			}
+
+			constexpr iterator operator++(int) {
+				auto old = *this;
+				++*this;
+				return old;
+			}
+
+			constexpr bool operator==(const iterator& rhs) const {
+				return key.index == rhs.key.index;
+			}
+
+		private:
+			TapeView key;
+		};
+
+		constexpr explicit TapeObject(TapeView node) : node(node) {}
+
+		[[nodiscard]] constexpr iterator begin() const { return iterator(node.at(node.index + 2)); }
+
+		[[nodiscard]] constexpr iterator end() const { return iterator(node.at(node.next())); }
+
+		[[nodiscard]] constexpr std::size_t size() const { return static_cast<std::size_t>(node.word(1)); }
+
+		[[nodiscard]] constexpr bool empty() const { return size() == 0; }
+
+	private:
+		TapeView node;
+	};
+
+	/*
+	 * Read-only snapshot made by freeze(): the tape of a document, strings included, in one buffer.
+	 * Nothing writes to it after construction, so a shared_ptr<const Frozen> can be read from any
+	 * number of threads at once without locking.
+	 */
+	class Frozen {
+	public:
+		[[nodiscard]] TapeView root() const {
+			return { storage.data(), reinterpret_cast<const char*>(storage.data() + nodeWords) };
 		}
-	}
 
-	/* ws = *(%x20 / %x09 / %x0A / %x0D) */
-	void parse_whitespace() {
-		while (json.starts_with(' ') || json.starts_with('\t') || json.starts_with('\n') || json.starts_with('\r')) {
-			json.remove_prefix(1);
+		[[nodiscard]] std::size_t size_bytes() const {
+			return storage.size() * sizeof(std::uint64_t);
 		}
-	}
 
-	/* literal = "null" / "false" / "true" */
-	Status parse_literal(std::string_view literal, ValueType type) {
-		if (json.size() < literal.size()) {
-			jsonValue.type = ValueType::NULL_TYPE;
-			return Status::PARSE_INVALID_VALUE;
+	private:
+		friend LeptJSON;
+
+		Frozen(std::vector<std::uint64_t> storage, std::size_t nodeWords) : storage(std::move(storage)), nodeWords(nodeWords) {}
+
+		std::vector<std::uint64_t> storage;		/* node words, then the string blob */
+		std::size_t nodeWords;
+	};
+
+	/*
+	 * The current frozen document of a hot-reloaded configuration. load() hands a reader its own
+	 * reference and store() publishes a replacement without waiting for readers; a snapshot is
+	 * freed when its last reader drops it. Without std::atomic<std::shared_ptr> a mutex guards
+	 * just the pointer copy.
+	 */
+	class FrozenSlot {
+	public:
+		FrozenSlot() = default;
+
+		explicit FrozenSlot(std::shared_ptr<const Frozen> document) : current(std::move(document)) {}
+
+		FrozenSlot(const FrozenSlot&) = delete;
+		FrozenSlot& operator=(const FrozenSlot&) = delete;
+
+		[[nodiscard]] std::shared_ptr<const Frozen> load() const {
+#ifdef __cpp_lib_atomic_shared_ptr
+			return current.load(std::memory_order_acquire);
+#else
+			std::lock_guard lock(mutex);
+			return current;
+#endif
 		}
-		for (size_t i = 0; i < literal.size(); ++i) {
-			if (json[i] != literal[i]) {
-				jsonValue.type = ValueType::NULL_TYPE;
-				return Status::PARSE_INVALID_VALUE;
-			}
+
+		void store(std::shared_ptr<const Frozen> document) {
+#ifdef __cpp_lib_atomic_shared_ptr
+			current.store(std::move(document), std::memory_order_release);
+#else
+			std::lock_guard lock(mutex);
+			current.swap(document);
+#endif
 		}
-		json.remove_prefix(literal.size());
-		this->jsonValue.type = type;
-		if (type == ValueType::TRUE_TYPE)jsonValue.value = true;
-		else if (type == ValueType::FALSE_TYPE)jsonValue.value = false;
-		else jsonValue.value = nullptr;
-		return Status::PARSE_OK;
-	}
+
+	private:
+#ifdef __cpp_lib_atomic_shared_ptr
+		std::atomic<std::shared_ptr<const Frozen>> current;
+#else
+		mutable std::mutex mutex;
+		std::shared_ptr<const Frozen> current;
+#endif
+	};
 
 	/*
-  * number = [ "-" ] int [ frac ] [ exp ]
-  * int = "0" / digit1-9 *digit
-  * frac = "." 1*digit
-  * exp = ("e" / "E") ["-" / "+"] 1*digit
-  */
-	Status parse_number() {
-		std::string_view judge = json;
-		if (judge.starts_with('-')) {
-			judge.remove_prefix(1);
-		}
-		if (judge.starts_with('0')) {
-			judge.remove_prefix(1);
+	 * Output of stringify_segments(): pieces of the text in order, each either a long string held by
+	 * the tree or a run of the scratch buffer owned here. Valid while this object lives and the tree
+	 * is not modified.
+	 */
+	class LEPTJSON_API Segments {
+	public:
+		[[nodiscard]] std::vector<std::string_view> views() const {
+			std::vector<std::string_view> out;
+			out.reserve(pieces.size());
+			for (auto&& piece : pieces) out.push_back(view(piece));
+			return out;
 		}
-		else {
-			if (judge.empty() || !isdigit(judge[0])) {
-				jsonValue.type = ValueType::NULL_TYPE;
-				return Status::PARSE_INVALID_VALUE;
-			}
-			for (judge.remove_prefix(1); !judge.empty() && isdigit(judge[0]); judge.remove_prefix(1));
+
+#ifndef _WIN32
+		/* ready for writev() or sendmsg(), which read but never write through iov_base; include <sys/uio.h> to use it */
+		[[nodiscard]] std::vector<iovec> iovecs() const;
+#endif
+
+		[[nodiscard]] std::size_t size() const {
+			std::size_t n = 0;
+			for (auto&& piece : pieces) n += piece.size;
+			return n;
 		}
-		if (judge.starts_with('.')) {
-			judge.remove_prefix(1);
-			if (judge.empty() || !isdigit(judge[0])) {
-				jsonValue.type = ValueType::NULL_TYPE;
-				return Status::PARSE_INVALID_VALUE;
-			}
-			for (judge.remove_prefix(1); !judge.empty() && isdigit(judge[0]); judge.remove_prefix(1));
+
+		[[nodiscard]] std::string str() const {
+			std::string out;
+			out.reserve(size());
+			for (auto&& piece : pieces) out += view(piece);
+			return out;
 		}
-		if (judge.starts_with('e') || judge.starts_with('E')) {
-			judge.remove_prefix(1);
-			if (judge.starts_with('+') || judge.starts_with('-')) {
-				judge.remove_prefix(1);
-			}
-			if (judge.empty() || !isdigit(judge[0])) {
-				jsonValue.type = ValueType::NULL_TYPE;
-				return Status::PARSE_INVALID_VALUE;
-			}
-			for (judge.remove_prefix(1); !judge.empty() && isdigit(judge[0]); judge.remove_prefix(1));
+
+	private:
+		friend LeptJSON;
+
+		/* external is nullptr for a run of scratch starting at offset */
+		struct Piece {
+			const char* external;
+			std::size_t offset;
+			std::size_t size;
+		};
+
+		[[nodiscard]] std::string_view view(const Piece& piece) const {
+			return { piece.external ? piece.external : scratch.data() + piece.offset, piece.size };
 		}
 
-		errno = 0;
-		jsonValue.value = strtod(json.data(), nullptr);
-		if (errno == ERANGE &&
-			(std::get<double>(jsonValue.value) == HUGE_VAL || std::get<double>(jsonValue.value) == -HUGE_VAL)) {
-			return Status::PARSE_NUMBER_TOO_BIG;
+		/* called with the scratch written so far, before a referenced string is appended */
+		void reference(std::string_view text) {
+			if (scratch.size() > scratchEnd) pieces.push_back({ nullptr, scratchEnd, scratch.size() - scratchEnd });
+			pieces.push_back({ text.data(), 0, text.size() });
+			scratchEnd = scratch.size();
 		}
-		json = judge;
-		jsonValue.type = ValueType::NUMBER_TYPE;
-		return Status::PARSE_OK;
-	}
 
-	Status parse_string() {
-		std::string s;
-		if (json.starts_with('\"'))
-			json.remove_prefix(1);
-		for (; !json.empty(); json.remove_prefix(1)) {
-			switch (json.front()) {
-				case '\"':
-					//	jsonValue = { std::string{s.data()},ValueType::STRING_TYPE };
-					jsonValue = { std::move(s), ValueType::STRING_TYPE };//! why
-					json.remove_prefix(1);
+		std::string scratch;
+		std::vector<Piece> pieces;
+		std::size_t scratchEnd = 0;		/* scratch up to here is covered by pieces */
+		std::size_t minReference = 0;
+	};
+
+	/* read-only mapping of a whole file, is_open() is false when it cannot be opened or is empty */
+	class LEPTJSON_API MappedFile {
+	public:
+		MappedFile() = default;
+
+		explicit MappedFile(const char* path);
+
+		MappedFile(const MappedFile&) = delete;
+
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		MappedFile(MappedFile&& rhs) noexcept : data(std::exchange(rhs.data, nullptr)), length(std::exchange(rhs.length, 0)) {}
+
+		MappedFile& operator=(MappedFile&& rhs) noexcept {
+			if (this != &rhs) {
+				unmap();
+				data = std::exchange(rhs.data, nullptr);
+				length = std::exchange(rhs.length, 0);
+			}
+			return *this;
+		}
+
+		~MappedFile() {
+			unmap();
+		}
+
+		[[nodiscard]] bool is_open() const { return data != nullptr; }
+
+		[[nodiscard]] std::string_view bytes() const { return { data, length }; }
+
+	private:
+		void unmap();
+
+		const char* data = nullptr;
+		std::size_t length = 0;
+	};
+
+	/*
+	 * Key paths for parse(const Projection&), written as RFC 6901 pointers. Array elements are
+	 * transparent, so "/users/name" selects the name of every element of users, and a selected
+	 * path keeps its whole subtree.
+	 */
+	class Projection {
+	public:
+		/* "" selects the whole document, false when the pointer is malformed */
+		bool add(std::string_view pointer) {
+			std::vector<std::string> tokens;
+			if (!split_pointer(pointer, tokens)) return false;
+			Node* node = &root;
+			for (auto&& token : tokens) {
+				if (node->whole) return true;
+				auto* child = node->find(token);
+				node = child ? child : &node->children.emplace_back(Node{ std::move(token), {} });
+			}
+			node->whole = true;
+			node->children.clear();
+			return true;
+		}
+
+	private:
+		friend LeptJSON;
+
+		struct Node {
+			std::string key;
+			std::vector<Node> children;
+			bool whole = false;
+
+			[[nodiscard]] const Node* find(std::string_view k) const {
+				for (auto&& child : children) {
+					if (child.key == k) return &child;
+				}
+				return nullptr;
+			}
+
+			[[nodiscard]] Node* find(std::string_view k) {
+				return const_cast<Node*>(std::as_const(*this).find(k));
+			}
+		};
+
+		Node root;
+	};
+
+	/*
+	 * Compiled JSONPath query, built once and shared freely. Supported: $, .name, ['name'], [n] with
+	 * negative n counting from the end, * and [*], recursive descent (..name, ..*, ..[n], ..[?...]) and
+	 * filters [?(@.a[0].b op literal)] or [?(@.a)], where op is == != < <= > >= and the literal is a
+	 * number, a quoted string, true, false or null. Unions and slices are not supported.
+	 */
+	class JsonPath {
+	public:
+		static Status compile(std::string_view expression, JsonPath& out) {
+			JsonPath path;
+			if (!expression.starts_with('$')) return Status::PATH_INVALID_EXPRESSION;
+			expression.remove_prefix(1);
+			while (!expression.empty()) {
+				Step step;
+				bool ok = false;
+				if (expression.starts_with("..")) {
+					expression.remove_prefix(2);
+					step.descendant = true;
+					ok = expression.starts_with('[') ? parse_bracket(expression, step) : parse_member(expression, step);
+				}
+				else if (expression.starts_with('.')) {
+					expression.remove_prefix(1);
+					ok = parse_member(expression, step);
+				}
+				else if (expression.starts_with('[')) {
+					ok = parse_bracket(expression, step);
+				}
+				if (!ok || path.steps.size() == max_steps) return Status::PATH_INVALID_EXPRESSION;
+				path.steps.push_back(std::move(step));
+			}
+			out = std::move(path);
+			return Status::PARSE_OK;
+		}
+
+	private:
+		friend LeptJSON;
+
+		/* one bit per step in the evaluation state, plus one for "matched" */
+		static constexpr std::size_t max_steps = 63;
+
+		enum class Selector { NAME, INDEX, WILDCARD, FILTER };
+		enum class Compare { EXISTS, EQUAL, NOT_EQUAL, LESS, LESS_EQUAL, GREATER, GREATER_EQUAL };
+
+		/* member name, or array index when index >= 0 */
+		struct Key {
+			std::string name;
+			std::int64_t index = -1;
+		};
+
+		struct Filter {
+			std::vector<Key> path;
+			Compare compare = Compare::EXISTS;
+			ValueType type = ValueType::NULL_TYPE;
+			double number = 0;
+			std::string text;
+		};
+
+		struct Step {
+			Selector selector = Selector::WILDCARD;
+			bool descendant = false;
+			std::string name;
+			std::int64_t index = 0;
+			Filter filter;
+		};
+
+		static void skip_spaces(std::string_view& s) {
+			while (s.starts_with(' ')) s.remove_prefix(1);
+		}
+
+		static bool parse_name(std::string_view& s, std::string& name) {
+			std::size_t n = 0;
+			while (n < s.size() && (std::isalnum(static_cast<unsigned char>(s[n])) || s[n] == '_' || s[n] == '-' || s[n] == '$' ||
+				static_cast<unsigned char>(s[n]) >= 0x80)) ++n;
+			name.assign(s.data(), n);
+			s.remove_prefix(n);
+			return n != 0;
+		}
+
+		/* 'text' or "text", backslash escapes only the quote and itself */
+		static bool parse_quoted(std::string_view& s, std::string& text) {
+			const char quote = s.front();
+			s.remove_prefix(1);
+			text.clear();
+			while (!s.empty() && s.front() != quote) {
+				if (s.front() == '\\') {
+					s.remove_prefix(1);
+					if (s.empty() || (s.front() != quote && s.front() != '\\')) return false;
+				}
+				text += s.front();
+				s.remove_prefix(1);
+			}
+			if (s.empty()) return false;
+			s.remove_prefix(1);
+			return true;
+		}
+
+		static bool parse_integer(std::string_view& s, std::int64_t& value) {
+			const auto [p, ec] = std::from_chars(s.data(), s.data() + s.size(), value);
+			if (ec != std::errc{}) return false;
+			s.remove_prefix(static_cast<std::size_t>(p - s.data()));
+			return true;
+		}
+
+		static bool parse_member(std::string_view& s, Step& step) {
+			if (s.starts_with('*')) {
+				s.remove_prefix(1);
+				step.selector = Selector::WILDCARD;
+				return true;
+			}
+			step.selector = Selector::NAME;
+			return parse_name(s, step.name);
+		}
+
+		static bool parse_bracket(std::string_view& s, Step& step) {
+			s.remove_prefix(1);
+			skip_spaces(s);
+			bool ok = false;
+			if (s.starts_with('*')) {
+				s.remove_prefix(1);
+				step.selector = Selector::WILDCARD;
+				ok = true;
+			}
+			else if (s.starts_with('\'') || s.starts_with('"')) {
+				step.selector = Selector::NAME;
+				ok = parse_quoted(s, step.name);
+			}
+			else if (s.starts_with('?')) {
+				s.remove_prefix(1);
+				skip_spaces(s);
+				const bool parenthesized = s.starts_with('(');
+				if (parenthesized) s.remove_prefix(1);
+				step.selector = Selector::FILTER;
+				ok = parse_filter(s, step.filter);
+				skip_spaces(s);
+				if (parenthesized) ok = ok && s.starts_with(')') && (s.remove_prefix(1), true);
+			}
+			else {
+				step.selector = Selector::INDEX;
+				ok = parse_integer(s, step.index);
+			}
+			skip_spaces(s);
+			if (!ok || !s.starts_with(']')) return false;
+			s.remove_prefix(1);
+			return true;
+		}
+
+		/* @ followed by .name, ['name'] or [n], then an optional comparison with a literal */
+		static bool parse_filter(std::string_view& s, Filter& filter) {
+			skip_spaces(s);
+			if (!s.starts_with('@')) return false;
+			s.remove_prefix(1);
+			while (s.starts_with('.') || s.starts_with('[')) {
+				auto& key = filter.path.emplace_back();
+				if (s.starts_with('.')) {
+					s.remove_prefix(1);
+					if (!parse_name(s, key.name)) return false;
+					continue;
+				}
+				s.remove_prefix(1);
+				skip_spaces(s);
+				if (s.starts_with('\'') || s.starts_with('"')) {
+					if (!parse_quoted(s, key.name)) return false;
+				}
+				else if (!parse_integer(s, key.index) || key.index < 0) {
+					return false;
+				}
+				skip_spaces(s);
+				if (!s.starts_with(']')) return false;
+				s.remove_prefix(1);
+			}
+			skip_spaces(s);
+			constexpr std::pair<std::string_view, Compare> operators[] = {
+				{ "==", Compare::EQUAL }, { "!=", Compare::NOT_EQUAL }, { "<=", Compare::LESS_EQUAL },
+				{ ">=", Compare::GREATER_EQUAL }, { "<", Compare::LESS }, { ">", Compare::GREATER },
+			};
+			for (auto&& [op, compare] : operators) {
+				if (s.starts_with(op)) {
+					s.remove_prefix(op.size());
+					filter.compare = compare;
+					break;
+				}
+			}
+			if (filter.compare == Compare::EXISTS) return true;
+			skip_spaces(s);
+			for (auto [literal, type] : { std::pair{ std::string_view("true"), ValueType::TRUE_TYPE },
+				std::pair{ std::string_view("false"), ValueType::FALSE_TYPE }, std::pair{ std::string_view("null"), ValueType::NULL_TYPE } }) {
+				if (s.starts_with(literal)) {
+					s.remove_prefix(literal.size());
+					filter.type = type;
+					return true;
+				}
+			}
+			if (s.starts_with('\'') || s.starts_with('"')) {
+				filter.type = ValueType::STRING_TYPE;
+				return parse_quoted(s, filter.text);
+			}
+			filter.type = ValueType::NUMBER_TYPE;
+			const auto [p, ec] = std::from_chars(s.data(), s.data() + s.size(), filter.number);
+			if (ec != std::errc{}) return false;
+			s.remove_prefix(static_cast<std::size_t>(p - s.data()));
+			return true;
+		}
+
+		std::vector<Step> steps;
+	};
+
+private:
+
+	/*
+	 * Vector that keeps up to N elements inside itself and moves them to the heap only when it grows
+	 * past that, so a small array or object node is a single allocation. Iterators are invalidated as
+	 * for std::vector, and also by moving the container while its elements are inline.
+	 */
+	template <typename T, std::size_t N>
+	class SmallVector {
+	public:
+		using value_type = T;
+		using size_type = std::size_t;
+		using difference_type = std::ptrdiff_t;
+		using reference = T&;
+		using const_reference = const T&;
+		using pointer = T*;
+		using const_pointer = const T*;
+		using iterator = T*;
+		using const_iterator = const T*;
+		using reverse_iterator = std::reverse_iterator<iterator>;
+		using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+		SmallVector() noexcept {}
+
+		SmallVector(std::initializer_list<T> init) : SmallVector(init.begin(), init.end()) {}
+
+		template <std::input_iterator It>
+		SmallVector(It begin, It end) : SmallVector() {
+			for (; begin != end; ++begin) emplace_back(*begin);
+		}
+
+		SmallVector(const SmallVector& rhs) : SmallVector() {
+			reserve(rhs.count);
+			std::uninitialized_copy(rhs.begin(), rhs.end(), first);
+			count = rhs.count;
+		}
+
+		SmallVector(SmallVector&& rhs) noexcept : SmallVector() {
+			take(rhs);
+		}
+
+		SmallVector& operator=(const SmallVector& rhs) {
+			if (this != &rhs) *this = SmallVector(rhs);
+			return *this;
+		}
+
+		SmallVector& operator=(SmallVector&& rhs) noexcept {
+			if (this != &rhs) {
+				reset();
+				take(rhs);
+			}
+			return *this;
+		}
+
+		~SmallVector() { reset(); }
+
+		[[nodiscard]] iterator begin() noexcept { return first; }
+		[[nodiscard]] const_iterator begin() const noexcept { return first; }
+		[[nodiscard]] const_iterator cbegin() const noexcept { return first; }
+		[[nodiscard]] iterator end() noexcept { return first + count; }
+		[[nodiscard]] const_iterator end() const noexcept { return first + count; }
+		[[nodiscard]] const_iterator cend() const noexcept { return first + count; }
+		[[nodiscard]] reverse_iterator rbegin() noexcept { return reverse_iterator(end()); }
+		[[nodiscard]] const_reverse_iterator rbegin() const noexcept { return const_reverse_iterator(end()); }
+		[[nodiscard]] reverse_iterator rend() noexcept { return reverse_iterator(begin()); }
+		[[nodiscard]] const_reverse_iterator rend() const noexcept { return const_reverse_iterator(begin()); }
+
+		[[nodiscard]] size_type size() const noexcept { return count; }
+		[[nodiscard]] bool empty() const noexcept { return count == 0; }
+		[[nodiscard]] size_type capacity() const noexcept { return limit; }
+		[[nodiscard]] T* data() noexcept { return first; }
+		[[nodiscard]] const T* data() const noexcept { return first; }
+
+		[[nodiscard]] T& operator[](size_type i) { return first[i]; }
+		[[nodiscard]] const T& operator[](size_type i) const { return first[i]; }
+		[[nodiscard]] T& front() { return first[0]; }
+		[[nodiscard]] const T& front() const { return first[0]; }
+		[[nodiscard]] T& back() { return first[count - 1]; }
+		[[nodiscard]] const T& back() const { return first[count - 1]; }
+
+		[[nodiscard]] T& at(size_type i) {
+			if (i >= count) throw std::out_of_range("LeptJSON::SmallVector::at");
+			return first[i];
+		}
+
+		[[nodiscard]] const T& at(size_type i) const {
+			return const_cast<SmallVector&>(*this).at(i);
+		}
+
+		void reserve(size_type n) {
+			if (n > limit) relocate(n);
+		}
+
+		/* back to the inline buffer when the elements fit in it */
+		void shrink_to_fit() {
+			if (count < limit && !is_inline()) relocate(count);
+		}
+
+		void clear() noexcept {
+			std::destroy(first, first + count);
+			count = 0;
+		}
+
+		void push_back(const T& value) { emplace_back(value); }
+		void push_back(T&& value) { emplace_back(std::move(value)); }
+
+		template <typename... Args>
+		T& emplace_back(Args&&... args) {
+			if (count < limit) return *std::construct_at(first + count++, std::forward<Args>(args)...);
+			/* the new element is built before the old ones move, as args may refer to one of them */
+			const auto n = std::max(limit * 2, limit + 1);
+			T* target = std::allocator<T>{}.allocate(n);
+			try {
+				std::construct_at(target + count, std::forward<Args>(args)...);
+			}
+			catch (...) {
+				std::allocator<T>{}.deallocate(target, n);
+				throw;
+			}
+			adopt(target, n);
+			return first[count++];
+		}
+
+		void pop_back() {
+			std::destroy_at(first + --count);
+		}
+
+		template <typename... Args>
+		iterator emplace(const_iterator pos, Args&&... args) {
+			const auto index = pos - first;
+			emplace_back(std::forward<Args>(args)...);
+			std::rotate(first + index, first + count - 1, first + count);
+			return first + index;
+		}
+
+		iterator insert(const_iterator pos, const T& value) { return emplace(pos, value); }
+		iterator insert(const_iterator pos, T&& value) { return emplace(pos, std::move(value)); }
+
+		template <std::input_iterator It>
+		iterator insert(const_iterator pos, It begin, It end) {
+			const auto index = pos - first;
+			const auto size = count;
+			for (; begin != end; ++begin) emplace_back(*begin);
+			std::rotate(first + index, first + size, first + count);
+			return first + index;
+		}
+
+		iterator erase(const_iterator pos) { return erase(pos, pos + 1); }
+
+		iterator erase(const_iterator begin, const_iterator end) {
+			T* target = first + (begin - first);
+			T* last = std::move(first + (end - first), first + count, target);
+			std::destroy(last, first + count);
+			count = static_cast<size_type>(last - first);
+			return target;
+		}
+
+		void resize(size_type n) {
+			if (n < count) {
+				std::destroy(first + n, first + count);
+				count = n;
+				return;
+			}
+			reserve(n);
+			while (count < n) std::construct_at(first + count++);
+		}
+
+		void swap(SmallVector& rhs) noexcept {
+			SmallVector tmp(std::move(rhs));
+			rhs = std::move(*this);
+			*this = std::move(tmp);
+		}
+
+		friend bool operator==(const SmallVector& lhs, const SmallVector& rhs) {
+			return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+		}
+
+	private:
+		[[nodiscard]] T* inline_data() noexcept { return reinterpret_cast<T*>(buffer); }
+		[[nodiscard]] bool is_inline() const noexcept { return first == reinterpret_cast<const T*>(buffer); }
+
+		/* moves the elements to a buffer of n, which is the inline one when they fit */
+		void relocate(size_type n) {
+			if (n <= N) {
+				if (is_inline()) return;
+				adopt(inline_data(), N);
+			}
+			else {
+				adopt(std::allocator<T>{}.allocate(n), n);
+			}
+		}
+
+		/* moves the elements into target and makes it the storage */
+		void adopt(T* target, size_type n) noexcept {
+			std::uninitialized_move(first, first + count, target);
+			std::destroy(first, first + count);
+			if (!is_inline()) std::allocator<T>{}.deallocate(first, limit);
+			first = target;
+			limit = n;
+		}
+
+		/* steals rhs into this empty inline vector, leaving rhs empty and inline */
+		void take(SmallVector& rhs) noexcept {
+			if (rhs.is_inline()) {
+				std::uninitialized_move(rhs.first, rhs.first + rhs.count, first);
+				count = rhs.count;
+				rhs.clear();
+				return;
+			}
+			first = std::exchange(rhs.first, rhs.inline_data());
+			count = std::exchange(rhs.count, 0);
+			limit = std::exchange(rhs.limit, N);
+		}
+
+		void reset() noexcept {
+			clear();
+			if (!is_inline()) std::allocator<T>{}.deallocate(first, limit);
+			first = inline_data();
+			limit = N;
+		}
+
+		T* first = inline_data();
+		size_type count = 0;
+		size_type limit = N;
+		alignas(T) std::byte buffer[N == 0 ? 1 : N * sizeof(T)];
+	};
+
+	/*
+	 * Members of an object sorted by key. They stay in a SmallVector while the object is small or is
+	 * built in one go by a parser, so it takes no allocation of its own and lookups are a binary search.
+	 * An insert that grows it past tree_threshold moves them into a tree, so building a large object
+	 * member by member stays O(n log n). It follows std::map, except that value_type's key is not const
+	 * and, while the members are in the vector, inserting or erasing invalidates iterators.
+	 */
+	template <typename T, std::size_t N>
+	class SmallMap {
+	public:
+		using key_type = std::string;
+		using mapped_type = T;
+		using value_type = std::pair<std::string, T>;
+		using storage_type = SmallVector<value_type, N>;
+		using size_type = std::size_t;
+		using difference_type = std::ptrdiff_t;
+		using reference = value_type&;
+		using const_reference = const value_type&;
+
+		static constexpr size_type tree_threshold = std::max<size_type>(N, 64);
+
+	private:
+		struct KeyLess {
+			using is_transparent = void;
+			bool operator()(const value_type& lhs, const value_type& rhs) const { return lhs.first < rhs.first; }
+			bool operator()(const value_type& lhs, std::string_view rhs) const { return lhs.first < rhs; }
+			bool operator()(std::string_view lhs, const value_type& rhs) const { return lhs < rhs.first; }
+		};
+
+		/* set nodes hold non-const members, only the key must not change through the iterators */
+		using tree_type = std::set<value_type, KeyLess>;
+
+		template <bool Const>
+		class basic_iterator {
+		public:
+			using iterator_category = std::bidirectional_iterator_tag;
+			using value_type = SmallMap::value_type;
+			using difference_type = std::ptrdiff_t;
+			using reference = std::conditional_t<Const, const value_type&, value_type&>;
+			using pointer = std::conditional_t<Const, const value_type*, value_type*>;
+
+			basic_iterator() = default;
+
+			template <bool C> requires (Const && !C)
+			basic_iterator(const basic_iterator<C>& rhs) : member(rhs.member), node(rhs.node) {}
+
+			[[nodiscard]] reference operator*() const { return member ? *member : const_cast<value_type&>(*node); }
+			[[nodiscard]] pointer operator->() const { return &**this; }
+
+			basic_iterator& operator++() {
+				if (member) ++member;
+				else ++node;
+				return *this;
+			}
+
+			basic_iterator operator++(int) {
+				auto old = *this;
+				++*this;
+				return old;
+			}
+
+			basic_iterator& operator--() {
+				if (member) --member;
+				else --node;
+				return *this;
+			}
+
+			basic_iterator operator--(int) {
+				auto old = *this;
+				--*this;
+				return old;
+			}
+
+			friend bool operator==(const basic_iterator& lhs, const basic_iterator& rhs) {
+				return lhs.member ? lhs.member == rhs.member : !rhs.member && lhs.node == rhs.node;
+			}
+
+		private:
+			friend SmallMap;
+			template <bool> friend class basic_iterator;
+
+			explicit basic_iterator(pointer m) : member(m) {}
+			explicit basic_iterator(typename tree_type::const_iterator n) : node(n) {}
+
+			pointer member = nullptr;					/* null when the members are in the tree */
+			typename tree_type::const_iterator node{};
+		};
+
+	public:
+		using iterator = basic_iterator<false>;
+		using const_iterator = basic_iterator<true>;
+		using reverse_iterator = std::reverse_iterator<iterator>;
+		using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+		SmallMap() = default;
+
+		/* the first of equal keys is kept, as in std::map */
+		SmallMap(std::initializer_list<value_type> init) {
+			for (auto&& member : init) insert(member);
+		}
+
+		SmallMap(const SmallMap& rhs) : members(rhs.members), tree(rhs.tree ? std::make_unique<tree_type>(*rhs.tree) : nullptr) {}
+
+		SmallMap(SmallMap&& rhs) noexcept = default;
+
+		SmallMap& operator=(const SmallMap& rhs) {
+			if (this != &rhs) *this = SmallMap(rhs);
+			return *this;
+		}
+
+		SmallMap& operator=(SmallMap&& rhs) noexcept = default;
+
+		[[nodiscard]] iterator begin() noexcept { return tree ? iterator(tree->begin()) : iterator(members.begin()); }
+		[[nodiscard]] const_iterator begin() const noexcept { return const_cast<SmallMap&>(*this).begin(); }
+		[[nodiscard]] const_iterator cbegin() const noexcept { return begin(); }
+		[[nodiscard]] iterator end() noexcept { return tree ? iterator(tree->end()) : iterator(members.end()); }
+		[[nodiscard]] const_iterator end() const noexcept { return const_cast<SmallMap&>(*this).end(); }
+		[[nodiscard]] const_iterator cend() const noexcept { return end(); }
+		[[nodiscard]] reverse_iterator rbegin() noexcept { return reverse_iterator(end()); }
+		[[nodiscard]] const_reverse_iterator rbegin() const noexcept { return const_reverse_iterator(end()); }
+		[[nodiscard]] reverse_iterator rend() noexcept { return reverse_iterator(begin()); }
+		[[nodiscard]] const_reverse_iterator rend() const noexcept { return const_reverse_iterator(begin()); }
+
+		[[nodiscard]] size_type size() const noexcept { return tree ? tree->size() : members.size(); }
+		[[nodiscard]] bool empty() const noexcept { return size() == 0; }
+
+		void reserve(size_type n) {
+			if (!tree) members.reserve(std::min(n, tree_threshold));
+		}
+
+		void clear() noexcept {
+			tree.reset();
+			members.clear();
+		}
+
+		[[nodiscard]] iterator lower_bound(std::string_view key) {
+			if (tree) return iterator(tree->lower_bound(key));
+			/* members added in key order, as from a sorted source, skip the search */
+			if (members.empty() || members.back().first < key) return end();
+			return iterator(std::lower_bound(members.begin(), members.end(), key, KeyLess{}));
+		}
+
+		[[nodiscard]] const_iterator lower_bound(std::string_view key) const {
+			return const_cast<SmallMap&>(*this).lower_bound(key);
+		}
+
+		[[nodiscard]] iterator find(std::string_view key) {
+			const auto it = lower_bound(key);
+			return it != end() && it->first == key ? it : end();
+		}
+
+		[[nodiscard]] const_iterator find(std::string_view key) const {
+			return const_cast<SmallMap&>(*this).find(key);
+		}
+
+		[[nodiscard]] bool contains(std::string_view key) const { return find(key) != end(); }
+		[[nodiscard]] size_type count(std::string_view key) const { return contains(key); }
+
+		[[nodiscard]] T& at(std::string_view key) {
+			const auto it = find(key);
+			if (it == end()) throw std::out_of_range("LeptJSON::SmallMap::at");
+			return it->second;
+		}
+
+		[[nodiscard]] const T& at(std::string_view key) const {
+			return const_cast<SmallMap&>(*this).at(key);
+		}
+
+		T& operator[](const std::string& key) { return try_emplace(key).first->second; }
+		T& operator[](std::string&& key) { return try_emplace(std::move(key)).first->second; }
+
+		template <typename K, typename... Args>
+		std::pair<iterator, bool> try_emplace(K&& key, Args&&... args) {
+			const std::string_view k = key;
+			const auto it = lower_bound(k);
+			if (it != end() && it->first == k) return { it, false };
+			return { insert_absent(it, k, std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)),
+				std::forward_as_tuple(std::forward<Args>(args)...)), true };
+		}
+
+		template <typename K, typename M>
+		std::pair<iterator, bool> insert_or_assign(K&& key, M&& value) {
+			const std::string_view k = key;
+			const auto it = lower_bound(k);
+			if (it != end() && it->first == k) {
+				it->second = std::forward<M>(value);
+				return { it, false };
+			}
+			return { insert_absent(it, k, std::forward<K>(key), std::forward<M>(value)), true };
+		}
+
+		std::pair<iterator, bool> insert(const value_type& member) { return try_emplace(member.first, member.second); }
+		std::pair<iterator, bool> insert(value_type&& member) { return try_emplace(std::move(member.first), std::move(member.second)); }
+
+		template <typename... Args>
+		std::pair<iterator, bool> emplace(Args&&... args) {
+			return insert(value_type(std::forward<Args>(args)...));
+		}
+
+		iterator erase(const_iterator pos) {
+			return tree ? iterator(tree->erase(pos.node)) : iterator(members.erase(pos.member));
+		}
+
+		iterator erase(const_iterator begin, const_iterator end) {
+			return tree ? iterator(tree->erase(begin.node, end.node)) : iterator(members.erase(begin.member, end.member));
+		}
+
+		size_type erase(std::string_view key) {
+			const auto it = find(key);
+			if (it == end()) return 0;
+			erase(it);
+			return 1;
+		}
+
+		void swap(SmallMap& rhs) noexcept {
+			members.swap(rhs.members);
+			tree.swap(rhs.tree);
+		}
+
+		friend bool operator==(const SmallMap& lhs, const SmallMap& rhs) {
+			return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin());
+		}
+
+	private:
+		friend LeptJSON;
+
+		/* inserts a member whose key is known to be absent, pos being lower_bound(key) */
+		template <typename... Args>
+		iterator insert_absent(const_iterator pos, std::string_view key, Args&&... args) {
+			if (tree) return iterator(tree->emplace_hint(pos.node, std::forward<Args>(args)...));
+			if (members.size() < tree_threshold) return iterator(members.emplace(pos.member, std::forward<Args>(args)...));
+			/* built before the members move, as args may refer to one of them */
+			value_type member(std::forward<Args>(args)...);
+			auto t = std::make_unique<tree_type>();
+			for (auto& m : members) t->emplace_hint(t->end(), std::move(m));
+			members = storage_type();
+			tree = std::move(t);
+			return iterator(tree->emplace_hint(tree->lower_bound(key), std::move(member)));
+		}
+
+		/* for parsers: members go in source order with append() into an empty map, then sort() orders them once */
+		void append(std::string&& key, T&& value) {
+			members.emplace_back(std::move(key), std::move(value));
+		}
+
+		/* stable, and the last of equal keys wins as with insert_or_assign() */
+		void sort() {
+			if (std::adjacent_find(members.begin(), members.end(), [](const value_type& lhs, const value_type& rhs) { return lhs.first >= rhs.first; }) == members.end()) return;
+			/* positions are sorted rather than members, which are costly to swap, then members move once per cycle */
+			SmallVector<std::uint32_t, 32> order;
+			for (std::uint32_t i = 0; i < members.size(); ++i) order.push_back(i);
+			std::sort(order.begin(), order.end(), [this](std::uint32_t lhs, std::uint32_t rhs) {
+				const auto compare = members[lhs].first.compare(members[rhs].first);
+				return compare < 0 || (compare == 0 && lhs < rhs);
+			});
+			for (std::uint32_t i = 0; i < order.size(); ++i) {
+				if (order[i] == i) continue;
+				value_type member = std::move(members[i]);
+				auto j = i;
+				for (; order[j] != i; j = std::exchange(order[j], j)) members[j] = std::move(members[order[j]]);
+				members[j] = std::move(member);
+				order[j] = j;
+			}
+			auto last = members.begin();
+			for (auto it = members.begin() + 1; it != members.end(); ++it) {
+				if (it->first != last->first) ++last;
+				if (it != last) *last = std::move(*it);
+			}
+			members.erase(last + 1, members.end());
+		}
+
+		storage_type members;
+		std::unique_ptr<tree_type> tree;		/* holds the members instead once set */
+	};
+
+	struct JsonValue;
+
+	using json_array_type = SmallVector<JsonValue, LEPTJSON_SMALL_CAPACITY>;
+	using json_object_type = SmallMap<JsonValue, LEPTJSON_SMALL_CAPACITY>;
+	using json_numbers_type = SmallVector<double, LEPTJSON_SMALL_CAPACITY>;
+
+	/* containers are shared between copies and cloned on the first write, see detach_array()/detach_object() */
+	template <typename Container>
+	struct SharedNode {
+		Container items;
+		mutable std::atomic<std::size_t> hash{ 0 };		/* structural hash, 0 until computed and after every write access */
+		bool exposed = false;							/* a writable reference was handed out, see cached_hash() */
+
+		explicit SharedNode(const Container& c) : items(c) {}
+
+		explicit SharedNode(Container&& c) : items(std::move(c)) {}
+
+		SharedNode(const SharedNode& rhs) : items(rhs.items) {}
+	};
+
+	/*
+	 * Array whose elements are all numbers, stored as contiguous doubles. The parser picks it for
+	 * such arrays; generic readers get an expanded copy built once, and a write converts the node
+	 * into a plain array first, see as_array()/detach_array().
+	 */
+	struct NumberArray {
+		json_numbers_type items;
+		mutable std::atomic<std::size_t> hash{ 0 };
+		mutable std::once_flag expandOnce;
+		mutable std::unique_ptr<const json_array_type> expanded;
+
+		explicit NumberArray(json_numbers_type&& n) : items(std::move(n)) {}
+	};
+
+	/*
+	 * Number stored as its source text under PARSE_LAZY_NUMBERS. Texts of up to 20 bytes live inline,
+	 * longer ones on the heap, so the node is no bigger than a std::string. The double is cached on
+	 * first use; texts beyond the double range are kept and read as +-HUGE_VAL.
+	 */
+	class RawNumber {
+	public:
+		explicit RawNumber(std::string_view text) : size(static_cast<std::uint32_t>(text.size())) {
+			char* dest = buffer;
+			if (size > inline_capacity) {
+				dest = new char[size];
+				std::memcpy(buffer, &dest, sizeof(dest));
+			}
+			std::memcpy(dest, text.data(), size);
+		}
+
+		RawNumber(const RawNumber& rhs) : RawNumber(rhs.text()) {
+			bits.store(rhs.bits.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		}
+
+		RawNumber(RawNumber&& rhs) noexcept : bits(rhs.bits.load(std::memory_order_relaxed)), size(rhs.size) {
+			std::memcpy(buffer, rhs.buffer, sizeof(buffer));
+			rhs.size = 0;
+		}
+
+		RawNumber& operator=(RawNumber rhs) noexcept {
+			std::swap(size, rhs.size);
+			char tmp[inline_capacity];
+			std::memcpy(tmp, buffer, sizeof(buffer));
+			std::memcpy(buffer, rhs.buffer, sizeof(buffer));
+			std::memcpy(rhs.buffer, tmp, sizeof(buffer));
+			bits.store(rhs.bits.load(std::memory_order_relaxed), std::memory_order_relaxed);
+			return *this;
+		}
+
+		~RawNumber() {
+			if (size > inline_capacity) delete[] heap();
+		}
+
+		[[nodiscard]] std::string_view text() const {
+			return { size > inline_capacity ? heap() : buffer, size };
+		}
+
+		[[nodiscard]] double value() const {
+			auto b = bits.load(std::memory_order_relaxed);
+			if (b == unconverted) {
+				const auto t = text();
+				double d = 0;
+				if (std::from_chars(t.data(), t.data() + t.size(), d).ec != std::errc{}) {
+					d = std::strtod(std::string(t).c_str(), nullptr);
+				}
+				b = std::bit_cast<std::uint64_t>(d);
+				bits.store(b, std::memory_order_relaxed);
+			}
+			return std::bit_cast<double>(b);
+		}
+
+		friend bool operator==(const RawNumber& lhs, const RawNumber& rhs) {
+			return lhs.value() == rhs.value();
+		}
+
+	private:
+		static constexpr std::size_t inline_capacity = 20;
+		static constexpr std::uint64_t unconverted = 0x7ff8'0000'0000'0001;	/* a NaN, which no JSON number converts to */
+
+		[[nodiscard]] char* heap() const {
+			char* p;
+			std::memcpy(&p, buffer, sizeof(p));
+			return p;
+		}
+
+		mutable std::atomic<std::uint64_t> bits{ unconverted };
+		std::uint32_t size;
+		char buffer[inline_capacity];
+	};
+
+	using json_array_ptr = std::shared_ptr<SharedNode<json_array_type>>;
+	using json_object_ptr = std::shared_ptr<SharedNode<json_object_type>>;
+	using json_numbers_ptr = std::shared_ptr<NumberArray>;
+	using jsonValueType = std::variant<std::nullptr_t, double, std::string, bool, json_array_ptr, json_object_ptr, RawNumber, json_numbers_ptr>;
+
+	struct JsonValue {
+		jsonValueType value;
+		ValueType type;
+
+		JsonValue(jsonValueType v, ValueType t) : value(std::move(v)), type(t) {}
+
+		/* containers are taken by reference, moving one with inline elements is not free */
+		JsonValue(const json_array_type& a, ValueType t) : value(std::make_shared<SharedNode<json_array_type>>(a)), type(t) {
+			assert(t == ValueType::ARRAY_TYPE);
+		}
+
+		JsonValue(json_array_type&& a, ValueType t) : value(std::make_shared<SharedNode<json_array_type>>(std::move(a))), type(t) {
+			assert(t == ValueType::ARRAY_TYPE);
+		}
+
+		JsonValue(const json_object_type& o, ValueType t) : value(std::make_shared<SharedNode<json_object_type>>(o)), type(t) {
+			assert(t == ValueType::OBJECT_TYPE);
+		}
+
+		JsonValue(json_object_type&& o, ValueType t) : value(std::make_shared<SharedNode<json_object_type>>(std::move(o))), type(t) {
+			assert(t == ValueType::OBJECT_TYPE);
+		}
+
+		JsonValue(json_numbers_type&& n, ValueType t) : value(std::make_shared<NumberArray>(std::move(n))), type(t) {
+			assert(t == ValueType::ARRAY_TYPE);
+		}
+
+		JsonValue() = default;
+
+		JsonValue(const JsonValue& rhs) = default;
+
+		JsonValue(JsonValue&& rhs) noexcept : value(std::move(rhs.value)), type(rhs.type) {
+			rhs.value = nullptr;
+			rhs.type = ValueType::NULL_TYPE;
+		}
+
+		JsonValue& operator=(const JsonValue& rhs) {
+			if (this != &rhs) {
+				value = rhs.value;
+				type = rhs.type;
+			}
+			return *this;
+		}
+
+		JsonValue& operator=(JsonValue&& rhs) noexcept {
+			if (this != &rhs) {
+				value = std::move(rhs.value);
+				type = rhs.type;
+				rhs.value = nullptr;
+				rhs.type = ValueType::NULL_TYPE;
+			}
+			return *this;
+		}
+	} jsonValue;
+
+public:
+	/*
+	 * Compiled JSON Schema subset for parse(const Schema&): boolean schemas, type (a name or a list of
+	 * them), properties, required, items (one schema for every element), enum, minimum, maximum,
+	 * exclusiveMinimum, exclusiveMaximum, minLength, maxLength (in code points), minItems and maxItems.
+	 * Other keywords are ignored, so additional properties are allowed.
+	 */
+	class Schema {
+	public:
+		static Status compile(const LeptJSON& schema, Schema& out) {
+			Schema compiled;
+			compiled.nodes.clear();
+			if (!compiled.compile_node(schema.jsonValue)) return Status::SCHEMA_INVALID;
+			out = std::move(compiled);
+			return Status::PARSE_OK;
+		}
+
+	private:
+		friend LeptJSON;
+
+		static constexpr unsigned null_bit = 1u << 0;
+		static constexpr unsigned boolean_bit = 1u << 1;
+		static constexpr unsigned number_bit = 1u << 2;
+		static constexpr unsigned integer_bit = 1u << 3;
+		static constexpr unsigned string_bit = 1u << 4;
+		static constexpr unsigned array_bit = 1u << 5;
+		static constexpr unsigned object_bit = 1u << 6;
+		static constexpr std::size_t none = static_cast<std::size_t>(-1);
+
+		/* subschemas refer to each other by index into nodes, the root is nodes.front() */
+		struct Node {
+			unsigned types = null_bit | boolean_bit | number_bit | integer_bit | string_bit | array_bit | object_bit;
+			std::map<std::string, std::size_t, std::less<>> properties;
+			std::vector<std::string> required;
+			std::size_t items = none;
+			std::vector<JsonValue> enumeration;
+			double minimum = -HUGE_VAL;
+			double maximum = HUGE_VAL;
+			bool exclusiveMinimum = false;
+			bool exclusiveMaximum = false;
+			std::size_t minLength = 0;
+			std::size_t maxLength = none;
+			std::size_t minItems = 0;
+			std::size_t maxItems = none;
+		};
+
+		static unsigned type_bit(std::string_view name) {
+			constexpr std::pair<std::string_view, unsigned> names[] = {
+				{ "null", null_bit }, { "boolean", boolean_bit }, { "number", number_bit | integer_bit },
+				{ "integer", integer_bit }, { "string", string_bit }, { "array", array_bit }, { "object", object_bit },
+			};
+			for (auto&& [n, bit] : names) {
+				if (n == name) return bit;
+			}
+			return 0;
+		}
+
+		static bool count(const JsonValue& v, std::size_t& out) {
+			if (v.type != ValueType::NUMBER_TYPE) return false;
+			const double d = number_value(v);
+			if (!(d >= 0) || d != std::floor(d)) return false;
+			out = d >= static_cast<double>(none) ? none : static_cast<std::size_t>(d);
+			return true;
+		}
+
+		bool compile_node(const JsonValue& schema) {
+			const auto index = nodes.size();
+			nodes.emplace_back();
+			if (schema.type == ValueType::TRUE_TYPE) return true;
+			if (schema.type == ValueType::FALSE_TYPE) {
+				nodes[index].types = 0;
+				return true;
+			}
+			if (schema.type != ValueType::OBJECT_TYPE) return false;
+			for (auto&& [keyword, value] : as_object(schema)) {
+				if (keyword == "type") {
+					unsigned types = 0;
+					if (value.type == ValueType::STRING_TYPE) {
+						types = type_bit(std::get<std::string>(value.value));
+						if (types == 0) return false;
+					}
+					else if (value.type == ValueType::ARRAY_TYPE) {
+						for (auto&& name : as_array(value)) {
+							const auto bit = name.type == ValueType::STRING_TYPE ? type_bit(std::get<std::string>(name.value)) : 0;
+							if (bit == 0) return false;
+							types |= bit;
+						}
+					}
+					else {
+						return false;
+					}
+					nodes[index].types = types;
+				}
+				else if (keyword == "properties") {
+					if (value.type != ValueType::OBJECT_TYPE) return false;
+					for (auto&& [name, subschema] : as_object(value)) {
+						const auto child = nodes.size();
+						if (!compile_node(subschema)) return false;
+						nodes[index].properties.emplace(name, child);
+					}
+				}
+				else if (keyword == "required") {
+					if (value.type != ValueType::ARRAY_TYPE) return false;
+					auto& required = nodes[index].required;
+					for (auto&& name : as_array(value)) {
+						if (name.type != ValueType::STRING_TYPE) return false;
+						/* a repeated name is required once */
+						const auto& key = std::get<std::string>(name.value);
+						if (std::find(required.begin(), required.end(), key) == required.end()) required.push_back(key);
+					}
+				}
+				else if (keyword == "items") {
+					const auto child = nodes.size();
+					if (!compile_node(value)) return false;
+					nodes[index].items = child;
+				}
+				else if (keyword == "enum") {
+					if (value.type != ValueType::ARRAY_TYPE) return false;
+					nodes[index].enumeration.assign(as_array(value).begin(), as_array(value).end());
+				}
+				else if (keyword == "minimum" || keyword == "maximum" || keyword == "exclusiveMinimum" || keyword == "exclusiveMaximum") {
+					if (value.type != ValueType::NUMBER_TYPE) return false;
+					const double bound = number_value(value);
+					auto& node = nodes[index];
+					const bool exclusive = keyword.starts_with("exclusive");
+					if (keyword == "minimum" || keyword == "exclusiveMinimum") {
+						if (bound > node.minimum || (bound == node.minimum && exclusive)) {
+							node.minimum = bound;
+							node.exclusiveMinimum = exclusive;
+						}
+					}
+					else if (bound < node.maximum || (bound == node.maximum && exclusive)) {
+						node.maximum = bound;
+						node.exclusiveMaximum = exclusive;
+					}
+				}
+				else if (keyword == "minLength") {
+					if (!count(value, nodes[index].minLength)) return false;
+				}
+				else if (keyword == "maxLength") {
+					if (!count(value, nodes[index].maxLength)) return false;
+				}
+				else if (keyword == "minItems") {
+					if (!count(value, nodes[index].minItems)) return false;
+				}
+				else if (keyword == "maxItems") {
+					if (!count(value, nodes[index].maxItems)) return false;
+				}
+			}
+			return true;
+		}
+
+		std::vector<Node> nodes = std::vector<Node>(1);		/* a default Schema is the accept-all root */
+	};
+
+private:
+
+	/*
+	 * UTF-8 validation DFA over byte classes (Unicode 3.9, table 3-7):
+	 * overlong forms, surrogates and code points above U+10FFFF all land in utf8_reject.
+	 */
+	static constexpr std::uint8_t utf8_accept = 0;
+	static constexpr std::uint8_t utf8_reject = 1;
+	static constexpr std::size_t utf8_classes = 12;
+
+	struct Utf8Dfa {
+		std::array<std::uint8_t, 256> cls;
+		std::array<std::uint8_t, 9 * utf8_classes> next;
+	};
+
+	static constexpr Utf8Dfa utf8_dfa = [] {
+		Utf8Dfa dfa{};
+		for (int c = 0x80; c <= 0x8F; c++) dfa.cls[c] = 1;
+		for (int c = 0x90; c <= 0x9F; c++) dfa.cls[c] = 2;
+		for (int c = 0xA0; c <= 0xBF; c++) dfa.cls[c] = 3;
+		for (int c = 0xC0; c <= 0xC1; c++) dfa.cls[c] = 11;
+		for (int c = 0xC2; c <= 0xDF; c++) dfa.cls[c] = 4;
+		dfa.cls[0xE0] = 5;
+		for (int c = 0xE1; c <= 0xEF; c++) dfa.cls[c] = 6;
+		dfa.cls[0xED] = 7;
+		dfa.cls[0xF0] = 8;
+		for (int c = 0xF1; c <= 0xF3; c++) dfa.cls[c] = 9;
+		dfa.cls[0xF4] = 10;
+		for (int c = 0xF5; c <= 0xFF; c++) dfa.cls[c] = 11;
+
+		/* states: 2 = one trail byte left, 3 = after E0, 4 = two left, 5 = after ED, 6 = after F0, 7 = three left, 8 = after F4 */
+		for (auto& n : dfa.next) n = utf8_reject;
+		auto set = [&](int state, int cls, int to) { dfa.next[state * utf8_classes + cls] = static_cast<std::uint8_t>(to); };
+		set(utf8_accept, 0, utf8_accept);
+		set(utf8_accept, 4, 2);
+		set(utf8_accept, 5, 3);
+		set(utf8_accept, 6, 4);
+		set(utf8_accept, 7, 5);
+		set(utf8_accept, 8, 6);
+		set(utf8_accept, 9, 7);
+		set(utf8_accept, 10, 8);
+		for (int cls = 1; cls <= 3; cls++) {
+			set(2, cls, utf8_accept);
+			set(4, cls, 2);
+			set(7, cls, 4);
+		}
+		set(3, 3, 2);
+		set(5, 1, 2);
+		set(5, 2, 2);
+		set(6, 2, 4);
+		set(6, 3, 4);
+		set(8, 1, 4);
+		return dfa;
+	}();
+
+	std::string_view json;
+	ParseFlag parseFlags = ParseFlag::PARSE_DEFAULT;
+	std::size_t parallelThreshold = std::size_t{ 1 } << 20;
+	std::size_t parallelStringifyThreshold = std::size_t{ 1 } << 14;
+	std::string skipBuffer;
+	const Projection::Node* projection = nullptr;		/* members to build below the current object, nullptr builds all */
+	Segments* segments = nullptr;		/* set during stringify_segments() */
+	std::string schemaPath;		/* pointer to the value being validated, kept after PARSE_SCHEMA_VIOLATION */
+
+#ifdef LEPTJSON_ENABLE_STATS
+	Stats stats{};
+	std::size_t statDepth = 0;
+	std::size_t statCapacity = 0;
+
+	struct StatTimer {
+		std::chrono::nanoseconds& total;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		~StatTimer() { total += std::chrono::steady_clock::now() - start; }
+	};
+
+	struct StatDepth {
+		LeptJSON& self;
+
+		explicit StatDepth(LeptJSON& j) : self(j) {
+			if (++self.statDepth > self.stats.max_depth) self.stats.max_depth = self.statDepth;
+		}
+
+		~StatDepth() { --self.statDepth; }
+	};
+
+	void stat_node(ValueType type) {
+		++stats.nodes[static_cast<std::size_t>(type)];
+	}
+
+	void stat_growth(std::size_t before, std::size_t after, std::size_t element_size) {
+		if (after != before) {
+			++stats.allocations;
+			stats.allocated_bytes += after * element_size;
+		}
+	}
+
+	void stat_begin() {
+		stats = Stats{};
+		statDepth = 0;
+		statCapacity = std::string{}.capacity();
+	}
+
+	void stat_end(std::chrono::steady_clock::time_point start) {
+		stats.container_time = std::chrono::steady_clock::now() - start - stats.string_time - stats.number_time;
+	}
+
+	void stat_merge(const Stats& rhs) {
+		for (std::size_t i = 0; i < stats.nodes.size(); i++) stats.nodes[i] += rhs.nodes[i];
+		stats.allocations += rhs.allocations;
+		stats.allocated_bytes += rhs.allocated_bytes;
+		stats.max_depth = std::max(stats.max_depth, rhs.max_depth + 1);
+		stats.string_time += rhs.string_time;
+		stats.number_time += rhs.number_time;
+	}
+#endif
+
+	/*
+	 * Work-stealing pool: every worker owns a deque, pops its own tasks from the back
+	 * and steals from the front of the others when it runs dry.
+	 */
+	class ThreadPool {
+	public:
+		explicit ThreadPool(unsigned threads) : queues(threads) {
+			for (auto& queue : queues) queue = std::make_unique<Queue>();
+			for (unsigned i = 0; i < threads; i++) {
+				workers.emplace_back([this, i] { work(i); });
+			}
+		}
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		~ThreadPool() {
+			{
+				std::lock_guard lock(mutex);
+				stop = true;
+			}
+			wake.notify_all();
+			for (auto& worker : workers) worker.join();
+		}
+
+		static ThreadPool& instance() {
+			static ThreadPool pool(std::max(2u, std::thread::hardware_concurrency()));
+			return pool;
+		}
+
+		[[nodiscard]] std::size_t size() const {
+			return workers.size();
+		}
+
+		/* runs task(i) for every i in [0, n); the calling thread helps until all of them are done */
+		template<class F>
+		void parallel_for(std::size_t n, F&& task) {
+			std::size_t remaining = n;
+			std::mutex doneMutex;
+			std::condition_variable done;
+			for (std::size_t i = 0; i < n; i++) {
+				push(i % queues.size(), [&, i] {
+					task(i);
+					std::lock_guard lock(doneMutex);
+					if (--remaining == 0) done.notify_all();
+				});
+			}
+			while (true) {
+				if (run_one(queues.size())) continue;
+				std::unique_lock lock(doneMutex);
+				if (remaining == 0) break;
+				done.wait(lock);
+			}
+		}
+
+	private:
+		struct Queue {
+			std::mutex mutex;
+			std::deque<std::function<void()>> tasks;
+		};
+
+		std::vector<std::unique_ptr<Queue>> queues;
+		std::vector<std::thread> workers;
+		std::mutex mutex;
+		std::condition_variable wake;
+		std::atomic<std::size_t> queued{ 0 };
+		bool stop = false;
+
+		void push(std::size_t index, std::function<void()> task) {
+			{
+				std::lock_guard lock(queues[index]->mutex);
+				queues[index]->tasks.push_back(std::move(task));
+			}
+			{
+				std::lock_guard lock(mutex);
+				++queued;
+			}
+			wake.notify_one();
+		}
+
+		/* own queue first (newest task), then steal the oldest task of another queue */
+		bool run_one(std::size_t self) {
+			std::function<void()> task;
+			for (std::size_t i = 0; i <= queues.size() && !task; i++) {
+				const bool own = i == 0;
+				if (own && self >= queues.size()) continue;
+				auto& queue = *queues[own ? self : (self + i) % queues.size()];
+				std::lock_guard lock(queue.mutex);
+				if (queue.tasks.empty()) continue;
+				if (own) {
+					task = std::move(queue.tasks.back());
+					queue.tasks.pop_back();
+				}
+				else {
+					task = std::move(queue.tasks.front());
+					queue.tasks.pop_front();
+				}
+			}
+			if (!task) return false;
+			--queued;
+			task();
+			return true;
+		}
+
+		void work(std::size_t self) {
+			while (true) {
+				if (run_one(self)) continue;
+				std::unique_lock lock(mutex);
+				wake.wait(lock, [this] { return stop || queued != 0; });
+				if (stop && queued == 0) return;
+			}
+		}
+	};
+
+	static constexpr std::size_t stream_block_size = std::size_t{ 1 } << 17;
+
+	/* bounded hand-off of text blocks from the reading thread to the parsing thread of parse_stream() */
+	class BlockQueue {
+	public:
+		/* waits for room, false once the parser has closed the queue */
+		bool push(std::string block) {
+			std::unique_lock lock(mutex);
+			changed.wait(lock, [this] { return closed || blocks.size() < capacity; });
+			if (closed) return false;
+			blocks.push_back(std::move(block));
+			changed.notify_all();
+			return true;
+		}
+
+		/* waits for a block, false at the end of the input; status() then tells how it ended */
+		bool pop(std::string& block) {
+			std::unique_lock lock(mutex);
+			changed.wait(lock, [this] { return !blocks.empty() || finished; });
+			if (blocks.empty()) return false;
+			block = std::move(blocks.front());
+			blocks.pop_front();
+			changed.notify_all();
+			return true;
+		}
+
+		void finish(Status status) {
+			std::lock_guard lock(mutex);
+			finished = true;
+			result = status;
+			changed.notify_all();
+		}
+
+		void close() {
+			std::lock_guard lock(mutex);
+			closed = true;
+			changed.notify_all();
+		}
+
+		[[nodiscard]] Status status() const {
+			std::lock_guard lock(mutex);
+			return result;
+		}
+
+	private:
+		static constexpr std::size_t capacity = 4;
+
+		mutable std::mutex mutex;
+		std::condition_variable changed;
+		std::deque<std::string> blocks;
+		Status result = Status::PARSE_OK;
+		bool finished = false;
+		bool closed = false;
+	};
+
+public:
+	LeptJSON(std::string_view js = "", ValueType vt = ValueType::NULL_TYPE)
+		: jsonValue(jsonValueType{}, vt), json(js) {}
+
+	LeptJSON(const LeptJSON& rhs) = default;
+
+	LeptJSON(LeptJSON&& rhs) noexcept : jsonValue(std::move(rhs.jsonValue)), json(rhs.json) {}
+
+	LeptJSON& operator=(const LeptJSON& rhs) {
+		if (this != &rhs) {
+			jsonValue = rhs.jsonValue;
+			json = rhs.json;
+		}
+		return *this;
+	}
+
+	LeptJSON& operator=(LeptJSON&& rhs) noexcept {
+		if (this != &rhs) {
+			jsonValue = std::move(rhs.jsonValue);
+			json = rhs.json;
+		}
+		return *this;
+	}
+
+	[[nodiscard]] ValueType get_type() const {
+		return jsonValue.type;
+	}
+
+	/* consistent with operator==, also through std::hash<LeptJSON> */
+	[[nodiscard]] std::size_t hash() const {
+		return hash_value(jsonValue);
+	}
+
+	friend LEPTJSON_API bool operator==(const LeptJSON& lhs, const LeptJSON& rhs);
+
+	[[nodiscard]] JsonValue get_value() const& {
+		return jsonValue;
+	}
+
+	[[nodiscard]] JsonValue get_value()&& {
+		return std::move(jsonValue);
+	}
+
+	void set_json(const char* js) {
+		json = js;
+	}
+
+	void set_json(std::string_view js) {
+		json = js;
+	}
+
+	void set_nullptr() {
+		jsonValue = { nullptr, ValueType::NULL_TYPE };
+	}
+
+	[[nodiscard]] bool get_boolean() const {
+		assert(jsonValue.type == ValueType::TRUE_TYPE || jsonValue.type == ValueType::FALSE_TYPE);
+		return std::get<bool>(jsonValue.value);
+	}
+
+	void set_boolean(bool b) {
+		jsonValue = { b, b ? ValueType::TRUE_TYPE : ValueType::FALSE_TYPE };
+	}
+
+	[[nodiscard]] double get_number() const {
+		return number_value(jsonValue);
+	}
+
+	/* exact for integer text kept by PARSE_LAZY_NUMBERS, otherwise the double truncated and clamped */
+	[[nodiscard]] std::int64_t get_int64() const {
+		return number_int64(jsonValue);
+	}
+
+	void set_number(double number) {
+		jsonValue = { number, ValueType::NUMBER_TYPE };
+	}
+
+	[[nodiscard]] std::string_view get_string() const {
+		assert(jsonValue.type == ValueType::STRING_TYPE);
+		return std::string_view{ std::get<std::string>(jsonValue.value).data(),
+								std::get<std::string>(jsonValue.value).size() };
+	}
+
+	void set_string(const char* str) {
+		jsonValue = { std::string{str}, ValueType::STRING_TYPE };
+	}
+
+	void set_string(std::string_view str) {
+		jsonValue = { std::string{str}, ValueType::STRING_TYPE };
+	}
+
+	void set_string(std::string&& str) {
+		jsonValue = { std::move(str), ValueType::STRING_TYPE };
+	}
+
+	[[nodiscard]] const json_array_type& get_array() const {
+		return as_array(jsonValue);
+	}
+
+	/* clones the array first if another copy still shares it */
+	json_array_type& get_array() {
+		return detach_array(jsonValue);
+	}
+
+	void set_array(const json_array_type& arr) {
+		jsonValue = { arr, ValueType::ARRAY_TYPE };
+	}
+
+	void set_array(json_array_type&& arr) {
+		jsonValue = { std::move(arr), ValueType::ARRAY_TYPE };
+	}
+
+	/* true for an array the parser stored as contiguous doubles, see get_numbers() */
+	[[nodiscard]] bool is_number_array() const {
+		return as_numbers(jsonValue) != nullptr;
+	}
+
+	/* the elements of a number array without building a JsonValue for each, valid until the next write */
+	[[nodiscard]] std::span<const double> get_numbers() const {
+		assert(is_number_array());
+		return *as_numbers(jsonValue);
+	}
+
+	void set_numbers(const std::vector<double>& numbers) {
+		jsonValue = { json_numbers_type(numbers.begin(), numbers.end()), ValueType::ARRAY_TYPE };
+	}
+
+	[[nodiscard]] const json_object_type& get_object() const {
+		return as_object(jsonValue);
+	}
+
+	/* clones the object first if another copy still shares it */
+	json_object_type& get_object() {
+		return detach_object(jsonValue);
+	}
+
+	void set_object(const json_object_type& obj) {
+		jsonValue = { obj, ValueType::OBJECT_TYPE };
+	}
+
+	void set_object(json_object_type&& obj) {
+		jsonValue = { std::move(obj), ValueType::OBJECT_TYPE };
+	}
+
+	/*
+	 * In-place builders. A null value becomes an empty array (reserve, push_back, emplace_back) or
+	 * object (emplace, insert_or_assign) on first use. Elements may be given as JsonValue, LeptJSON,
+	 * nullptr, bool, any arithmetic type, strings, or whole containers; rvalues are moved in.
+	 */
+	void reserve(std::size_t n) {
+		array_for_write(false).reserve(n);
+	}
+
+	void push_back(const JsonValue& value) {
+		array_for_write(false).push_back(value);
+	}
+
+	void push_back(JsonValue&& value) {
+		array_for_write(false).push_back(std::move(value));
+	}
+
+	template <typename T>
+	JsonValue& emplace_back(T&& value) {
+		return array_for_write().emplace_back(make_value(std::forward<T>(value)));
+	}
+
+	template <typename K, typename T>
+	std::pair<json_object_type::iterator, bool> emplace(K&& key, T&& value) {
+		return object_for_write().try_emplace(make_key(std::forward<K>(key)), make_value(std::forward<T>(value)));
+	}
+
+	template <typename K, typename T>
+	std::pair<json_object_type::iterator, bool> insert_or_assign(K&& key, T&& value) {
+		return object_for_write().insert_or_assign(make_key(std::forward<K>(key)), make_value(std::forward<T>(value)));
+	}
+
+	Status parse(ParseFlag flags = ParseFlag::PARSE_DEFAULT);
+
+	/*
+	 * parse() that builds only the members on the selected paths, plus the containers leading to them.
+	 * Everything else is validated and skipped without allocating nodes. PARSE_PARALLEL is ignored.
+	 */
+	Status parse(const Projection& selected, ParseFlag flags = ParseFlag::PARSE_DEFAULT) {
+		projection = selected.root.whole ? nullptr : &selected.root;
+		const auto ret = parse(static_cast<ParseFlag>(static_cast<unsigned>(flags) & ~static_cast<unsigned>(ParseFlag::PARSE_PARALLEL)));
+		projection = nullptr;
+		return ret;
+	}
+
+	/*
+	 * parse() that validates against schema as it goes. A value of a disallowed type is rejected at its
+	 * first byte, other constraints as soon as the value is complete, so a bad payload stops the parse
+	 * early and leaves a null tree. PARSE_PARALLEL is ignored.
+	 */
+	Status parse(const Schema& schema, ParseFlag flags = ParseFlag::PARSE_DEFAULT) {
+		parseFlags = flags;
+		schemaPath.clear();
+		jsonValue = { nullptr, ValueType::NULL_TYPE };
+		if (schema.nodes.empty()) return Status::SCHEMA_INVALID;	/* moved from */
+		parse_whitespace();
+		auto ret = json.empty() || json.starts_with('\0') ? Status::PARSE_EXPECT_VALUE : parse_checked(schema, schema.nodes.front());
+		if (ret == Status::PARSE_OK) {
+			parse_whitespace();
+			if (!json.empty() && !json.starts_with('\0')) ret = Status::PARSE_ROOT_NOT_SINGULAR;
+		}
+		if (ret != Status::PARSE_OK) jsonValue = { nullptr, ValueType::NULL_TYPE };
+		if (ret != Status::PARSE_SCHEMA_VIOLATION) schemaPath.clear();
+		return ret;
+	}
+
+	/* RFC 6901 pointer to the value that failed the last parse(const Schema&), empty for the root */
+	[[nodiscard]] const std::string& get_schema_error_path() const {
+		return schemaPath;
+	}
+
+	/*
+	 * parse() over text that arrives in blocks. next_block runs on a thread of its own, ahead of the
+	 * parse: it fills its argument with the next block and returns PARSE_OK, an empty block ends the
+	 * input and any other status aborts with that status. Values are parsed as soon as their text is
+	 * complete and the text is dropped, so the document is never held as text in full; statuses are
+	 * those parse() gives for the whole text. PARSE_PARALLEL is ignored.
+	 */
+	Status parse_stream(const std::function<Status(std::string&)>& next_block, ParseFlag flags = ParseFlag::PARSE_DEFAULT) {
+		BlockQueue blocks;
+		std::thread producer([&] {
+			auto ret = Status::PARSE_OK;
+			while (true) {
+				std::string block;
+				ret = next_block(block);
+				if (ret != Status::PARSE_OK || block.empty() || !blocks.push(std::move(block))) break;
+			}
+			blocks.finish(ret);
+		});
+		auto ret = parse_blocks(blocks, static_cast<ParseFlag>(static_cast<unsigned>(flags) & ~static_cast<unsigned>(ParseFlag::PARSE_PARALLEL)));
+		if (ret != Status::PARSE_OK && blocks.status() != Status::PARSE_OK) ret = blocks.status();	/* text cut short by a failing source */
+		blocks.close();
+		producer.join();
+		json = {};
+		if (ret != Status::PARSE_OK) jsonValue = { nullptr, ValueType::NULL_TYPE };
+		return ret;
+	}
+
+#ifdef LEPTJSON_WITH_ZLIB
+	/* gzip or zlib file, inflated while it is parsed; plain text is read as is */
+	Status parse_gzip(const char* path, ParseFlag flags = ParseFlag::PARSE_DEFAULT) {
+		gzFile file = gzopen(path, "rb");
+		if (file == nullptr) return Status::PARSE_INVALID_COMPRESSED;
+		gzbuffer(file, stream_block_size);
+		const auto ret = parse_stream([file](std::string& block) {
+			block.resize(stream_block_size);
+			const int n = gzread(file, block.data(), static_cast<unsigned>(block.size()));
+			int error = Z_OK;
+			if (n < 0 || (n == 0 && (gzerror(file, &error), error != Z_OK))) return Status::PARSE_INVALID_COMPRESSED;
+			block.resize(static_cast<std::size_t>(n));
+			return Status::PARSE_OK;
+		}, flags);
+		gzclose(file);
+		return ret;
+	}
+#endif
+
+#ifdef LEPTJSON_WITH_ZSTD
+	/* zstd file, decompressed while it is parsed; a truncated frame is PARSE_INVALID_COMPRESSED */
+	Status parse_zstd(const char* path, ParseFlag flags = ParseFlag::PARSE_DEFAULT) {
+		std::FILE* file = std::fopen(path, "rb");
+		if (file == nullptr) return Status::PARSE_INVALID_COMPRESSED;
+		ZSTD_DStream* stream = ZSTD_createDStream();
+		if (stream == nullptr) {
+			std::fclose(file);
+			return Status::PARSE_INVALID_COMPRESSED;
+		}
+		std::vector<char> input(ZSTD_DStreamInSize());
+		ZSTD_inBuffer in{ input.data(), 0, 0 };
+		std::size_t hint = 0;		/* 0 once a frame is complete */
+		bool end = false;
+		const auto ret = parse_stream([&](std::string& block) {
+			block.resize(ZSTD_DStreamOutSize());
+			ZSTD_outBuffer out{ block.data(), block.size(), 0 };
+			while (out.pos == 0) {
+				if (in.pos == in.size && !end) {
+					in.size = std::fread(input.data(), 1, input.size(), file);
+					in.pos = 0;
+					end = in.size == 0;
+					if (end && std::ferror(file)) return Status::PARSE_INVALID_COMPRESSED;
+				}
+				if (end && hint == 0) {
+					block.clear();
+					return Status::PARSE_OK;
+				}
+				hint = ZSTD_decompressStream(stream, &out, &in);
+				if (ZSTD_isError(hint) || (out.pos == 0 && end)) return Status::PARSE_INVALID_COMPRESSED;
+			}
+			block.resize(out.pos);
+			return Status::PARSE_OK;
+		}, flags);
+		ZSTD_freeDStream(stream);
+		std::fclose(file);
+		return ret;
+	}
+#endif
+
+	/*
+	 * Parses straight into T without building a tree. T may be bool, an arithmetic type,
+	 * std::string, LeptJSON, std::optional, std::vector, a map keyed by std::string, or a
+	 * struct bound with LEPTJSON_DESCRIBE. Unknown keys are validated and skipped.
+	 */
+	template <typename T>
+	Status parse_into(T& out, ParseFlag flags = ParseFlag::PARSE_DEFAULT) {
+		parseFlags = flags;
+		parse_whitespace();
+		auto ret = json.empty() || json.starts_with('\0') ? Status::PARSE_EXPECT_VALUE : read(out);
+		if (ret == Status::PARSE_OK) {
+			parse_whitespace();
+			if (!json.empty() && !json.starts_with('\0')) {
+				ret = Status::PARSE_ROOT_NOT_SINGULAR;
+			}
+		}
+		jsonValue = { nullptr, ValueType::NULL_TYPE };
+		return ret;
+	}
+
+	/* struct members in declaration order, an empty std::optional member is left out */
+	template <typename T>
+	static std::string stringify_from(const T& in) {
+		LeptJSON writer;
+		std::string s;
+		writer.write(s, in);
+		return s;
+	}
+
+	std::string stringify(StringifyFlag flags = StringifyFlag::STRINGIFY_DEFAULT);
+
+	/*
+	 * stringify() as segments for writev() or sendmsg(). Strings of at least min_reference bytes with
+	 * nothing to escape are referenced where the tree holds them instead of being copied; the quotes
+	 * and everything else go to a scratch buffer. STRINGIFY_PARALLEL is not supported here.
+	 */
+	Segments stringify_segments(std::size_t min_reference = 1024) {
+		LEPTJSON_STAT(stat_begin(); const auto start = std::chrono::steady_clock::now());
+		Segments out;
+		out.minReference = std::max<std::size_t>(min_reference, 1);
+		segments = &out;
+		stringify_value(out.scratch, jsonValue);
+		segments = nullptr;
+		if (out.scratch.size() > out.scratchEnd) out.pieces.push_back({ nullptr, out.scratchEnd, out.scratch.size() - out.scratchEnd });
+		LEPTJSON_STAT(stats.bytes = out.size(); stat_end(start));
+		return out;
+	}
+
+	/* parallel stringify() as the ordered list of per-task buffers, without the final concatenation */
+	std::vector<std::string> stringify_chunks() {
+		LEPTJSON_STAT(stat_begin(); const auto start = std::chrono::steady_clock::now());
+		auto pieces = stringify_pieces();
+		LEPTJSON_STAT(for (auto&& piece : pieces) stats.bytes += piece.size(); stat_end(start));
+		return pieces;
+	}
+
+	/* MessagePack and CBOR encodings of the tree, integral numbers are written as integers */
+	[[nodiscard]] std::string to_msgpack() const {
+		std::string out;
+		msgpack_value(out, jsonValue);
+		return out;
+	}
+
+	Status from_msgpack(std::string_view bytes) {
+		return from_binary(bytes, &msgpack_decode);
+	}
+
+	[[nodiscard]] std::string to_cbor() const {
+		std::string out;
+		cbor_value(out, jsonValue);
+		return out;
+	}
+
+	/* tags are accepted and dropped, byte strings and simple values other than false/true/null/undefined are rejected */
+	Status from_cbor(std::string_view bytes) {
+		return from_binary(bytes, &cbor_decode);
+	}
+
+	/* flat snapshot for TapeView, relocatable so it can be written out and mapped back with MappedFile */
+	[[nodiscard]] std::string to_tape() const {
+		TapeWriter writer;
+		writer.value(jsonValue);
+		std::string out;
+		out.reserve((TapeView::header_words + writer.words.size()) * 8 + writer.strings.size());
+		out.append(TapeView::magic, sizeof(TapeView::magic));
+		put_little_endian(out, TapeView::version);
+		put_little_endian(out, writer.words.size());
+		put_little_endian(out, writer.strings.size());
+		for (auto w : writer.words) put_little_endian(out, w);
+		out += writer.strings;
+		return out;
+	}
+
+	/* compacted read-only copy for sharing across threads, see Frozen; from_tape(root()) thaws it */
+	[[nodiscard]] std::shared_ptr<const Frozen> freeze() const {
+		TapeWriter writer;
+		writer.value(jsonValue);
+		const auto nodeWords = writer.words.size();
+		std::vector<std::uint64_t> storage(nodeWords + (writer.strings.size() + 7) / 8);
+		std::transform(writer.words.begin(), writer.words.end(), storage.begin(), TapeView::little_endian);
+		std::memcpy(storage.data() + nodeWords, writer.strings.data(), writer.strings.size());
+		return std::shared_ptr<const Frozen>(new Frozen(std::move(storage), nodeWords));
+	}
+
+	/* copies a tape back into the tree, bytes must be 8-byte aligned like a mapping or heap buffer */
+	Status from_tape(std::string_view bytes) {
+		TapeView view;
+		const auto ret = TapeView::load(bytes, view);
+		jsonValue = ret == Status::PARSE_OK ? tape_value(view) : JsonValue{ nullptr, ValueType::NULL_TYPE };
+		return ret;
+	}
+
+	/* copies any tape, such as an embed() document, into a mutable tree */
+	void from_tape(TapeView view) {
+		jsonValue = tape_value(view);
+	}
+
+	/*
+	 * Tape of a JSON literal built entirely during compilation, so the document is constant-initialized
+	 * and costs nothing at startup; text that does not parse fails to compile. Members stay in source order.
+	 */
+	template <FixedString Text>
+	[[nodiscard]] static constexpr TapeView embed() {
+		return { embedded<Text>.words.data(), embedded<Text>.strings.data() };
+	}
+
+	/*
+	 * RFC 6902 JSON Patch, patch is an array of operations and PARSE_OK means all of them applied.
+	 * Only the paths an operation touches are cloned. A single operation runs in place; a longer
+	 * patch runs on a copy-on-write copy that is kept only when every operation succeeds, so a
+	 * failing patch leaves the document unchanged either way.
+	 */
+	Status apply_patch(const LeptJSON& patch) {
+		const JsonValue ops = patch.jsonValue;
+		if (ops.type != ValueType::ARRAY_TYPE) return Status::PATCH_INVALID_OPERATION;
+		const auto& list = as_array(ops);
+		if (list.size() == 1) return patch_operation(jsonValue, list.front());
+		JsonValue doc = jsonValue;
+		for (auto&& op : list) {
+			if (const auto ret = patch_operation(doc, op); ret != Status::PARSE_OK) return ret;
+		}
+		jsonValue = std::move(doc);
+		return Status::PARSE_OK;
+	}
+
+	/* RFC 7386 JSON Merge Patch: objects merge member by member, null removes, anything else replaces */
+	void apply_merge_patch(const LeptJSON& patch) {
+		merge_patch(jsonValue, JsonValue(patch.jsonValue));
+	}
+
+	/*
+	 * JSON Patch that turns this document into target: add, remove and replace only, recursing into
+	 * containers of the same kind and trimming the common ends of arrays. Both trees are hashed first,
+	 * so comparing two differing subtrees stops at their kept hashes and each level costs O(1) per
+	 * child; only equal subtrees, and those exposed for writing (see cached_hash()), are walked.
+	 */
+	[[nodiscard]] LeptJSON diff(const LeptJSON& target) const {
+		hash_value(jsonValue);
+		hash_value(target.jsonValue);
+		json_array_type ops;
+		std::string path;
+		diff_value(ops, path, jsonValue, target.jsonValue);
+		LeptJSON patch;
+		patch.jsonValue = { std::move(ops), ValueType::ARRAY_TYPE };
+		return patch;
+	}
+
+	/* values selected by path, members in key order, valid until the tree is next modified */
+	[[nodiscard]] std::vector<const JsonValue*> query(const JsonPath& path) const {
+		std::vector<const JsonValue*> matches;
+		query_value(path, jsonValue, 1, matches);
+		return matches;
+	}
+
+	/*
+	 * The same query straight over text, matches are the text of each selected value in source order. The whole input
+	 * is validated, but subtrees no step can reach are skipped without building anything; only filters
+	 * look into a candidate twice, once to test it and once to descend into it.
+	 */
+	static Status query(std::string_view text, const JsonPath& path, std::vector<std::string_view>& matches,
+		ParseFlag flags = ParseFlag::PARSE_DEFAULT) {
+		LeptJSON scanner(text);
+		scanner.parseFlags = flags;
+		matches.clear();
+		scanner.parse_whitespace();
+		auto ret = scanner.json.empty() || scanner.json.starts_with('\0') ? Status::PARSE_EXPECT_VALUE : scanner.query_text(path, 1, matches);
+		if (ret == Status::PARSE_OK) {
+			scanner.parse_whitespace();
+			if (!scanner.json.empty() && !scanner.json.starts_with('\0')) ret = Status::PARSE_ROOT_NOT_SINGULAR;
+		}
+		if (ret != Status::PARSE_OK) matches.clear();
+		return ret;
+	}
+
+#ifdef LEPTJSON_ENABLE_STATS
+	[[nodiscard]] const Stats& get_stats() const {
+		return stats;
+	}
+#endif
+
+	void swap(LeptJSON& rhs) {
+		std::swap(jsonValue, rhs.jsonValue);
+		std::swap(json, rhs.json);
+	}
+
+	/* smallest input, in bytes, that PARSE_PARALLEL splits across threads */
+	void set_parallel_threshold(std::size_t bytes) {
+		parallelThreshold = bytes;
+	}
+
+	/* smallest subtree, in nodes, that STRINGIFY_PARALLEL serializes as a task of its own */
+	void set_parallel_stringify_threshold(std::size_t nodes) {
+		parallelStringifyThreshold = std::max<std::size_t>(nodes, 1);
+	}
+
+private:
+	/*
+	 * Parsing side of parse_stream(). Each value is parsed whole with parse_value() once its text has
+	 * arrived; a container still open at the end of the text received so far is entered instead and
+	 * its elements are parsed one by one, like the root and its children always are. A parse that
+	 * fails or may continue within a few bytes of the end is retried once more text is in.
+	 */
+	Status parse_blocks(BlockQueue& blocks, ParseFlag flags) {
+		struct Frame {
+			bool members;
+			bool first = true;		/* nothing read after the opening bracket yet */
+			bool after = false;		/* an element ended, a comma or the closing bracket follows */
+			std::string key;
+			json_array_type array;
+			json_object_type object;
+
+			explicit Frame(bool members) : members(members) {}
+		};
+		constexpr std::size_t lookahead = 12;	/* longest text a scalar needs to be judged, \uXXXX\uXXXX */
+		parseFlags = flags;
+		std::vector<Frame> frames;
+		std::string text, block;
+		std::size_t pos = 0;
+		bool more = true, done = false;
+		auto fill = [&] {
+			if (!more) return false;
+			if (pos >= text.size() / 2) {
+				text.erase(0, pos);
+				pos = 0;
+			}
+			more = blocks.pop(block);
+			if (more) text += block;
+			return more;
+		};
+		/* moves json to the next token, false at the end of the input */
+		auto token = [&] {
+			while (true) {
+				json = std::string_view(text).substr(pos);
+				parse_whitespace();
+				pos = text.size() - json.size();
+				if (!json.empty() || !fill()) return !json.empty() && !json.starts_with('\0');
+			}
+		};
+		auto attach = [&](JsonValue&& value) {
+			if (frames.empty()) {
+				jsonValue = std::move(value);
+				done = true;
+				return;
+			}
+			auto& frame = frames.back();
+			if (frame.members) frame.object.append(std::move(frame.key), std::move(value));
+			else frame.array.push_back(std::move(value));
+			frame.after = true;
+		};
+		/* what the end of the input means in the current state */
+		auto end = [&] {
+			if (blocks.status() != Status::PARSE_OK) return blocks.status();
+			if (frames.empty()) return done ? Status::PARSE_OK : Status::PARSE_EXPECT_VALUE;
+			const auto& frame = frames.back();
+			if (!frame.members) return Status::PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+			return frame.after ? Status::PARSE_MISS_COMMA_OR_CURLY_BRACKET : Status::PARSE_MISS_KEY;
+		};
+		while (true) {
+			if (!token()) return end();
+			if (frames.empty() && done) return Status::PARSE_ROOT_NOT_SINGULAR;
+			if (!frames.empty()) {
+				auto& frame = frames.back();
+				const char close = frame.members ? '}' : ']';
+				if ((frame.first || frame.after) && json[0] == close) {
+					++pos;
+					if (frame.members) frame.object.sort();
+					auto value = frame.members ? JsonValue{ std::move(frame.object), ValueType::OBJECT_TYPE } : splice_elements(std::span(&frame.array, 1));
+					frames.pop_back();
+					attach(std::move(value));
+					continue;
+				}
+				if (frame.after) {
+					if (json[0] != ',') return frame.members ? Status::PARSE_MISS_COMMA_OR_CURLY_BRACKET : Status::PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+					++pos;
+					frame.after = false;
+					if (!token()) return end();
+				}
+				frame.first = false;
+				if (frame.members) {
+					if (json[0] != '\"') return Status::PARSE_MISS_KEY;
+					while (true) {
+						json = std::string_view(text).substr(pos);
+						frame.key.clear();
+						const auto ret = parse_string_raw(frame.key);
+						if (ret == Status::PARSE_OK) break;
+						if (json.size() >= lookahead || !fill()) return ret;
+					}
+					pos = text.size() - json.size();
+					if (!token() || json[0] != ':') return Status::PARSE_MISS_COLON;
+					++pos;
+					if (!token()) return blocks.status() != Status::PARSE_OK ? blocks.status() : Status::PARSE_EXPECT_VALUE;
+				}
+			}
+			const char first = json[0];
+			if ((first == '[' || first == '{') && frames.size() < 2) {
+				++pos;
+				frames.emplace_back(first == '{');
+				continue;
+			}
+			while (true) {
+				json = std::string_view(text).substr(pos);
+				const auto ret = parse_value();
+				const bool open = more && json.size() < lookahead;
+				if (ret == Status::PARSE_OK && !(open && json.empty() && first != '[' && first != '{' && first != '\"')) {
+					pos = text.size() - json.size();
+					attach(std::move(jsonValue));
+					break;
+				}
+				if (ret != Status::PARSE_OK && !open) return ret;
+				if (ret != Status::PARSE_OK && (first == '[' || first == '{')) {
+					++pos;
+					frames.emplace_back(first == '{');
+					break;
+				}
+				fill();
+			}
+		}
+	}
+
+	/*
+	 * Finds the element boundaries of the top-level array by matching brackets and skipping
+	 * strings, parses groups of elements concurrently and splices them together in order.
+	 * Returns false, leaving the input untouched, when the input is too small or any chunk
+	 * fails; the sequential parser then runs and reports the error.
+	 */
+	bool parse_array_parallel() {
+		if (!json.starts_with('[') || json.size() < parallelThreshold) {
+			return false;
+		}
+		std::vector<std::size_t> commas;
+		std::size_t end{};
+		if (!scan_array(json, commas, end)) {
+			return false;
+		}
+
+		auto& pool = ThreadPool::instance();
+		const std::size_t target = std::max<std::size_t>(end / (pool.size() * 4), 1);
+		std::vector<std::pair<std::size_t, std::size_t>> chunks;
+		std::size_t begin = 1;
+		for (auto comma : commas) {
+			if (comma - begin >= target) {
+				chunks.emplace_back(begin, comma);
+				begin = comma + 1;
+			}
+		}
+		chunks.emplace_back(begin, end);
+
+		std::vector<json_array_type> parts(chunks.size());
+		std::vector<Status> results(chunks.size());
+		LEPTJSON_STAT(std::vector<Stats> partStats(chunks.size()));
+		pool.parallel_for(chunks.size(), [&](std::size_t i) {
+			LeptJSON part(json.substr(chunks[i].first, chunks[i].second - chunks[i].first));
+			part.parseFlags = parseFlags;
+			LEPTJSON_STAT(part.stat_begin());
+			results[i] = part.parse_elements(parts[i]);
+			LEPTJSON_STAT(partStats[i] = part.stats);
+		});
+		if (std::any_of(results.begin(), results.end(), [](Status ret) { return ret != Status::PARSE_OK; })) {
+			return false;
+		}
+
+		jsonValue = splice_elements(parts);
+		LEPTJSON_STAT(for (auto&& part : partStats) stat_merge(part));
+		LEPTJSON_STAT(stat_node(ValueType::ARRAY_TYPE));
+		LEPTJSON_STAT(stat_growth(0, element_count(jsonValue), as_numbers(jsonValue) ? sizeof(double) : sizeof(JsonValue)));
+		json.remove_prefix(end + 1);
+		return true;
+	}
+
+	/*
+	 * One array from elements parsed in parts, in order. Elements that are all numbers make a
+	 * NumberArray, as parse_array() picks, so the storage does not depend on how it was parsed.
+	 */
+	JsonValue splice_elements(std::span<json_array_type> parts) const {
+		std::size_t size = 0;
+		for (auto&& part : parts) size += part.size();
+		const auto number = [](const JsonValue& value) { return std::holds_alternative<double>(value.value); };
+		if (size != 0 && !has_flag(ParseFlag::PARSE_LAZY_NUMBERS)
+			&& std::ranges::all_of(parts, [&number](const json_array_type& part) { return std::ranges::all_of(part, number); })) {
+			json_numbers_type numbers;
+			numbers.reserve(size);
+			for (auto&& part : parts) {
+				for (auto&& value : part) numbers.push_back(std::get<double>(value.value));
+			}
+			return { std::move(numbers), ValueType::ARRAY_TYPE };
+		}
+		if (parts.size() == 1) return { std::move(parts.front()), ValueType::ARRAY_TYPE };
+		json_array_type v;
+		v.reserve(size);
+		for (auto&& part : parts) {
+			std::move(part.begin(), part.end(), std::back_inserter(v));
+		}
+		return { std::move(v), ValueType::ARRAY_TYPE };
+	}
+
+	/* value *( ws %x2C ws value ) up to the end of the input, as in one slice of an array */
+	Status parse_elements(json_array_type& v) {
+		parse_whitespace();
+		while (true) {
+			auto ret = parse_value();
+			if (ret != Status::PARSE_OK) {
+				return ret;
+			}
+			v.push_back(std::move(jsonValue));
+			parse_whitespace();
+			if (json.empty()) {
+				return Status::PARSE_OK;
+			}
+			if (!json.starts_with(',')) {
+				return Status::PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+			}
+			json.remove_prefix(1);
+			parse_whitespace();
+		}
+	}
+
+	/*
+	 * Structural scan of the array at text[0]: records the commas at depth 1 and the index of the
+	 * closing bracket. Nothing between the structural characters is validated.
+	 */
+	static bool scan_array(std::string_view text, std::vector<std::size_t>& commas, std::size_t& end) {
+		std::size_t depth = 0;
+		for (std::size_t i = 0; i < text.size(); i++) {
+			switch (text[i]) {
+				case '\"':
+					i = skip_string(text, i);
+					if (i == std::string_view::npos) return false;
+					break;
+				case '[':
+				case '{':
+					++depth;
+					break;
+				case ']':
+				case '}':
+					if (--depth == 0) {
+						end = i;
+						return text[i] == ']';
+					}
+					break;
+				case ',':
+					if (depth == 1) commas.push_back(i);
+					break;
+				default:
+					break;
+			}
+		}
+		return false;
+	}
+
+	/* index of the quote closing the string opened at text[open], or npos */
+	static std::size_t skip_string(std::string_view text, std::size_t open) {
+		for (std::size_t i = open + 1; ; i++) {
+			i = text.find_first_of("\"\\", i);
+			if (i == std::string_view::npos || text[i] == '\"') return i;
+			++i;	/* skip the escaped character */
+		}
+	}
+
+	/* value = null / false / true / number */
+	Status parse_value();
+
+	/* ws = *(%x20 / %x09 / %x0A / %x0D) */
+	void parse_whitespace() {
+		while (json.starts_with(' ') || json.starts_with('\t') || json.starts_with('\n') || json.starts_with('\r')) {
+			json.remove_prefix(1);
+		}
+	}
+
+	/* literal = "null" / "false" / "true" */
+	Status parse_literal(std::string_view literal, ValueType type);
+
+	/*
+  * number = [ "-" ] int [ frac ] [ exp ]
+  * int = "0" / digit1-9 *digit
+  * frac = "." 1*digit
+  * exp = ("e" / "E") ["-" / "+"] 1*digit
+  */
+	Status parse_number();
+
+	/* text already checked by scan_number(), strtod() only settles what from_chars() reports out of range */
+	static bool convert_number(std::string_view text, double& d) {
+		if (std::from_chars(text.data(), text.data() + text.size(), d).ec == std::errc{}) {
+			return true;
+		}
+		errno = 0;
+		d = strtod(std::string(text).c_str(), nullptr);
+		return !(errno == ERANGE && (d == HUGE_VAL || d == -HUGE_VAL));
+	}
+
+	/* advances judge past a well-formed number, validation only */
+	static bool scan_number(std::string_view& judge) {
+		if (judge.starts_with('-')) {
+			judge.remove_prefix(1);
+		}
+		if (judge.starts_with('0')) {
+			judge.remove_prefix(1);
+		}
+		else {
+			if (judge.empty() || !isdigit(judge[0])) {
+				return false;
+			}
+			for (judge.remove_prefix(1); !judge.empty() && isdigit(judge[0]); judge.remove_prefix(1));
+		}
+		if (judge.starts_with('.')) {
+			judge.remove_prefix(1);
+			if (judge.empty() || !isdigit(judge[0])) {
+				return false;
+			}
+			for (judge.remove_prefix(1); !judge.empty() && isdigit(judge[0]); judge.remove_prefix(1));
+		}
+		if (judge.starts_with('e') || judge.starts_with('E')) {
+			judge.remove_prefix(1);
+			if (judge.starts_with('+') || judge.starts_with('-')) {
+				judge.remove_prefix(1);
+			}
+			if (judge.empty() || !isdigit(judge[0])) {
+				return false;
+			}
+			for (judge.remove_prefix(1); !judge.empty() && isdigit(judge[0]); judge.remove_prefix(1));
+		}
+		return true;
+	}
+
+	Status parse_string();
+
+	/* string = quotation-mark *char quotation-mark */
+	Status parse_string_raw(std::string& s);
+
+	/*
+	 * Measures the run of bytes that can be copied verbatim, stopping at '"', '\\' or a control char.
+	 * Eight bytes are tested at a time; in strict mode non-ASCII bytes go through a UTF-8 DFA.
+	 */
+	[[nodiscard]] bool scan_string_run(std::size_t& n) const {
+		constexpr std::uint64_t ones = 0x0101010101010101ull;
+		constexpr std::uint64_t highs = 0x8080808080808080ull;
+		const bool strict = has_flag(ParseFlag::PARSE_STRICT_UTF8);
+		const char* const begin = json.data();
+		const char* const end = begin + json.size();
+		const char* p = begin;
+		std::uint8_t state = utf8_accept;
+		while (p != end) {
+			if (state == utf8_accept && end - p >= 8) {
+				std::uint64_t w;
+				std::memcpy(&w, p, sizeof(w));
+				const std::uint64_t quote = w ^ (ones * '\"');
+				const std::uint64_t backslash = w ^ (ones * '\\');
+				std::uint64_t special = ((w - ones * 0x20) & ~w) | ((quote - ones) & ~quote)
+					| ((backslash - ones) & ~backslash);
+				special &= highs;
+				if (strict) {
+					special |= w & highs;
+				}
+				if (special == 0) {
+					p += 8;
+					continue;
+				}
+			}
+			const auto c = static_cast<unsigned char>(*p);
+			if (c < 0x20 || c == '\"' || c == '\\') {
+				break;
+			}
+			if (strict) {
+				state = utf8_dfa.next[state * utf8_classes + utf8_dfa.cls[c]];
+				if (state == utf8_reject) {
+					return false;
+				}
+			}
+			++p;
+		}
+		n = static_cast<std::size_t>(p - begin);
+		return state == utf8_accept;
+	}
+
+	template <typename T>
+	struct is_optional : std::false_type {};
+
+	template <typename T>
+	struct is_optional<std::optional<T>> : std::true_type {};
+
+	template <typename T>
+	struct is_vector : std::false_type {};
+
+	template <typename T, typename Allocator>
+	struct is_vector<std::vector<T, Allocator>> : std::true_type {};
+
+	template <typename T>
+	static constexpr bool is_string_map = requires {
+		typename T::mapped_type;
+		requires std::is_same_v<typename T::key_type, std::string>;
+	};
+
+	template <typename T>
+	static constexpr bool is_described = requires { leptjson_describe(static_cast<const T*>(nullptr)); };
+
+	template <typename T>
+	Status read(T& out) {
+		if constexpr (std::is_same_v<T, bool>) {
+			if (json.starts_with('t')) {
+				out = true;
+				return parse_literal("true", ValueType::TRUE_TYPE);
+			}
+			if (json.starts_with('f')) {
+				out = false;
+				return parse_literal("false", ValueType::FALSE_TYPE);
+			}
+			return mismatch();
+		}
+		else if constexpr (std::is_arithmetic_v<T>) {
+			if (!json.starts_with('-') && (json.empty() || !isdigit(static_cast<unsigned char>(json[0])))) {
+				return mismatch();
+			}
+			const char* const start = json.data();
+			const auto ret = parse_number();
+			if (ret != Status::PARSE_OK) return ret;
+			if constexpr (std::is_integral_v<T>) {
+				/* plain integers convert from the digits, so values past 2^53 stay exact */
+				const std::string_view text(start, static_cast<std::size_t>(json.data() - start));
+				if (text.find_first_of(".eE") == std::string_view::npos) {
+					T value{};
+					const auto [p, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+					if (ec == std::errc::result_out_of_range) return Status::PARSE_TYPE_MISMATCH;
+					if (ec == std::errc{} && p == text.data() + text.size()) {
+						out = value;
+						return Status::PARSE_OK;
+					}
+				}
+			}
+			const double d = number_value(jsonValue);
+			if constexpr (std::is_integral_v<T>) {
+				if (d != std::trunc(d) || !(d >= static_cast<double>(std::numeric_limits<T>::min()) &&
+					d < static_cast<double>(std::numeric_limits<T>::max()) + 1.0)) {
+					return Status::PARSE_TYPE_MISMATCH;
+				}
+			}
+			else if (std::abs(d) > static_cast<double>(std::numeric_limits<T>::max())) {
+				return Status::PARSE_TYPE_MISMATCH;
+			}
+			out = static_cast<T>(d);
+			return Status::PARSE_OK;
+		}
+		else if constexpr (std::is_same_v<T, std::string>) {
+			if (!json.starts_with('\"')) return mismatch();
+			out.clear();
+			return parse_string_raw(out);
+		}
+		else if constexpr (std::is_same_v<T, LeptJSON>) {
+			const auto ret = parse_value();
+			if (ret == Status::PARSE_OK) out.jsonValue = std::move(jsonValue);
+			return ret;
+		}
+		else if constexpr (is_optional<T>::value) {
+			if (json.starts_with('n')) {
+				out.reset();
+				return parse_literal("null", ValueType::NULL_TYPE);
+			}
+			return read(out.emplace());
+		}
+		else if constexpr (is_vector<T>::value) {
+			if (!json.starts_with('[')) return mismatch();
+			out.clear();
+			json.remove_prefix(1);
+			parse_whitespace();
+			if (json.starts_with(']')) {
+				json.remove_prefix(1);
+				return Status::PARSE_OK;
+			}
+			while (true) {
+				const auto ret = read(out.emplace_back());
+				if (ret != Status::PARSE_OK) return ret;
+				parse_whitespace();
+				if (json.starts_with(',')) {
+					json.remove_prefix(1);
+					parse_whitespace();
+				}
+				else if (json.starts_with(']')) {
+					json.remove_prefix(1);
+					return Status::PARSE_OK;
+				}
+				else {
+					return Status::PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+				}
+			}
+		}
+		else if constexpr (is_string_map<T>) {
+			if (!json.starts_with('{')) return mismatch();
+			out.clear();
+			return read_members([&](const std::string& key) { return read(out[key]); });
+		}
+		else if constexpr (is_described<T>) {
+			if (!json.starts_with('{')) return mismatch();
+			return read_struct(out, leptjson_describe(static_cast<const T*>(nullptr)),
+				std::make_index_sequence<std::tuple_size_v<decltype(leptjson_describe(static_cast<const T*>(nullptr)))>>{});
+		}
+		else {
+			static_assert(is_described<T>, "parse_into: type is not supported, bind it with LEPTJSON_DESCRIBE");
+		}
+	}
+
+	/* dispatch on the precomputed key hashes, then confirm with the name */
+	template <typename T, typename Fields, std::size_t... I>
+	Status read_struct(T& out, const Fields& fields, std::index_sequence<I...>) {
+		std::bitset<sizeof...(I)> seen;
+		auto ret = read_members([&](const std::string& key) {
+			const auto hash = fnv1a(key);
+			bool matched = false;
+			auto status = Status::PARSE_OK;
+			static_cast<void>(((!matched && std::get<I>(fields).hash == hash && std::get<I>(fields).name == key &&
+				(matched = true, seen.set(I), status = read(out.*std::get<I>(fields).member), true)) || ...));
+			return matched ? status : skip_value();
+		});
+		if (ret != Status::PARSE_OK) return ret;
+		auto missing = [&](auto& member, bool present) {
+			if constexpr (is_optional<std::remove_reference_t<decltype(member)>>::value) {
+				if (!present) member.reset();
+				return false;
+			}
+			else {
+				return !present;
+			}
+		};
+		return (missing(out.*std::get<I>(fields).member, seen[I]) | ...) ? Status::PARSE_MISSING_FIELD : Status::PARSE_OK;
+	}
+
+	/* member = string ws %x3A ws value, on_member reads the value for each key */
+	template <typename OnMember>
+	Status read_members(OnMember&& on_member) {
+		json.remove_prefix(1);
+		parse_whitespace();
+		if (json.starts_with('}')) {
+			json.remove_prefix(1);
+			return Status::PARSE_OK;
+		}
+		std::string key;
+		while (true) {
+			if (!json.starts_with('\"')) return Status::PARSE_MISS_KEY;
+			key.clear();
+			auto ret = parse_string_raw(key);
+			if (ret != Status::PARSE_OK) return ret;
+			parse_whitespace();
+			if (!json.starts_with(':')) return Status::PARSE_MISS_COLON;
+			json.remove_prefix(1);
+			parse_whitespace();
+			ret = on_member(key);
+			if (ret != Status::PARSE_OK) return ret;
+			parse_whitespace();
+			if (json.starts_with(',')) {
+				json.remove_prefix(1);
+				parse_whitespace();
+			}
+			else if (json.starts_with('}')) {
+				json.remove_prefix(1);
+				return Status::PARSE_OK;
+			}
+			else {
+				return Status::PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+			}
+		}
+	}
+
+	/* array = %x5B ws [ value *( ws %x2C ws value ) ] ws %x5D, on_element reads the value at each index */
+	template <typename OnElement>
+	Status read_elements(OnElement&& on_element) {
+		json.remove_prefix(1);
+		parse_whitespace();
+		if (json.starts_with(']')) {
+			json.remove_prefix(1);
+			return Status::PARSE_OK;
+		}
+		for (std::size_t i = 0;; ++i) {
+			const auto ret = on_element(i);
+			if (ret != Status::PARSE_OK) return ret;
+			parse_whitespace();
+			if (json.starts_with(',')) {
+				json.remove_prefix(1);
+				parse_whitespace();
+			}
+			else if (json.starts_with(']')) {
+				json.remove_prefix(1);
+				return Status::PARSE_OK;
+			}
+			else {
+				return Status::PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+			}
+		}
+	}
+
+	/* a well-formed value of the wrong type is a mismatch, anything else keeps its syntax error */
+	Status mismatch() {
+		const auto ret = skip_value();
+		return ret == Status::PARSE_OK ? Status::PARSE_TYPE_MISMATCH : ret;
+	}
+
+	/* validates one value without building it, strings are decoded into a reused buffer */
+	Status skip_value() {
+		if (json.empty()) return Status::PARSE_EXPECT_VALUE;
+		switch (json[0]) {
+			case 't':
+				return parse_literal("true", ValueType::TRUE_TYPE);
+			case 'f':
+				return parse_literal("false", ValueType::FALSE_TYPE);
+			case 'n':
+				return parse_literal("null", ValueType::NULL_TYPE);
+			case '\0':
+				return Status::PARSE_EXPECT_VALUE;
+			case '"':
+				skipBuffer.clear();
+				return parse_string_raw(skipBuffer);
+			case '[':
+				return read_elements([this](std::size_t) { return skip_value(); });
+			case '{':
+				return read_members([this](const std::string&) { return skip_value(); });
+			default:
+			{
+				std::string_view judge = json;
+				if (!scan_number(judge)) return Status::PARSE_INVALID_VALUE;
+				json = judge;
+				return Status::PARSE_OK;
+			}
+		}
+	}
+
+	template <typename T>
+	void write(std::string& s, const T& in) {
+		if constexpr (std::is_same_v<T, bool>) {
+			s += in ? "true" : "false";
+		}
+		else if constexpr (std::is_integral_v<T>) {
+			std::array<char, 24> buffer{};
+			auto [p, ec] = std::to_chars(buffer.data(), buffer.data() + buffer.size(), in);
+			s.append(buffer.data(), p);
+		}
+		else if constexpr (std::is_floating_point_v<T>) {
+			stringify_number(s, static_cast<double>(in));
+		}
+		else if constexpr (std::is_same_v<T, std::string>) {
+			stringify_string(s, in);
+		}
+		else if constexpr (std::is_same_v<T, LeptJSON>) {
+			stringify_value(s, in.jsonValue);
+		}
+		else if constexpr (is_optional<T>::value) {
+			if (in) write(s, *in);
+			else s += "null";
+		}
+		else if constexpr (is_vector<T>::value) {
+			s += '[';
+			for (std::size_t i = 0; i < in.size(); i++) {
+				if (i) s += ',';
+				write(s, in[i]);
+			}
+			s += ']';
+		}
+		else if constexpr (is_string_map<T>) {
+			s += '{';
+			bool comma = false;
+			for (auto&& [key, value] : in) {
+				if (comma) s += ',';
+				comma = true;
+				stringify_string(s, key);
+				s += ':';
+				write(s, value);
+			}
+			s += '}';
+		}
+		else if constexpr (is_described<T>) {
+			s += '{';
+			bool comma = false;
+			std::apply([&](const auto&... field) {
+				auto member = [&](const auto& f) {
+					const auto& value = in.*f.member;
+					if constexpr (is_optional<std::remove_cvref_t<decltype(value)>>::value) {
+						if (!value) return;
+					}
+					if (comma) s += ',';
+					comma = true;
+					stringify_string(s, f.name);
+					s += ':';
+					write(s, value);
+				};
+				(member(field), ...);
+			}, leptjson_describe(static_cast<const T*>(nullptr)));
+			s += '}';
+		}
+		else {
+			static_assert(is_described<T>, "stringify_from: type is not supported, bind it with LEPTJSON_DESCRIBE");
+		}
+	}
+
+	[[nodiscard]] bool has_flag(ParseFlag flag) const {
+		return (parseFlags & flag) != ParseFlag::PARSE_DEFAULT;
+	}
+
+	/*
+	 * Decodes a run of consecutive \uXXXX escapes, json starting at the first 'u'.
+	 * The UTF-8 bytes are collected in a local buffer and appended to s in bulk.
+	 */
+	Status parse_unicode_run(std::string& s) {
+		std::array<char, 64> buffer;
+		std::size_t n = 0;
+		while (true) {
+			unsigned int u{};
+			if (!parse_hex4(u)) {
+				return Status::PARSE_INVALID_UNICODE_HEX;
+			}
+			json.remove_prefix(5);
+			if (u >= 0xD800 && u <= 0xDBFF) { /* surrogate pair */
+				if (!json.starts_with("\\u")) {
+					return Status::PARSE_INVALID_UNICODE_SURROGATE;
+				}
+				json.remove_prefix(1);
+				unsigned int u2{};
+				if (!parse_hex4(u2)) {
+					return Status::PARSE_INVALID_UNICODE_HEX;
+				}
+				if (u2 < 0xDC00 || u2 > 0xDFFF) {
+					return Status::PARSE_INVALID_UNICODE_SURROGATE;
+				}
+				json.remove_prefix(5);
+				u = (((u - 0xD800) << 10) | (u2 - 0xDC00)) + 0x10000;
+			}
+			else if (u >= 0xDC00 && u <= 0xDFFF && has_flag(ParseFlag::PARSE_STRICT_UTF8)) {
+				return Status::PARSE_INVALID_UNICODE_SURROGATE;
+			}
+			n += encode_utf8(buffer.data() + n, u);
+			if (!json.starts_with("\\u")) {
+				break;
+			}
+			json.remove_prefix(1);
+			if (n > buffer.size() - 4) {
+				LEPTJSON_STAT(const auto capacity = s.capacity());
+				s.append(buffer.data(), n);
+				LEPTJSON_STAT(stat_growth(capacity, s.capacity(), 1));
+				n = 0;
+			}
+		}
+		LEPTJSON_STAT(const auto capacity = s.capacity());
+		s.append(buffer.data(), n);
+		LEPTJSON_STAT(stat_growth(capacity, s.capacity(), 1));
+		return Status::PARSE_OK;
+	}
+
+	static constexpr std::array<std::int8_t, 256> hex_table = [] {
+		std::array<std::int8_t, 256> table{};
+		for (auto& v : table) v = -1;
+		for (int c = '0'; c <= '9'; c++) table[c] = static_cast<std::int8_t>(c - '0');
+		for (int c = 'A'; c <= 'F'; c++) table[c] = static_cast<std::int8_t>(c - 'A' + 10);
+		for (int c = 'a'; c <= 'f'; c++) table[c] = static_cast<std::int8_t>(c - 'a' + 10);
+		return table;
+	}();
+
+	/* the four hex digits after the 'u' at json[0] */
+	bool parse_hex4(unsigned int& u) const {
+		if (json.size() < 5)return false;
+		const int d0 = hex_table[static_cast<unsigned char>(json[1])];
+		const int d1 = hex_table[static_cast<unsigned char>(json[2])];
+		const int d2 = hex_table[static_cast<unsigned char>(json[3])];
+		const int d3 = hex_table[static_cast<unsigned char>(json[4])];
+		if ((d0 | d1 | d2 | d3) < 0) {
+			return false;
+		}
+		u = static_cast<unsigned int>((d0 << 12) | (d1 << 8) | (d2 << 4) | d3);
+		return true;
+	}
+
+	/* writes the 1-4 byte encoding of u to out, which must have room for 4 bytes */
+	static constexpr std::size_t encode_utf8(char* out, unsigned int u) {
+		if (u <= 0x7f) {
+			out[0] = static_cast<char>(u);
+			return 1;
+		}
+		if (u <= 0x7ff) {
+			out[0] = static_cast<char>(0xC0 | (u >> 6));
+			out[1] = static_cast<char>(0x80 | (u & 0x3F));
+			return 2;
+		}
+		if (u <= 0xffff) {
+			out[0] = static_cast<char>(0xE0 | (u >> 12));
+			out[1] = static_cast<char>(0x80 | ((u >> 6) & 0x3F));
+			out[2] = static_cast<char>(0x80 | (u & 0x3F));
+			return 3;
+		}
+		assert(u <= 0x10ffff);
+		out[0] = static_cast<char>(0xF0 | (u >> 18));
+		out[1] = static_cast<char>(0x80 | ((u >> 12) & 0x3F));
+		out[2] = static_cast<char>(0x80 | ((u >> 6) & 0x3F));
+		out[3] = static_cast<char>(0x80 | (u & 0x3F));
+		return 4;
+	}
+
+	/* array = %x5B ws [ value *( ws %x2C ws value ) ] ws %x5D */
+	Status parse_array();
+
+	static bool starts_number(std::string_view text) {
+		return !text.empty() && (text[0] == '-' || (text[0] >= '0' && text[0] <= '9'));
+	}
+
+	/*
+	 * Leading run of numbers of an array into contiguous storage. When the whole array is numeric
+	 * it becomes jsonValue and closed is set, otherwise it stops at the first other element.
+	 */
+	Status parse_numbers(json_numbers_type& numbers, bool& closed);
+
+	Status parse_object();
+
+	/* members off the projection are skipped before their key is copied, so they never reach the map */
+	Status parse_object_projected() {
+		LEPTJSON_STAT(StatDepth depth{ *this });
+		const auto* node = projection;
+		json_object_type v;
+		const auto ret = read_members([&](const std::string& key) {
+			const auto* child = node->find(key);
+			if (child == nullptr) return skip_value();
+			projection = child->whole ? nullptr : child;
+			const auto ret = parse_value();
+			projection = node;
+			if (ret == Status::PARSE_OK) v.append(std::string(key), std::move(jsonValue));
+			return ret;
+		});
+		if (ret != Status::PARSE_OK) {
+			jsonValue.type = ValueType::NULL_TYPE;
+			return ret;
+		}
+		LEPTJSON_STAT(stat_node(ValueType::OBJECT_TYPE));
+		v.sort();
+		jsonValue = { std::move(v), ValueType::OBJECT_TYPE };
+		return Status::PARSE_OK;
+	}
+
+	/* one value under a compiled schema node; schemaPath is left pointing at the first violation */
+	Status parse_checked(const Schema& schema, const Schema::Node& node) {
+		if (json.empty() || json.starts_with('\0')) return Status::PARSE_EXPECT_VALUE;
+		unsigned kind = 0;
+		switch (json.front()) {
+			case 'n': kind = Schema::null_bit; break;
+			case 't':
+			case 'f': kind = Schema::boolean_bit; break;
+			case '"': kind = Schema::string_bit; break;
+			case '[': kind = Schema::array_bit; break;
+			case '{': kind = Schema::object_bit; break;
+			default:
+				/* anything else is a number or a syntax error, which takes precedence */
+				if (json.front() != '-' && !std::isdigit(static_cast<unsigned char>(json.front()))) return parse_value();
+				kind = Schema::number_bit | Schema::integer_bit;
+				break;
+		}
+		if (!(node.types & kind)) return Status::PARSE_SCHEMA_VIOLATION;
+		const auto size = schemaPath.size();
+		const auto child = [&](const Schema::Node* subschema) {
+			const auto ret = subschema ? parse_checked(schema, *subschema) : parse_value();
+			if (ret == Status::PARSE_OK) schemaPath.resize(size);
+			return ret;
+		};
+		auto ret = Status::PARSE_OK;
+		if (kind == Schema::object_bit) {
+			json_object_type v;
+			ret = read_members([&](const std::string& key) {
+				append_pointer_token(schemaPath, key);
+				const auto it = node.properties.find(key);
+				const auto ret = child(it == node.properties.end() ? nullptr : &schema.nodes[it->second]);
+				if (ret == Status::PARSE_OK) v.append(std::string(key), std::move(jsonValue));
+				return ret;
+			});
+			if (ret != Status::PARSE_OK) return ret;
+			v.sort();
+			for (auto&& key : node.required) {
+				if (!v.contains(key)) {
+					append_pointer_token(schemaPath, key);
+					return Status::PARSE_SCHEMA_VIOLATION;
+				}
+			}
+			jsonValue = { std::move(v), ValueType::OBJECT_TYPE };
+		}
+		else if (kind == Schema::array_bit) {
+			json_array_type v;
+			const auto* items = node.items == Schema::none ? nullptr : &schema.nodes[node.items];
+			ret = read_elements([&](std::size_t i) {
+				append_pointer_token(schemaPath, std::to_string(i));
+				if (i >= node.maxItems) return Status::PARSE_SCHEMA_VIOLATION;
+				const auto ret = child(items);
+				if (ret == Status::PARSE_OK) v.push_back(std::move(jsonValue));
+				return ret;
+			});
+			if (ret != Status::PARSE_OK) return ret;
+			if (v.size() < node.minItems) return Status::PARSE_SCHEMA_VIOLATION;
+			jsonValue = { std::move(v), ValueType::ARRAY_TYPE };
+		}
+		else {
+			ret = parse_value();
+			if (ret != Status::PARSE_OK) return ret;
+			if (!schema_scalar(node)) return Status::PARSE_SCHEMA_VIOLATION;
+		}
+		if (!node.enumeration.empty() && std::find(node.enumeration.begin(), node.enumeration.end(), jsonValue) == node.enumeration.end()) {
+			return Status::PARSE_SCHEMA_VIOLATION;
+		}
+		return Status::PARSE_OK;
+	}
+
+	[[nodiscard]] bool schema_scalar(const Schema::Node& node) const {
+		if (jsonValue.type == ValueType::NUMBER_TYPE) {
+			const double d = number_value(jsonValue);
+			if (!(node.types & Schema::number_bit) && d != std::floor(d)) return false;
+			return (node.exclusiveMinimum ? d > node.minimum : d >= node.minimum) &&
+				(node.exclusiveMaximum ? d < node.maximum : d <= node.maximum);
+		}
+		if (jsonValue.type == ValueType::STRING_TYPE) {
+			const auto& s = std::get<std::string>(jsonValue.value);
+			const auto points = static_cast<std::size_t>(std::count_if(s.begin(), s.end(), [](char c) { return (c & 0xC0) != 0x80; }));
+			return points >= node.minLength && points <= node.maxLength;
+		}
+		return true;
+	}
+
+	json_array_type& array_for_write(bool handout = true) {
+		if (jsonValue.type == ValueType::NULL_TYPE) jsonValue = { json_array_type{}, ValueType::ARRAY_TYPE };
+		return detach_array(jsonValue, handout);
+	}
+
+	json_object_type& object_for_write(bool handout = true) {
+		if (jsonValue.type == ValueType::NULL_TYPE) jsonValue = { json_object_type{}, ValueType::OBJECT_TYPE };
+		return detach_object(jsonValue, handout);
+	}
+
+	template <typename K>
+	static std::string make_key(K&& key) {
+		if constexpr (std::is_same_v<std::remove_cvref_t<K>, std::string>) return std::forward<K>(key);
+		else return std::string(std::string_view(key));
+	}
+
+	template <typename T>
+	static JsonValue make_value(T&& value) {
+		using U = std::remove_cvref_t<T>;
+		if constexpr (std::is_same_v<U, JsonValue>) {
+			return std::forward<T>(value);
+		}
+		else if constexpr (std::is_same_v<U, LeptJSON>) {
+			return std::forward<T>(value).jsonValue;
+		}
+		else if constexpr (std::is_same_v<U, std::nullptr_t>) {
+			return { nullptr, ValueType::NULL_TYPE };
+		}
+		else if constexpr (std::is_same_v<U, bool>) {
+			return { value, value ? ValueType::TRUE_TYPE : ValueType::FALSE_TYPE };
+		}
+		else if constexpr (std::is_arithmetic_v<U>) {
+			return { static_cast<double>(value), ValueType::NUMBER_TYPE };
+		}
+		else if constexpr (std::is_same_v<U, std::string>) {
+			return { std::forward<T>(value), ValueType::STRING_TYPE };
+		}
+		else if constexpr (std::is_convertible_v<T, std::string_view>) {
+			return { std::string(std::string_view(value)), ValueType::STRING_TYPE };
+		}
+		else if constexpr (std::is_same_v<U, json_array_type>) {
+			return { std::forward<T>(value), ValueType::ARRAY_TYPE };
+		}
+		else if constexpr (std::is_same_v<U, json_object_type>) {
+			return { std::forward<T>(value), ValueType::OBJECT_TYPE };
+		}
+		else {
+			static_assert(std::is_same_v<U, JsonValue>, "no JSON value can be built from this type");
+		}
+	}
+
+	static const json_array_type& as_array(const JsonValue& jv) {
+		assert(jv.type == ValueType::ARRAY_TYPE);
+		if (const auto* p = std::get_if<json_array_ptr>(&jv.value)) return (*p)->items;
+		const auto& n = *std::get<json_numbers_ptr>(jv.value);
+		std::call_once(n.expandOnce, [&n] { n.expanded = std::make_unique<const json_array_type>(number_elements(n.items)); });
+		return *n.expanded;
+	}
+
+	static const json_numbers_type* as_numbers(const JsonValue& jv) {
+		const auto* p = std::get_if<json_numbers_ptr>(&jv.value);
+		return p ? &(*p)->items : nullptr;
+	}
+
+	static json_array_type number_elements(std::span<const double> numbers) {
+		json_array_type a;
+		a.reserve(numbers.size());
+		for (double d : numbers) a.emplace_back(d, ValueType::NUMBER_TYPE);
+		return a;
+	}
+
+	static std::size_t element_count(const JsonValue& jv) {
+		const auto* numbers = as_numbers(jv);
+		return numbers ? numbers->size() : as_array(jv).size();
+	}
+
+	/* element visitor that does not expand number storage, its numbers are temporaries */
+	template <typename F>
+	static void for_each_element(const JsonValue& jv, F&& f) {
+		if (const auto* numbers = as_numbers(jv)) {
+			for (double d : *numbers) f(JsonValue(d, ValueType::NUMBER_TYPE));
+		}
+		else {
+			for (auto&& value : as_array(jv)) f(value);
+		}
+	}
+
+	static const json_object_type& as_object(const JsonValue& jv) {
+		assert(jv.type == ValueType::OBJECT_TYPE);
+		return std::get<json_object_ptr>(jv.value)->items;
+	}
+
+	static double number_value(const JsonValue& jv) {
+		assert(jv.type == ValueType::NUMBER_TYPE);
+		if (const auto* raw = std::get_if<RawNumber>(&jv.value)) return raw->value();
+		return std::get<double>(jv.value);
+	}
+
+	static std::int64_t number_int64(const JsonValue& jv) {
+		assert(jv.type == ValueType::NUMBER_TYPE);
+		if (const auto* raw = std::get_if<RawNumber>(&jv.value)) {
+			const auto text = raw->text();
+			std::int64_t i = 0;
+			const auto [p, ec] = std::from_chars(text.data(), text.data() + text.size(), i);
+			if (ec == std::errc{} && p == text.data() + text.size()) return i;
+		}
+		const double d = number_value(jv);
+		if (!(d > -9223372036854775808.0)) return std::numeric_limits<std::int64_t>::min();
+		if (d >= 9223372036854775808.0) return std::numeric_limits<std::int64_t>::max();
+		return static_cast<std::int64_t>(d);
+	}
+
+	/*
+	 * Copy-on-write: a shared container is cloned before it is handed out for writing. The clone
+	 * copies only the child handles, so a write below the root clones just the path to it.
+	 * Writing also drops the node's cached hash. References obtained this way are invalidated by
+	 * copying the value that owns them. Pass handout = false only when the reference does not
+	 * outlive the call, otherwise the node is marked exposed and stops caching its hash.
+	 */
+	static json_array_type& detach_array(JsonValue& jv, bool handout = true) {
+		assert(jv.type == ValueType::ARRAY_TYPE);
+		if (const auto* numbers = as_numbers(jv)) {
+			auto a = number_elements(*numbers);
+			jv.value = std::make_shared<SharedNode<json_array_type>>(std::move(a));
+		}
+		auto& p = std::get<json_array_ptr>(jv.value);
+		if (p.use_count() > 1) p = std::make_shared<SharedNode<json_array_type>>(*p);
+		else p->hash.store(0, std::memory_order_relaxed);
+		p->exposed = p->exposed || handout;
+		return p->items;
+	}
+
+	static json_object_type& detach_object(JsonValue& jv, bool handout = true) {
+		assert(jv.type == ValueType::OBJECT_TYPE);
+		auto& p = std::get<json_object_ptr>(jv.value);
+		if (p.use_count() > 1) p = std::make_shared<SharedNode<json_object_type>>(*p);
+		else p->hash.store(0, std::memory_order_relaxed);
+		p->exposed = p->exposed || handout;
+		return p->items;
+	}
+
+	static std::size_t hash_combine(std::size_t seed, std::uint64_t v) {
+		/* splitmix64 finalizer over the boost-style combination */
+		std::uint64_t x = seed ^ (v + 0x9e3779b97f4a7c15 + (std::uint64_t{ seed } << 6) + (seed >> 2));
+		x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+		x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+		return static_cast<std::size_t>(x ^ (x >> 31));
+	}
+
+	/* structural hash, equal values hash equal; containers compute it once and keep it until written */
+	static std::size_t hash_value(const JsonValue& jv) {
+		bool cacheable = true;
+		return hash_value(jv, cacheable);
+	}
+
+	/* cacheable is cleared when the subtree holds an exposed node, whose hash may go stale */
+	static std::size_t hash_value(const JsonValue& jv, bool& cacheable) {
+		const auto seed = static_cast<std::size_t>(jv.type);
+		switch (jv.type) {
+			case ValueType::NUMBER_TYPE:
+				return hash_number(number_value(jv));
+			case ValueType::STRING_TYPE:
+				return hash_combine(seed, std::hash<std::string>{}(std::get<std::string>(jv.value)));
+			case ValueType::ARRAY_TYPE:
+				if (const auto* p = std::get_if<json_numbers_ptr>(&jv.value)) {
+					/* same combination as the generic array below, so both storages hash equal */
+					return cached_hash(**p, cacheable, [seed](const json_numbers_type& a, bool&) {
+						auto h = hash_combine(seed, a.size());
+						for (double d : a) h = hash_combine(h, hash_number(d));
+						return h;
+					});
+				}
+				return cached_hash(*std::get<json_array_ptr>(jv.value), cacheable, [seed](const json_array_type& a, bool& below) {
+					auto h = hash_combine(seed, a.size());
+					for (auto&& value : a) h = hash_combine(h, hash_value(value, below));
+					return h;
+				});
+			case ValueType::OBJECT_TYPE:
+				return cached_hash(*std::get<json_object_ptr>(jv.value), cacheable, [seed](const json_object_type& o, bool& below) {
+					auto h = hash_combine(seed, o.size());
+					for (auto&& [key, value] : o) {
+						h = hash_combine(h, std::hash<std::string>{}(key));
+						h = hash_combine(h, hash_value(value, below));
+					}
+					return h;
+				});
+			default:
+				return hash_combine(seed, 0);
+		}
+	}
+
+	static std::size_t hash_number(double d) {
+		return hash_combine(static_cast<std::size_t>(ValueType::NUMBER_TYPE), std::bit_cast<std::uint64_t>(d == 0 ? 0.0 : d));	/* -0.0 == 0.0 */
+	}
+
+	/*
+	 * A hash is kept only if no node of the subtree was exposed: a reference handed out by
+	 * detach_array()/detach_object() can write the items long after hash() without the node
+	 * noticing. Exposed subtrees are rehashed on every call, so a kept hash is never stale.
+	 */
+	template <typename Node, typename Compute>
+	static std::size_t cached_hash(const Node& node, bool& cacheable, Compute compute) {
+		auto h = node.hash.load(std::memory_order_relaxed);
+		if (h != 0) return h;
+		bool below = true;
+		h = std::max<std::size_t>(compute(node.items, below), 1);
+		if constexpr (requires { node.exposed; }) below = below && !node.exposed;
+		if (below) node.hash.store(h, std::memory_order_relaxed);
+		else cacheable = false;
+		return h;
+	}
+
+	/* both hashes kept and different, so the subtrees cannot be equal */
+	template <typename Node>
+	static bool hash_mismatch(const Node& lhs, const Node& rhs) {
+		const auto l = lhs.hash.load(std::memory_order_relaxed), r = rhs.hash.load(std::memory_order_relaxed);
+		return l != 0 && r != 0 && l != r;
+	}
+
+	/* RFC 6901 reference tokens with ~1 and ~0 unescaped, false when the pointer is malformed */
+	static bool split_pointer(std::string_view pointer, std::vector<std::string>& tokens) {
+		tokens.clear();
+		if (!pointer.empty() && !pointer.starts_with('/')) return false;
+		while (!pointer.empty()) {
+			pointer.remove_prefix(1);
+			const auto end = std::min(pointer.find('/'), pointer.size());
+			auto& token = tokens.emplace_back();
+			for (std::size_t i = 0; i < end; ++i) {
+				if (pointer[i] != '~') token += pointer[i];
+				else if (i + 1 < end && (pointer[i + 1] == '0' || pointer[i + 1] == '1')) token += pointer[++i] == '0' ? '~' : '/';
+				else return false;
+			}
+			pointer.remove_prefix(end);
+		}
+		return true;
+	}
+
+	static void append_pointer_token(std::string& pointer, std::string_view token) {
+		pointer += '/';
+		for (auto c : token) {
+			if (c == '~') pointer += "~0";
+			else if (c == '/') pointer += "~1";
+			else pointer += c;
+		}
+	}
+
+	/* decimal index without leading zeros below size, or up to size and "-" when appending */
+	static bool array_index(std::string_view token, std::size_t size, bool append, std::size_t& index) {
+		if (append && token == "-") {
+			index = size;
+			return true;
+		}
+		if (token.empty() || (token.size() > 1 && token.starts_with('0'))) return false;
+		index = 0;
+		for (auto c : token) {
+			if (!std::isdigit(static_cast<unsigned char>(c))) return false;
+			index = index * 10 + (c - '0');
+			if (index > size) return false;
+		}
+		return append || index < size;
+	}
+
+	/* node at the first count tokens, nullptr when any of them does not resolve */
+	static const JsonValue* find_pointer(const JsonValue& root, const std::vector<std::string>& tokens, std::size_t count) {
+		const JsonValue* node = &root;
+		for (std::size_t i = 0; i < count; ++i) {
+			if (node->type == ValueType::OBJECT_TYPE) {
+				const auto& o = as_object(*node);
+				const auto it = o.find(tokens[i]);
+				if (it == o.end()) return nullptr;
+				node = &it->second;
+			}
+			else if (std::size_t index; node->type == ValueType::ARRAY_TYPE && array_index(tokens[i], as_array(*node).size(), false, index)) {
+				node = &as_array(*node)[index];
+			}
+			else {
+				return nullptr;
+			}
+		}
+		return node;
+	}
+
+	/* as find_pointer(), detaching every container on the way so the node can be written */
+	static JsonValue* find_pointer_for_write(JsonValue& root, const std::vector<std::string>& tokens, std::size_t count) {
+		JsonValue* node = &root;
+		for (std::size_t i = 0; i < count; ++i) {
+			if (node->type == ValueType::OBJECT_TYPE) {
+				auto& o = detach_object(*node, false);
+				const auto it = o.find(tokens[i]);
+				if (it == o.end()) return nullptr;
+				node = &it->second;
+			}
+			else if (std::size_t index; node->type == ValueType::ARRAY_TYPE && array_index(tokens[i], as_array(*node).size(), false, index)) {
+				node = &detach_array(*node, false)[index];
+			}
+			else {
+				return nullptr;
+			}
+		}
+		return node;
+	}
+
+	/* value is moved from only on success, so a failed add can be undone by the caller */
+	static Status patch_add(JsonValue& doc, const std::vector<std::string>& tokens, JsonValue& value) {
+		if (tokens.empty()) {
+			doc = std::move(value);
+			return Status::PARSE_OK;
+		}
+		auto* parent = find_pointer_for_write(doc, tokens, tokens.size() - 1);
+		if (parent != nullptr && parent->type == ValueType::OBJECT_TYPE) {
+			detach_object(*parent, false).insert_or_assign(tokens.back(), std::move(value));
+			return Status::PARSE_OK;
+		}
+		if (std::size_t index; parent != nullptr && parent->type == ValueType::ARRAY_TYPE && array_index(tokens.back(), as_array(*parent).size(), true, index)) {
+			auto& a = detach_array(*parent, false);
+			a.insert(a.begin() + static_cast<std::ptrdiff_t>(index), std::move(value));
+			return Status::PARSE_OK;
+		}
+		return Status::PATCH_PATH_NOT_FOUND;
+	}
+
+	static Status patch_remove(JsonValue& doc, const std::vector<std::string>& tokens, JsonValue& removed) {
+		if (tokens.empty()) return Status::PATCH_INVALID_OPERATION;
+		auto* parent = find_pointer_for_write(doc, tokens, tokens.size() - 1);
+		if (parent != nullptr && parent->type == ValueType::OBJECT_TYPE) {
+			auto& o = detach_object(*parent, false);
+			const auto it = o.find(tokens.back());
+			if (it == o.end()) return Status::PATCH_PATH_NOT_FOUND;
+			removed = std::move(it->second);
+			o.erase(it);
+			return Status::PARSE_OK;
+		}
+		if (std::size_t index; parent != nullptr && parent->type == ValueType::ARRAY_TYPE && array_index(tokens.back(), as_array(*parent).size(), false, index)) {
+			auto& a = detach_array(*parent, false);
+			removed = std::move(a[index]);
+			a.erase(a.begin() + static_cast<std::ptrdiff_t>(index));
+			return Status::PARSE_OK;
+		}
+		return Status::PATCH_PATH_NOT_FOUND;
+	}
+
+	/* one operation, which either applies completely or leaves doc unchanged */
+	static Status patch_operation(JsonValue& doc, const JsonValue& op) {
+		if (op.type != ValueType::OBJECT_TYPE) return Status::PATCH_INVALID_OPERATION;
+		const auto& members = as_object(op);
+		const auto member = [&members](const char* name) -> const JsonValue* {
+			const auto it = members.find(name);
+			return it == members.end() ? nullptr : &it->second;
+		};
+		const auto pointer = [&member](const char* name, std::vector<std::string>& tokens) {
+			const auto* v = member(name);
+			return v != nullptr && v->type == ValueType::STRING_TYPE && split_pointer(std::get<std::string>(v->value), tokens);
+		};
+		const auto* kind = member("op");
+		std::vector<std::string> path, from;
+		if (kind == nullptr || kind->type != ValueType::STRING_TYPE || !pointer("path", path)) return Status::PATCH_INVALID_OPERATION;
+		const auto& name = std::get<std::string>(kind->value);
+		const auto* value = member("value");
+
+		if (name == "add" || name == "replace" || name == "test") {
+			if (value == nullptr) return Status::PATCH_INVALID_OPERATION;
+			if (name == "add") {
+				JsonValue v = *value;
+				return patch_add(doc, path, v);
+			}
+			if (name == "test") {
+				const auto* target = find_pointer(doc, path, path.size());
+				if (target == nullptr) return Status::PATCH_PATH_NOT_FOUND;
+				return *target == *value ? Status::PARSE_OK : Status::PATCH_TEST_FAILED;
+			}
+			auto* target = find_pointer_for_write(doc, path, path.size());
+			if (target == nullptr) return Status::PATCH_PATH_NOT_FOUND;
+			*target = *value;
+			return Status::PARSE_OK;
+		}
+		if (name == "remove") {
+			JsonValue removed{ nullptr, ValueType::NULL_TYPE };
+			return patch_remove(doc, path, removed);
+		}
+		if (name == "move" || name == "copy") {
+			if (!pointer("from", from)) return Status::PATCH_INVALID_OPERATION;
+			const auto* source = find_pointer(doc, from, from.size());
+			if (source == nullptr) return Status::PATCH_PATH_NOT_FOUND;
+			if (name == "copy") {
+				JsonValue v = *source;
+				return patch_add(doc, path, v);
+			}
+			if (from.size() <= path.size() && std::equal(from.begin(), from.end(), path.begin())) {
+				/* moving a value into itself */
+				return from.size() == path.size() ? Status::PARSE_OK : Status::PATCH_INVALID_OPERATION;
+			}
+			JsonValue v{ nullptr, ValueType::NULL_TYPE };
+			if (const auto ret = patch_remove(doc, from, v); ret != Status::PARSE_OK) return ret;
+			const auto ret = patch_add(doc, path, v);
+			if (ret != Status::PARSE_OK) patch_add(doc, from, v);
+			return ret;
+		}
+		return Status::PATCH_INVALID_OPERATION;
+	}
+
+	static void merge_patch(JsonValue& target, const JsonValue& patch) {
+		if (patch.type != ValueType::OBJECT_TYPE) {
+			target = patch;
+			return;
+		}
+		if (target.type != ValueType::OBJECT_TYPE) target = { json_object_type{}, ValueType::OBJECT_TYPE };
+		auto& o = detach_object(target, false);
+		for (auto&& [key, value] : as_object(patch)) {
+			if (value.type == ValueType::NULL_TYPE) o.erase(key);
+			else merge_patch(o.try_emplace(key, nullptr, ValueType::NULL_TYPE).first->second, value);
+		}
+	}
+
+	static void diff_operation(json_array_type& ops, const char* op, const std::string& path, const JsonValue* value) {
+		json_object_type o;
+		o.try_emplace("op", std::string(op), ValueType::STRING_TYPE);
+		o.try_emplace("path", path, ValueType::STRING_TYPE);
+		if (value != nullptr) o.try_emplace("value", *value);
+		ops.emplace_back(std::move(o), ValueType::OBJECT_TYPE);
+	}
+
+	static void diff_value(json_array_type& ops, std::string& path, const JsonValue& from, const JsonValue& to) {
+		if (from == to) return;
+		const auto size = path.size();
+		if (from.type == ValueType::OBJECT_TYPE && to.type == ValueType::OBJECT_TYPE) {
+			const auto& a = as_object(from);
+			const auto& b = as_object(to);
+			for (auto&& [key, value] : a) {
+				if (b.contains(key)) continue;
+				append_pointer_token(path, key);
+				diff_operation(ops, "remove", path, nullptr);
+				path.resize(size);
+			}
+			for (auto&& [key, value] : b) {
+				append_pointer_token(path, key);
+				if (const auto it = a.find(key); it == a.end()) diff_operation(ops, "add", path, &value);
+				else diff_value(ops, path, it->second, value);
+				path.resize(size);
+			}
+		}
+		else if (from.type == ValueType::ARRAY_TYPE && to.type == ValueType::ARRAY_TYPE) {
+			const auto& a = as_array(from);
+			const auto& b = as_array(to);
+			std::size_t prefix = 0, suffix = 0;
+			while (prefix < a.size() && prefix < b.size() && a[prefix] == b[prefix]) ++prefix;
+			while (suffix < a.size() - prefix && suffix < b.size() - prefix && a[a.size() - 1 - suffix] == b[b.size() - 1 - suffix]) ++suffix;
+			const auto changedA = a.size() - prefix - suffix, changedB = b.size() - prefix - suffix;
+			const auto common = std::min(changedA, changedB);
+			const auto at = [&path, size](std::size_t index) -> std::string& {
+				path.resize(size);
+				append_pointer_token(path, std::to_string(index));
+				return path;
+			};
+			for (std::size_t i = 0; i < common; ++i) diff_value(ops, at(prefix + i), a[prefix + i], b[prefix + i]);
+			for (auto i = changedA; i-- > common;) diff_operation(ops, "remove", at(prefix + i), nullptr);
+			for (auto i = common; i < changedB; ++i) diff_operation(ops, "add", at(prefix + i), &b[prefix + i]);
+			path.resize(size);
+		}
+		else {
+			diff_operation(ops, "replace", path, &to);
+		}
+	}
+
+	static constexpr std::uint64_t path_bit(std::size_t step) {
+		return std::uint64_t{ 1 } << step;
+	}
+
+	/*
+	 * Queries run as a set of active steps, one bit each, so a single walk serves every branch of a
+	 * recursive descent. Stepping into a child keeps descendant steps active and advances the ones whose
+	 * selector matches it; the bit past the last step marks the child as selected.
+	 */
+	template <typename Matches>
+	static std::uint64_t path_next(const JsonPath& path, std::uint64_t states, Matches&& matches) {
+		std::uint64_t next = 0;
+		for (std::size_t s = 0; s < path.steps.size(); ++s) {
+			if (!(states & path_bit(s))) continue;
+			if (path.steps[s].descendant) next |= path_bit(s);
+			if (matches(path.steps[s])) next |= path_bit(s + 1);
+		}
+		return next;
+	}
+
+	static bool index_matches(std::int64_t index, std::size_t i, std::size_t size) {
+		if (index >= 0) return static_cast<std::uint64_t>(index) == i;
+		const auto back = std::uint64_t{ 0 } - static_cast<std::uint64_t>(index);
+		return back <= size && i == size - back;
+	}
+
+	static bool filter_compare(const JsonPath::Filter& filter, const JsonValue& v) {
+		using Compare = JsonPath::Compare;
+		if (filter.compare == Compare::EXISTS) return true;
+		if (v.type != filter.type) return filter.compare == Compare::NOT_EQUAL;
+		int order = 0;
+		if (v.type == ValueType::NUMBER_TYPE) {
+			const double d = number_value(v);
+			order = d < filter.number ? -1 : d > filter.number;
+		}
+		else if (v.type == ValueType::STRING_TYPE) {
+			order = std::get<std::string>(v.value).compare(filter.text);
+		}
+		switch (filter.compare) {
+			case Compare::EQUAL: return order == 0;
+			case Compare::NOT_EQUAL: return order != 0;
+			case Compare::LESS: return order < 0;
+			case Compare::LESS_EQUAL: return order <= 0;
+			case Compare::GREATER: return order > 0;
+			default: return order >= 0;
+		}
+	}
+
+	static bool filter_value(const JsonPath::Filter& filter, const JsonValue& v) {
+		const JsonValue* node = &v;
+		for (auto&& key : filter.path) {
+			if (key.index < 0 && node->type == ValueType::OBJECT_TYPE) {
+				const auto& o = as_object(*node);
+				const auto it = o.find(key.name);
+				if (it == o.end()) return false;
+				node = &it->second;
+			}
+			else if (key.index >= 0 && node->type == ValueType::ARRAY_TYPE && static_cast<std::uint64_t>(key.index) < as_array(*node).size()) {
+				node = &as_array(*node)[static_cast<std::size_t>(key.index)];
+			}
+			else {
+				return false;
+			}
+		}
+		return filter_compare(filter, *node);
+	}
+
+	static void query_value(const JsonPath& path, const JsonValue& v, std::uint64_t states, std::vector<const JsonValue*>& out) {
+		using Selector = JsonPath::Selector;
+		if (states & path_bit(path.steps.size())) out.push_back(&v);
+		if (v.type == ValueType::OBJECT_TYPE) {
+			for (auto&& [key, child] : as_object(v)) {
+				const auto next = path_next(path, states, [&](const JsonPath::Step& step) {
+					return step.selector == Selector::NAME ? step.name == key :
+						step.selector == Selector::WILDCARD || (step.selector == Selector::FILTER && filter_value(step.filter, child));
+				});
+				if (next) query_value(path, child, next, out);
+			}
+		}
+		else if (v.type == ValueType::ARRAY_TYPE) {
+			const auto& a = as_array(v);
+			for (std::size_t i = 0; i < a.size(); ++i) {
+				const auto next = path_next(path, states, [&](const JsonPath::Step& step) {
+					return step.selector == Selector::INDEX ? index_matches(step.index, i, a.size()) :
+						step.selector == Selector::WILDCARD || (step.selector == Selector::FILTER && filter_value(step.filter, a[i]));
+				});
+				if (next) query_value(path, a[i], next, out);
+			}
+		}
+	}
+
+	/* filter over the already validated text of one candidate, only the compared leaf is parsed */
+	bool filter_text(const JsonPath::Filter& filter, std::string_view candidate) {
+		const auto rest = json;
+		json = candidate;
+		bool result = true;
+		for (auto&& key : filter.path) {
+			const char* target = nullptr;
+			if (key.index < 0 && json.starts_with('{')) {
+				read_members([&](const std::string& name) {
+					if (name == key.name) target = json.data();
+					return skip_value();
+				});
+			}
+			else if (key.index >= 0 && json.starts_with('[')) {
+				read_elements([&](std::size_t i) {
+					if (static_cast<std::uint64_t>(key.index) == i) target = json.data();
+					return skip_value();
+				});
+			}
+			if (target == nullptr) {
+				result = false;
+				break;
+			}
+			json = std::string_view(target, static_cast<std::size_t>(candidate.data() + candidate.size() - target));
+		}
+		if (result && filter.compare != JsonPath::Compare::EXISTS) {
+			result = parse_value() == Status::PARSE_OK && filter_compare(filter, jsonValue);
+		}
+		json = rest;
+		return result;
+	}
+
+	/* consumes one value, recording it when selected and stepping only into children some state can reach */
+	Status query_text(const JsonPath& path, std::uint64_t states, std::vector<std::string_view>& out) {
+		using Selector = JsonPath::Selector;
+		const auto slot = out.size();
+		const char* begin = json.data();
+		const bool selected = states & path_bit(path.steps.size());
+		if (selected) out.emplace_back();
+		states &= ~path_bit(path.steps.size());
+		bool filters = false, negative = false;
+		for (std::size_t s = 0; s < path.steps.size(); ++s) {
+			if (!(states & path_bit(s))) continue;
+			filters = filters || path.steps[s].selector == Selector::FILTER;
+			negative = negative || (path.steps[s].selector == Selector::INDEX && path.steps[s].index < 0);
+		}
+		const auto child = [&](const std::string* key, std::size_t i, std::size_t size) {
+			/* a filter has to see the child before the next states are known */
+			std::string_view candidate;
+			if (filters) {
+				const char* start = json.data();
+				if (const auto ret = skip_value(); ret != Status::PARSE_OK) return ret;
+				candidate = { start, static_cast<std::size_t>(json.data() - start) };
+			}
+			const auto next = path_next(path, states, [&](const JsonPath::Step& step) {
+				switch (step.selector) {
+					case Selector::NAME: return key != nullptr && step.name == *key;
+					case Selector::INDEX: return key == nullptr && index_matches(step.index, i, size);
+					case Selector::WILDCARD: return true;
+					default: return filter_text(step.filter, candidate);
+				}
+			});
+			if (!filters) return next ? query_text(path, next, out) : skip_value();
+			if (!next) return Status::PARSE_OK;
+			const auto rest = json;
+			json = candidate;
+			const auto ret = query_text(path, next, out);
+			json = rest;
+			return ret;
+		};
+		auto ret = Status::PARSE_OK;
+		if (states == 0) {
+			ret = skip_value();
+		}
+		else if (json.starts_with('{')) {
+			ret = read_members([&](const std::string& key) { return child(&key, 0, 0); });
+		}
+		else if (json.starts_with('[')) {
+			std::size_t size = 0;
+			if (negative) {
+				/* counting pass so negative indices can be resolved on the way through */
+				const auto rest = json;
+				ret = read_elements([&](std::size_t) { ++size; return skip_value(); });
+				json = rest;
+			}
+			if (ret == Status::PARSE_OK) ret = read_elements([&](std::size_t i) { return child(nullptr, i, size); });
+		}
+		else {
+			ret = skip_value();
+		}
+		if (selected && ret == Status::PARSE_OK) out[slot] = { begin, static_cast<std::size_t>(json.data() - begin) };
+		return ret;
+	}
+
+	/*
+	 * Parallel serialization is planned as an alternating list of literal pieces ("[", ",", "\"key\":")
+	 * and task buffers. A container of at least the threshold in nodes is opened in place and its
+	 * children planned one by one; smaller siblings are grouped into runs of about threshold nodes.
+	 */
+	struct StringifyPlan {
+		struct Task {
+			std::size_t piece;
+			bool comma;		/* the run follows an earlier sibling */
+			std::vector<std::pair<const std::string*, const JsonValue*>> items;
+		};
+
+		std::size_t threshold = 1;
+		std::vector<std::string> pieces{ 1 };
+		std::vector<Task> tasks;
+
+		std::size_t add_task(bool comma) {
+			tasks.push_back({ pieces.size(), comma, {} });
+			pieces.emplace_back();
+			pieces.emplace_back();
+			return tasks.size() - 1;
+		}
+	};
+
+	std::vector<std::string> stringify_pieces() {
+		StringifyPlan plan;
+		plan.threshold = parallelStringifyThreshold;
+		plan_stringify(plan, jsonValue);
+		LEPTJSON_STAT(std::vector<Stats> taskStats(plan.tasks.size()));
+		auto run = [&](std::size_t i) {
+			auto& task = plan.tasks[i];
+			auto& out = plan.pieces[task.piece];
+			LeptJSON part;
+			LEPTJSON_STAT(part.stat_begin());
+			bool comma = task.comma;
+			for (auto&& [key, value] : task.items) {
+				if (comma) out += ',';
+				comma = true;
+				if (key) {
+					stringify_string(out, *key);
+					out += ':';
+				}
+				part.stringify_value(out, *value);
+			}
+			LEPTJSON_STAT(taskStats[i] = part.stats);
+		};
+		if (plan.tasks.size() == 1) {
+			run(0);
+		}
+		else {
+			ThreadPool::instance().parallel_for(plan.tasks.size(), run);
+		}
+		LEPTJSON_STAT(for (auto&& task : taskStats) stat_merge(task));
+		std::erase_if(plan.pieces, [](const std::string& piece) { return piece.empty(); });
+		return std::move(plan.pieces);
+	}
+
+	static void plan_stringify(StringifyPlan& plan, const JsonValue& jv) {
+		const bool container = (jv.type == ValueType::ARRAY_TYPE && !as_numbers(jv)) || jv.type == ValueType::OBJECT_TYPE;
+		if (!container || count_nodes(jv, plan.threshold) < plan.threshold) {
+			plan.tasks[plan.add_task(false)].items.emplace_back(nullptr, &jv);
+			return;
+		}
+		constexpr auto no_run = static_cast<std::size_t>(-1);
+		std::size_t run = no_run, runNodes = 0;
+		bool first = true;
+		auto visit = [&](const std::string* key, const JsonValue& child) {
+			const auto nodes = count_nodes(child, plan.threshold);
+			if (nodes >= plan.threshold && (child.type == ValueType::ARRAY_TYPE || child.type == ValueType::OBJECT_TYPE)) {
+				run = no_run;
+				if (!first) plan.pieces.back() += ',';
+				if (key) {
+					stringify_string(plan.pieces.back(), *key);
+					plan.pieces.back() += ':';
+				}
+				plan_stringify(plan, child);
+			}
+			else {
+				if (run == no_run) {
+					run = plan.add_task(!first);
+					runNodes = 0;
+				}
+				plan.tasks[run].items.emplace_back(key, &child);
+				runNodes += nodes;
+				if (runNodes >= plan.threshold) run = no_run;
+			}
+			first = false;
+		};
+		if (jv.type == ValueType::ARRAY_TYPE) {
+			plan.pieces.back() += '[';
+			for (auto&& value : as_array(jv)) visit(nullptr, value);
+			plan.pieces.back() += ']';
+		}
+		else {
+			plan.pieces.back() += '{';
+			for (auto&& [key, value] : as_object(jv)) visit(&key, value);
+			plan.pieces.back() += '}';
+		}
+	}
+
+	/* number of nodes in the subtree, counting stops once limit is reached */
+	static std::size_t count_nodes(const JsonValue& jv, std::size_t limit) {
+		std::size_t n = 1;
+		if (const auto* numbers = as_numbers(jv)) {
+			n += numbers->size();
+		}
+		else if (jv.type == ValueType::ARRAY_TYPE) {
+			for (auto&& value : as_array(jv)) {
+				if (n >= limit) break;
+				n += count_nodes(value, limit - n);
+			}
+		}
+		else if (jv.type == ValueType::OBJECT_TYPE) {
+			for (auto&& [key, value] : as_object(jv)) {
+				if (n >= limit) break;
+				n += count_nodes(value, limit - n);
+			}
+		}
+		return n;
+	}
+
+	void stringify_value(std::string& s, const JsonValue& jv);
+
+	static void stringify_number(std::string& s, double d);
+
+	static bool needs_escape(std::string_view value) {
+		return std::any_of(value.begin(), value.end(), [](char c) {
+			return c == '\"' || c == '\\' || static_cast<unsigned char>(c) < 0x20;
+		});
+	}
+
+	static void stringify_string(std::string& s, std::string_view value);
+
+	/*
+	 * Constant-evaluated parser behind embed(), writing the tape layout directly. It runs twice:
+	 * with null outputs to size the arrays, then to fill them. Numbers that the exact fast path
+	 * cannot convert keep their text for TapeView::get_number() to convert at run time.
+	 */
+	struct ConstParser {
+		std::string_view json;
+		std::uint64_t* words = nullptr;
+		char* strings = nullptr;
+		std::size_t word_count = 0;
+		std::size_t string_bytes = 0;
+		Status status = Status::PARSE_OK;
+
+		constexpr ConstParser& run() {
+			whitespace();
+			status = json.empty() ? Status::PARSE_EXPECT_VALUE : value();
+			if (status == Status::PARSE_OK) {
+				whitespace();
+				if (!json.empty()) status = Status::PARSE_ROOT_NOT_SINGULAR;
+			}
+			return *this;
+		}
+
+		constexpr void node(std::uint64_t tag, std::uint64_t payload, std::uint64_t second) {
+			if (words) {
+				words[word_count] = TapeView::little_endian(tag << 56 | payload);
+				words[word_count + 1] = TapeView::little_endian(second);
+			}
+			word_count += 2;
+		}
+
+		constexpr void put(char c) {
+			if (strings) strings[string_bytes] = c;
+			++string_bytes;
+		}
+
+		/* every power of ten up to 1e22 is exact in a double */
+		static constexpr double pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+		static constexpr bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+		constexpr void whitespace() {
+			while (json.starts_with(' ') || json.starts_with('\t') || json.starts_with('\n') || json.starts_with('\r')) {
+				json.remove_prefix(1);
+			}
+		}
+
+		constexpr Status value() {
+			switch (json[0]) {
+				case 't':
+					return literal("true", ValueType::TRUE_TYPE);
+				case 'f':
+					return literal("false", ValueType::FALSE_TYPE);
+				case 'n':
+					return literal("null", ValueType::NULL_TYPE);
+				case '"':
+				{
+					const auto offset = string_bytes;
+					const auto ret = string();
+					node(static_cast<std::uint64_t>(ValueType::STRING_TYPE), offset, string_bytes - offset);
+					return ret;
+				}
+				case '[':
+					return array();
+				case '{':
+					return object();
+				default:
+					return number();
+			}
+		}
+
+		constexpr Status literal(std::string_view text, ValueType type) {
+			if (!json.starts_with(text)) return Status::PARSE_INVALID_VALUE;
+			json.remove_prefix(text.size());
+			node(static_cast<std::uint64_t>(type), 0, 0);
+			return Status::PARSE_OK;
+		}
+
+		constexpr Status number() {
+			const auto text = json;
+			const bool negative = json.starts_with('-');
+			if (negative) json.remove_prefix(1);
+			std::uint64_t mantissa = 0;
+			int digits = 0, significant = 0, exponent = 0;
+			auto digit = [&](char c, bool fraction) {
+				if (mantissa == 0 && c == '0') {
+					exponent -= fraction;
+					return;
+				}
+				++significant;
+				if (digits < 19) {
+					mantissa = mantissa * 10 + static_cast<std::uint64_t>(c - '0');
+					++digits;
+					exponent -= fraction;
+				}
+				else {
+					exponent += !fraction;
+				}
+			};
+			if (json.empty() || !is_digit(json[0])) return Status::PARSE_INVALID_VALUE;
+			if (json[0] == '0') {
+				json.remove_prefix(1);
+			}
+			else {
+				for (; !json.empty() && is_digit(json[0]); json.remove_prefix(1)) digit(json[0], false);
+			}
+			if (json.starts_with('.')) {
+				json.remove_prefix(1);
+				if (json.empty() || !is_digit(json[0])) return Status::PARSE_INVALID_VALUE;
+				for (; !json.empty() && is_digit(json[0]); json.remove_prefix(1)) digit(json[0], true);
+			}
+			if (json.starts_with('e') || json.starts_with('E')) {
+				json.remove_prefix(1);
+				const bool minus = json.starts_with('-');
+				if (minus || json.starts_with('+')) json.remove_prefix(1);
+				if (json.empty() || !is_digit(json[0])) return Status::PARSE_INVALID_VALUE;
+				int e = 0;
+				for (; !json.empty() && is_digit(json[0]); json.remove_prefix(1)) {
+					e = std::min(e * 10 + (json[0] - '0'), 100000);
+				}
+				exponent += minus ? -e : e;
+			}
+			const auto length = text.size() - json.size();
+
+			double d = 0;
+			bool exact = mantissa == 0;
+			if (mantissa != 0) {
+				const int magnitude = exponent + digits - 1;
+				if (magnitude > 308 || (magnitude == 308 && above_max(text.substr(0, length)))) {
+					return Status::PARSE_NUMBER_TOO_BIG;
+				}
+				/* Clinger's fast path: both operands are exact doubles, so one rounding gives the right answer */
+				if (significant <= 19 && mantissa <= std::uint64_t{ 1 } << 53) {
+					if (exponent >= -22 && exponent <= 22) {
+						d = exponent < 0 ? static_cast<double>(mantissa) / pow10[-exponent] : static_cast<double>(mantissa) * pow10[exponent];
+						exact = true;
+					}
+					else if (exponent > 22 && exponent <= 22 + 15) {
+						auto scaled = mantissa;
+						for (int i = 22; i < exponent && scaled <= std::uint64_t{ 1 } << 53; i++) scaled *= 10;
+						if (scaled <= std::uint64_t{ 1 } << 53) {
+							d = static_cast<double>(scaled) * pow10[22];
+							exact = true;
+						}
+					}
+				}
+			}
+			if (exact) {
+				node(static_cast<std::uint64_t>(ValueType::NUMBER_TYPE), 0, std::bit_cast<std::uint64_t>(negative ? -d : d));
+			}
+			else {
+				const auto offset = string_bytes;
+				for (std::size_t i = 0; i < length; i++) put(text[i]);
+				put('\0');
+				node(TapeView::number_text_tag, offset, length);
+			}
+			return Status::PARSE_OK;
+		}
+
+		/* whether the significant digits reach the point where strtod overflows, 1.797693134862315807937...e308 */
+		static constexpr bool above_max(std::string_view text) {
+			constexpr std::string_view limit = "1797693134862315807937289714053034150799";
+			std::size_t i = 0;
+			for (char c : text) {
+				if (c == 'e' || c == 'E') break;
+				if (!is_digit(c) || (i == 0 && c == '0')) continue;
+				if (i == limit.size()) return false;
+				if (c != limit[i]) return c > limit[i];
+				++i;
+			}
+			return false;
+		}
+
+		constexpr Status string() {
+			json.remove_prefix(1);
+			while (!json.empty()) {
+				const char c = json[0];
+				json.remove_prefix(1);
+				if (c == '"') return Status::PARSE_OK;
+				if (static_cast<unsigned char>(c) < 0x20) return Status::PARSE_INVALID_STRING_CHAR;
+				if (c != '\\') {
+					put(c);
+					continue;
+				}
+				if (json.empty()) return Status::PARSE_INVALID_STRING_ESCAPE;
+				const char e = json[0];
+				json.remove_prefix(1);
+				switch (e) {
+					case '"': case '\\': case '/':
+						put(e);
+						break;
+					case 'b':
+						put('\b');
+						break;
+					case 'f':
+						put('\f');
+						break;
+					case 'n':
+						put('\n');
+						break;
+					case 'r':
+						put('\r');
+						break;
+					case 't':
+						put('\t');
+						break;
+					case 'u':
+					{
+						unsigned u = 0;
+						if (!hex4(u)) return Status::PARSE_INVALID_UNICODE_HEX;
+						if (u >= 0xD800 && u <= 0xDBFF) {
+							unsigned low = 0;
+							if (!json.starts_with("\\u")) return Status::PARSE_INVALID_UNICODE_SURROGATE;
+							json.remove_prefix(2);
+							if (!hex4(low)) return Status::PARSE_INVALID_UNICODE_HEX;
+							if (low < 0xDC00 || low > 0xDFFF) return Status::PARSE_INVALID_UNICODE_SURROGATE;
+							u = 0x10000 + ((u - 0xD800) << 10) + (low - 0xDC00);
+						}
+						char buffer[4]{};
+						const auto n = encode_utf8(buffer, u);
+						for (std::size_t i = 0; i < n; i++) put(buffer[i]);
+					}
+					break;
+					default:
+						return Status::PARSE_INVALID_STRING_ESCAPE;
+				}
+			}
+			return Status::PARSE_MISS_QUOTATION_MARK;
+		}
+
+		constexpr bool hex4(unsigned& u) {
+			if (json.size() < 4) return false;
+			u = 0;
+			for (int i = 0; i < 4; i++) {
+				const int d = hex_table[static_cast<unsigned char>(json[i])];
+				if (d < 0) return false;
+				u = u << 4 | static_cast<unsigned>(d);
+			}
+			json.remove_prefix(4);
+			return true;
+		}
+
+		constexpr void close(std::size_t start, ValueType type, std::size_t count) {
+			if (words) {
+				words[start] = TapeView::little_endian(static_cast<std::uint64_t>(type) << 56 | word_count);
+				words[start + 1] = TapeView::little_endian(count);
+			}
+		}
+
+		constexpr Status array() {
+			const auto start = word_count;
+			node(0, 0, 0);
+			json.remove_prefix(1);
+			whitespace();
+			std::size_t count = 0;
+			if (json.starts_with(']')) {
+				json.remove_prefix(1);
+				close(start, ValueType::ARRAY_TYPE, count);
+				return Status::PARSE_OK;
+			}
+			while (true) {
+				if (json.empty()) return Status::PARSE_EXPECT_VALUE;
+				const auto ret = value();
+				if (ret != Status::PARSE_OK) return ret;
+				++count;
+				whitespace();
+				if (json.starts_with(',')) {
+					json.remove_prefix(1);
+					whitespace();
+				}
+				else if (json.starts_with(']')) {
+					json.remove_prefix(1);
+					close(start, ValueType::ARRAY_TYPE, count);
+					return Status::PARSE_OK;
+				}
+				else {
+					return Status::PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+				}
+			}
+		}
+
+		constexpr Status object() {
+			const auto start = word_count;
+			node(0, 0, 0);
+			json.remove_prefix(1);
+			whitespace();
+			std::size_t count = 0;
+			if (json.starts_with('}')) {
+				json.remove_prefix(1);
+				close(start, ValueType::OBJECT_TYPE, count);
+				return Status::PARSE_OK;
+			}
+			while (true) {
+				if (!json.starts_with('"')) return Status::PARSE_MISS_KEY;
+				const auto offset = string_bytes;
+				auto ret = string();
+				if (ret != Status::PARSE_OK) return ret;
+				node(static_cast<std::uint64_t>(ValueType::STRING_TYPE), offset, string_bytes - offset);
+				whitespace();
+				if (!json.starts_with(':')) return Status::PARSE_MISS_COLON;
+				json.remove_prefix(1);
+				whitespace();
+				if (json.empty()) return Status::PARSE_EXPECT_VALUE;
+				ret = value();
+				if (ret != Status::PARSE_OK) return ret;
+				++count;
+				whitespace();
+				if (json.starts_with(',')) {
+					json.remove_prefix(1);
+					whitespace();
+				}
+				else if (json.starts_with('}')) {
+					json.remove_prefix(1);
+					close(start, ValueType::OBJECT_TYPE, count);
+					return Status::PARSE_OK;
+				}
+				else {
+					return Status::PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+				}
+			}
+		}
+	};
+
+	template <std::size_t Words, std::size_t Bytes>
+	struct EmbeddedTape {
+		std::array<std::uint64_t, Words> words;
+		std::array<char, Bytes> strings;
+	};
+
+	template <FixedString Text>
+	static consteval auto make_embedded() {
+		constexpr auto sized = ConstParser{ Text.view() }.run();
+		static_assert(sized.status == Status::PARSE_OK, "LeptJSON::embed: the text is not valid JSON");
+		EmbeddedTape<sized.word_count, sized.string_bytes> tape{};
+		ConstParser{ Text.view(), tape.words.data(), tape.strings.data() }.run();
+		return tape;
+	}
+
+	template <FixedString Text>
+	static constexpr auto embedded = make_embedded<Text>();
+
+	using BinaryDecoder = Status(*)(std::string_view&, JsonValue&);
+
+	static constexpr std::uint64_t binary_indefinite = ~std::uint64_t{ 0 };
+
+	Status from_binary(std::string_view bytes, BinaryDecoder decode) {
+		JsonValue v;
+		auto ret = bytes.empty() ? Status::PARSE_EXPECT_VALUE : decode(bytes, v);
+		if (ret == Status::PARSE_OK && !bytes.empty()) {
+			ret = Status::PARSE_ROOT_NOT_SINGULAR;
+		}
+		jsonValue = ret == Status::PARSE_OK ? std::move(v) : JsonValue{ nullptr, ValueType::NULL_TYPE };
+		return ret;
+	}
+
+	/* integral doubles that fit a 64-bit integer, -0.0 is left to the float forms so its sign survives */
+	static bool binary_unsigned(double d, std::uint64_t& u) {
+		if (!(d >= 0 && d < 18446744073709551616.0) || d != std::trunc(d) || std::signbit(d)) return false;
+		u = static_cast<std::uint64_t>(d);
+		return true;
+	}
+
+	static bool binary_negative(double d, std::int64_t& i) {
+		if (!(d < 0 && d >= -9223372036854775808.0) || d != std::trunc(d)) return false;
+		i = static_cast<std::int64_t>(d);
+		return true;
+	}
+
+	static bool binary_float32(double d) {
+		return !std::isfinite(d) ||
+			(std::fabs(d) <= std::numeric_limits<float>::max() && static_cast<double>(static_cast<float>(d)) == d);
+	}
+
+	static void put_big_endian(std::string& out, std::uint64_t v, int n) {
+		for (int shift = (n - 1) * 8; shift >= 0; shift -= 8) {
+			out += static_cast<char>(v >> shift);
+		}
+	}
+
+	static bool get_big_endian(std::string_view& in, std::uint64_t& v, std::size_t n) {
+		if (in.size() < n) return false;
+		v = 0;
+		for (std::size_t i = 0; i < n; i++) {
+			v = v << 8 | static_cast<unsigned char>(in[i]);
+		}
+		in.remove_prefix(n);
+		return true;
+	}
+
+	static Status binary_string(std::string_view& in, JsonValue& v, std::uint64_t n) {
+		if (in.size() < n) return Status::PARSE_INVALID_BINARY;
+		v = { std::string(in.substr(0, n)), ValueType::STRING_TYPE };
+		in.remove_prefix(n);
+		return Status::PARSE_OK;
+	}
+
+	/* reads n elements, or up to the CBOR break byte when n is binary_indefinite */
+	static Status binary_array(std::string_view& in, JsonValue& v, std::uint64_t n, BinaryDecoder decode) {
+		json_array_type a;
+		/* every element takes at least one byte, so a forged count cannot reserve more than the input */
+		a.reserve(std::min<std::uint64_t>(n, in.size()));
+		for (const bool indefinite = n == binary_indefinite; indefinite || n > 0; n -= !indefinite) {
+			if (indefinite && in.starts_with('\xff')) {
+				in.remove_prefix(1);
+				break;
+			}
+			a.emplace_back();
+			auto ret = decode(in, a.back());
+			if (ret != Status::PARSE_OK) return ret;
+		}
+		v = { std::move(a), ValueType::ARRAY_TYPE };
+		return Status::PARSE_OK;
+	}
+
+	static Status binary_object(std::string_view& in, JsonValue& v, std::uint64_t n, BinaryDecoder decode) {
+		json_object_type o;
+		for (const bool indefinite = n == binary_indefinite; indefinite || n > 0; n -= !indefinite) {
+			if (indefinite && in.starts_with('\xff')) {
+				in.remove_prefix(1);
+				break;
+			}
+			JsonValue key, value;
+			auto ret = decode(in, key);
+			if (ret != Status::PARSE_OK) return ret;
+			if (key.type != ValueType::STRING_TYPE) return Status::PARSE_INVALID_BINARY;
+			ret = decode(in, value);
+			if (ret != Status::PARSE_OK) return ret;
+			o.append(std::get<std::string>(std::move(key.value)), std::move(value));
+		}
+		o.sort();
+		v = { std::move(o), ValueType::OBJECT_TYPE };
+		return Status::PARSE_OK;
+	}
+
+	static void msgpack_value(std::string& out, const JsonValue& jv) {
+		switch (jv.type) {
+			case ValueType::NULL_TYPE:
+				out += '\xc0';
+				break;
+			case ValueType::FALSE_TYPE:
+				out += '\xc2';
+				break;
+			case ValueType::TRUE_TYPE:
+				out += '\xc3';
+				break;
+			case ValueType::NUMBER_TYPE:
+				msgpack_number(out, number_value(jv));
+				break;
+			case ValueType::STRING_TYPE:
+				msgpack_string(out, std::get<std::string>(jv.value));
+				break;
+			case ValueType::ARRAY_TYPE:
+			{
+				msgpack_length(out, element_count(jv), 0x90, 16, '\xdc');
+				for_each_element(jv, [&out](const JsonValue& value) { msgpack_value(out, value); });
+			}
+			break;
+			case ValueType::OBJECT_TYPE:
+			{
+				const auto& o = as_object(jv);
+				msgpack_length(out, o.size(), 0x80, 16, '\xde');
+				for (auto&& [key, value] : o) {
+					msgpack_string(out, key);
+					msgpack_value(out, value);
+				}
+			}
+			break;
+			default:
+				assert(0 && "invalid type");
+		}
+	}
+
+	static void msgpack_number(std::string& out, double d) {
+		std::uint64_t u;
+		std::int64_t i;
+		if (binary_unsigned(d, u)) {
+			if (u < 0x80) out += static_cast<char>(u);
+			else if (u <= 0xff) { out += '\xcc'; put_big_endian(out, u, 1); }
+			else if (u <= 0xffff) { out += '\xcd'; put_big_endian(out, u, 2); }
+			else if (u <= 0xffffffff) { out += '\xce'; put_big_endian(out, u, 4); }
+			else { out += '\xcf'; put_big_endian(out, u, 8); }
+		}
+		else if (binary_negative(d, i)) {
+			u = static_cast<std::uint64_t>(i);
+			if (i >= -32) out += static_cast<char>(i);
+			else if (i >= INT8_MIN) { out += '\xd0'; put_big_endian(out, u, 1); }
+			else if (i >= INT16_MIN) { out += '\xd1'; put_big_endian(out, u, 2); }
+			else if (i >= INT32_MIN) { out += '\xd2'; put_big_endian(out, u, 4); }
+			else { out += '\xd3'; put_big_endian(out, u, 8); }
+		}
+		else if (binary_float32(d)) {
+			out += '\xca';
+			put_big_endian(out, std::bit_cast<std::uint32_t>(static_cast<float>(d)), 4);
+		}
+		else {
+			out += '\xcb';
+			put_big_endian(out, std::bit_cast<std::uint64_t>(d), 8);
+		}
+	}
+
+	static void msgpack_string(std::string& out, const std::string& s) {
+		if (s.size() < 32) out += static_cast<char>(0xa0 | s.size());
+		else if (s.size() <= 0xff) { out += '\xd9'; put_big_endian(out, s.size(), 1); }
+		else msgpack_length(out, s.size(), 0, 0, '\xda');
+		out += s;
+	}
+
+	/* fix form below limit, then the 16-bit marker and the 32-bit one that follows it */
+	static void msgpack_length(std::string& out, std::size_t n, unsigned fix, std::size_t limit, char marker16) {
+		if (n < limit) {
+			out += static_cast<char>(fix | n);
+		}
+		else if (n <= 0xffff) {
+			out += marker16;
+			put_big_endian(out, n, 2);
+		}
+		else {
+			out += static_cast<char>(marker16 + 1);
+			put_big_endian(out, n, 4);
+		}
+	}
+
+	static Status msgpack_decode(std::string_view& in, JsonValue& v) {
+		std::uint64_t b, n;
+		if (!get_big_endian(in, b, 1)) return Status::PARSE_INVALID_BINARY;
+		if (b < 0x80) {
+			v = { static_cast<double>(b), ValueType::NUMBER_TYPE };
+			return Status::PARSE_OK;
+		}
+		if (b >= 0xe0) {
+			v = { static_cast<double>(static_cast<std::int8_t>(b)), ValueType::NUMBER_TYPE };
+			return Status::PARSE_OK;
+		}
+		if (b < 0x90) return binary_object(in, v, b & 0x0f, &msgpack_decode);
+		if (b < 0xa0) return binary_array(in, v, b & 0x0f, &msgpack_decode);
+		if (b < 0xc0) return binary_string(in, v, b & 0x1f);
+		switch (b) {
+			case 0xc0:
+				v = { nullptr, ValueType::NULL_TYPE };
+				return Status::PARSE_OK;
+			case 0xc2:
+				v = { false, ValueType::FALSE_TYPE };
+				return Status::PARSE_OK;
+			case 0xc3:
+				v = { true, ValueType::TRUE_TYPE };
+				return Status::PARSE_OK;
+			case 0xca:
+				if (!get_big_endian(in, n, 4)) return Status::PARSE_INVALID_BINARY;
+				v = { static_cast<double>(std::bit_cast<float>(static_cast<std::uint32_t>(n))), ValueType::NUMBER_TYPE };
+				return Status::PARSE_OK;
+			case 0xcb:
+				if (!get_big_endian(in, n, 8)) return Status::PARSE_INVALID_BINARY;
+				v = { std::bit_cast<double>(n), ValueType::NUMBER_TYPE };
+				return Status::PARSE_OK;
+			case 0xcc: case 0xcd: case 0xce: case 0xcf:
+				if (!get_big_endian(in, n, std::size_t{ 1 } << (b - 0xcc))) return Status::PARSE_INVALID_BINARY;
+				v = { static_cast<double>(n), ValueType::NUMBER_TYPE };
+				return Status::PARSE_OK;
+			case 0xd0: case 0xd1: case 0xd2: case 0xd3:
+			{
+				const auto shift = 64 - (8 << (b - 0xd0));
+				if (!get_big_endian(in, n, std::size_t{ 1 } << (b - 0xd0))) return Status::PARSE_INVALID_BINARY;
+				v = { static_cast<double>(static_cast<std::int64_t>(n << shift) >> shift), ValueType::NUMBER_TYPE };
+				return Status::PARSE_OK;
+			}
+			case 0xd9: case 0xda: case 0xdb:
+				if (!get_big_endian(in, n, std::size_t{ 1 } << (b - 0xd9))) return Status::PARSE_INVALID_BINARY;
+				return binary_string(in, v, n);
+			case 0xdc: case 0xdd:
+				if (!get_big_endian(in, n, b == 0xdc ? 2 : 4)) return Status::PARSE_INVALID_BINARY;
+				return binary_array(in, v, n, &msgpack_decode);
+			case 0xde: case 0xdf:
+				if (!get_big_endian(in, n, b == 0xde ? 2 : 4)) return Status::PARSE_INVALID_BINARY;
+				return binary_object(in, v, n, &msgpack_decode);
+			default:	/* never used, bin and ext have no JSON counterpart */
+				return Status::PARSE_INVALID_BINARY;
+		}
+	}
+
+	static void cbor_head(std::string& out, unsigned major, std::uint64_t n) {
+		const auto m = static_cast<char>(major << 5);
+		if (n < 24) out += static_cast<char>(m | n);
+		else if (n <= 0xff) { out += static_cast<char>(m | 24); put_big_endian(out, n, 1); }
+		else if (n <= 0xffff) { out += static_cast<char>(m | 25); put_big_endian(out, n, 2); }
+		else if (n <= 0xffffffff) { out += static_cast<char>(m | 26); put_big_endian(out, n, 4); }
+		else { out += static_cast<char>(m | 27); put_big_endian(out, n, 8); }
+	}
+
+	static void cbor_value(std::string& out, const JsonValue& jv) {
+		switch (jv.type) {
+			case ValueType::NULL_TYPE:
+				out += '\xf6';
+				break;
+			case ValueType::FALSE_TYPE:
+				out += '\xf4';
+				break;
+			case ValueType::TRUE_TYPE:
+				out += '\xf5';
+				break;
+			case ValueType::NUMBER_TYPE:
+			{
+				const double d = number_value(jv);
+				std::uint64_t u;
+				std::int64_t i;
+				if (binary_unsigned(d, u)) {
+					cbor_head(out, 0, u);
+				}
+				else if (binary_negative(d, i)) {
+					cbor_head(out, 1, static_cast<std::uint64_t>(-1 - i));
+				}
+				else if (binary_float32(d)) {
+					out += '\xfa';
+					put_big_endian(out, std::bit_cast<std::uint32_t>(static_cast<float>(d)), 4);
+				}
+				else {
+					out += '\xfb';
+					put_big_endian(out, std::bit_cast<std::uint64_t>(d), 8);
+				}
+			}
+			break;
+			case ValueType::STRING_TYPE:
+			{
+				const auto& s = std::get<std::string>(jv.value);
+				cbor_head(out, 3, s.size());
+				out += s;
+			}
+			break;
+			case ValueType::ARRAY_TYPE:
+			{
+				cbor_head(out, 4, element_count(jv));
+				for_each_element(jv, [&out](const JsonValue& value) { cbor_value(out, value); });
+			}
+			break;
+			case ValueType::OBJECT_TYPE:
+			{
+				const auto& o = as_object(jv);
+				cbor_head(out, 5, o.size());
+				for (auto&& [key, value] : o) {
+					cbor_head(out, 3, key.size());
+					out += key;
+					cbor_value(out, value);
+				}
+			}
+			break;
+			default:
+				assert(0 && "invalid type");
+		}
+	}
+
+	/* argument of an initial byte, binary_indefinite for additional information 31 */
+	static bool cbor_argument(std::string_view& in, std::uint64_t info, std::uint64_t& n) {
+		if (info < 24) {
+			n = info;
+			return true;
+		}
+		if (info < 28) return get_big_endian(in, n, std::size_t{ 1 } << (info - 24));
+		n = binary_indefinite;
+		return info == 31;
+	}
+
+	static double cbor_half(std::uint64_t h) {
+		const auto exponent = static_cast<int>(h >> 10 & 0x1f);
+		const auto mantissa = static_cast<double>(h & 0x3ff);
+		double d;
+		if (exponent == 0) d = std::ldexp(mantissa, -24);
+		else if (exponent != 31) d = std::ldexp(mantissa + 1024, exponent - 25);
+		else d = mantissa == 0 ? HUGE_VAL : std::numeric_limits<double>::quiet_NaN();
+		return h & 0x8000 ? -d : d;
+	}
+
+	static Status cbor_decode(std::string_view& in, JsonValue& v) {
+		std::uint64_t b, n;
+		if (!get_big_endian(in, b, 1)) return Status::PARSE_INVALID_BINARY;
+		const auto major = b >> 5, info = b & 0x1f;
+		if (major == 7) {
+			switch (info) {
+				case 20:
+					v = { false, ValueType::FALSE_TYPE };
 					return Status::PARSE_OK;
-				case '\\':
-					json.remove_prefix(1);
-					if (json.empty())return Status::PARSE_INVALID_STRING_ESCAPE;
-					switch (json.front()) {
-						default:
-							return Status::PARSE_INVALID_STRING_ESCAPE;
-						case '\"':
-							s += '\"';
-							break;
-						case '\\':
-							s += '\\';
-							break;
-						case '/':
-							s += '/';
-							break;
-						case 'b':
-							s += '\b';
-							break;
-						case 'f':
-							s += '\f';
-							break;
-						case 'n':
-							s += '\n';
-							break;
-						case 'r':
-							s += '\r';
-							break;
-						case 't':
-							s += '\t';
-							break;
-						case 'u':
-							unsigned int u{};
-							if (!parse_hex4(u)) {
-								return Status::PARSE_INVALID_UNICODE_HEX;
-							}
-							if (u >= 0xD800 && u <= 0xDBFF) { /* surrogate pair */
-								json.remove_prefix(5);
-								if (!json.starts_with('\\')) {
-									return Status::PARSE_INVALID_UNICODE_SURROGATE;
-								}
-								json.remove_prefix(1);
-								if (!json.starts_with('u')) {
-									return Status::PARSE_INVALID_UNICODE_SURROGATE;
-								}
-								unsigned int u2{};
-								if (!parse_hex4(u2)) {
-									return Status::PARSE_INVALID_UNICODE_HEX;
-								}
-								if (u2 < 0xDC00 || u2 > 0xDFFF) {
-									return Status::PARSE_INVALID_UNICODE_SURROGATE;
-								}
-								u = (((u - 0xD800) << 10) | (u2 - 0xDC00)) + 0x10000;
-							}
-							json.remove_prefix(4);
-							encode_utf8(s, u);
-							break;
+				case 21:
+					v = { true, ValueType::TRUE_TYPE };
+					return Status::PARSE_OK;
+				case 22: case 23:
+					v = { nullptr, ValueType::NULL_TYPE };
+					return Status::PARSE_OK;
+				case 25:
+					if (!get_big_endian(in, n, 2)) return Status::PARSE_INVALID_BINARY;
+					v = { cbor_half(n), ValueType::NUMBER_TYPE };
+					return Status::PARSE_OK;
+				case 26:
+					if (!get_big_endian(in, n, 4)) return Status::PARSE_INVALID_BINARY;
+					v = { static_cast<double>(std::bit_cast<float>(static_cast<std::uint32_t>(n))), ValueType::NUMBER_TYPE };
+					return Status::PARSE_OK;
+				case 27:
+					if (!get_big_endian(in, n, 8)) return Status::PARSE_INVALID_BINARY;
+					v = { std::bit_cast<double>(n), ValueType::NUMBER_TYPE };
+					return Status::PARSE_OK;
+				default:	/* other simple values, and a break outside an indefinite container */
+					return Status::PARSE_INVALID_BINARY;
+			}
+		}
+		if (!cbor_argument(in, info, n)) return Status::PARSE_INVALID_BINARY;
+		if (n == binary_indefinite && (major < 3 || major > 5)) return Status::PARSE_INVALID_BINARY;
+		switch (major) {
+			case 0:
+				v = { static_cast<double>(n), ValueType::NUMBER_TYPE };
+				return Status::PARSE_OK;
+			case 1:
+				v = { -1.0 - static_cast<double>(n), ValueType::NUMBER_TYPE };
+				return Status::PARSE_OK;
+			case 3:
+				return n == binary_indefinite ? cbor_text_chunks(in, v) : binary_string(in, v, n);
+			case 4:
+				return binary_array(in, v, n, &cbor_decode);
+			case 5:
+				return binary_object(in, v, n, &cbor_decode);
+			case 6:	/* tags carry no meaning in the JSON model, decode the tagged item */
+				return cbor_decode(in, v);
+			default:	/* byte strings */
+				return Status::PARSE_INVALID_BINARY;
+		}
+	}
+
+	/* indefinite-length text: definite text chunks up to the break byte */
+	static Status cbor_text_chunks(std::string_view& in, JsonValue& v) {
+		std::string s;
+		for (;;) {
+			std::uint64_t b, n;
+			if (!get_big_endian(in, b, 1)) return Status::PARSE_INVALID_BINARY;
+			if (b == 0xff) break;
+			if (b >> 5 != 3 || !cbor_argument(in, b & 0x1f, n) || n == binary_indefinite || in.size() < n) {
+				return Status::PARSE_INVALID_BINARY;
+			}
+			s.append(in.substr(0, n));
+			in.remove_prefix(n);
+		}
+		v = { std::move(s), ValueType::STRING_TYPE };
+		return Status::PARSE_OK;
+	}
+
+	struct TapeWriter {
+		std::vector<std::uint64_t> words;
+		std::string strings;
+		std::unordered_map<std::string_view, std::uint64_t> offsets;	/* equal strings share one blob range */
+
+		void node(ValueType type, std::uint64_t payload, std::uint64_t second) {
+			words.push_back(static_cast<std::uint64_t>(type) << 56 | payload);
+			words.push_back(second);
+		}
+
+		void string(std::string_view s) {
+			auto [it, inserted] = offsets.try_emplace(s, strings.size());
+			if (inserted) strings += s;
+			node(ValueType::STRING_TYPE, it->second, s.size());
+		}
+
+		void value(const JsonValue& jv) {
+			switch (jv.type) {
+				case ValueType::NUMBER_TYPE:
+					if (const auto* raw = std::get_if<RawNumber>(&jv.value)) {
+						node(static_cast<ValueType>(TapeView::number_text_tag), strings.size(), raw->text().size());
+						strings += raw->text();
+						strings += '\0';
+					}
+					else {
+						node(jv.type, 0, std::bit_cast<std::uint64_t>(std::get<double>(jv.value)));
+					}
+					break;
+				case ValueType::STRING_TYPE:
+					string(std::get<std::string>(jv.value));
+					break;
+				case ValueType::ARRAY_TYPE:
+				{
+					const auto start = words.size();
+					node(jv.type, 0, element_count(jv));
+					for_each_element(jv, [this](const JsonValue& element) { value(element); });
+					words[start] |= words.size();
+				}
+				break;
+				case ValueType::OBJECT_TYPE:
+				{
+					const auto start = words.size();
+					node(jv.type, 0, as_object(jv).size());
+					for (auto&& [key, value] : as_object(jv)) {
+						string(key);
+						this->value(value);
+					}
+					words[start] |= words.size();
+				}
+				break;
+				default:
+					node(jv.type, 0, 0);
+			}
+		}
+	};
+
+	static void put_little_endian(std::string& out, std::uint64_t v) {
+		for (int i = 0; i < 8; i++, v >>= 8) {
+			out += static_cast<char>(v & 0xff);
+		}
+	}
+
+	static JsonValue tape_value(TapeView t) {
+		switch (t.get_type()) {
+			case ValueType::NULL_TYPE:
+				return { nullptr, ValueType::NULL_TYPE };
+			case ValueType::FALSE_TYPE:
+				return { false, ValueType::FALSE_TYPE };
+			case ValueType::TRUE_TYPE:
+				return { true, ValueType::TRUE_TYPE };
+			case ValueType::NUMBER_TYPE:
+				if (t.word(0) >> 56 == TapeView::number_text_tag) {
+					return { RawNumber(std::string_view(t.strings + t.payload(), static_cast<std::size_t>(t.word(1)))), ValueType::NUMBER_TYPE };
+				}
+				return { t.get_number(), ValueType::NUMBER_TYPE };
+			case ValueType::STRING_TYPE:
+				return { std::string(t.get_string()), ValueType::STRING_TYPE };
+			case ValueType::ARRAY_TYPE:
+			{
+				const auto elements = t.get_array();
+				json_array_type a;
+				a.reserve(elements.size());
+				for (auto element : elements) a.push_back(tape_value(element));
+				return { std::move(a), ValueType::ARRAY_TYPE };
+			}
+			case ValueType::OBJECT_TYPE:
+			{
+				/* members of a tape need not be sorted, as embed<> writes them in declaration order */
+				json_object_type o;
+				for (auto [key, value] : t.get_object()) o.append(std::string(key), tape_value(value));
+				o.sort();
+				return { std::move(o), ValueType::OBJECT_TYPE };
+			}
+			default:
+				assert(0 && "invalid type");
+				return { nullptr, ValueType::NULL_TYPE };
+		}
+	}
+
+	friend ValueType get_type(const JsonValue& jv) { return jv.type; }
+
+	friend bool get_boolean(const JsonValue& jv) {
+		assert(jv.type == ValueType::TRUE_TYPE || jv.type == ValueType::FALSE_TYPE);
+		return std::get<bool>(jv.value);
+	}
+
+	friend double get_number(const JsonValue& jv) {
+		return number_value(jv);
+	}
+
+	friend std::int64_t get_int64(const JsonValue& jv) {
+		return number_int64(jv);
+	}
+
+	friend std::string_view get_string(const JsonValue& jv) {
+		assert(jv.type == ValueType::STRING_TYPE);
+		return std::string_view{ std::get<std::string>(jv.value).data(), std::get<std::string>(jv.value).size() };
+	}
+
+	friend const json_array_type& get_array(const JsonValue& jv) {
+		return as_array(jv);
+	}
+
+	friend const json_object_type& get_object(const JsonValue& jv) {
+		return as_object(jv);
+	}
+
+	friend bool is_number_array(const JsonValue& jv) {
+		return as_numbers(jv) != nullptr;
+	}
+
+	friend std::span<const double> get_numbers(const JsonValue& jv) {
+		assert(as_numbers(jv) != nullptr);
+		return *as_numbers(jv);
+	}
+
+	/* writable access to a nested container, cloning it first if it is shared */
+	friend json_array_type& mutable_array(JsonValue& jv) {
+		return detach_array(jv);
+	}
+
+	friend json_object_type& mutable_object(JsonValue& jv) {
+		return detach_object(jv);
+	}
+
+	friend std::size_t hash(const JsonValue& jv) {
+		return hash_value(jv);
+	}
+
+	friend bool operator==(const JsonValue& lhs, const JsonValue& rhs) {
+		if (lhs.type != rhs.type) return false;
+		switch (lhs.type) {
+			case ValueType::NULL_TYPE:
+			case ValueType::FALSE_TYPE:
+			case ValueType::TRUE_TYPE:
+				return true;
+			case ValueType::ARRAY_TYPE:
+			{
+				/* a shared subtree is equal to itself, and kept hashes that differ rule equality out */
+				const auto* ln = std::get_if<json_numbers_ptr>(&lhs.value);
+				const auto* rn = std::get_if<json_numbers_ptr>(&rhs.value);
+				if (ln && rn) {
+					const auto& l = **ln;
+					const auto& r = **rn;
+					return &l == &r || (!hash_mismatch(l, r) && l.items == r.items);
+				}
+				if (ln || rn) {
+					return std::ranges::equal((ln ? *ln : *rn)->items, as_array(ln ? rhs : lhs), [](double d, const JsonValue& value) {
+						return value.type == ValueType::NUMBER_TYPE && number_value(value) == d;
+					});
+				}
+				const auto& l = *std::get<json_array_ptr>(lhs.value);
+				const auto& r = *std::get<json_array_ptr>(rhs.value);
+				return &l == &r || (!hash_mismatch(l, r) && l.items == r.items);
+			}
+			case ValueType::OBJECT_TYPE:
+			{
+				const auto& l = *std::get<json_object_ptr>(lhs.value);
+				const auto& r = *std::get<json_object_ptr>(rhs.value);
+				return &l == &r || (!hash_mismatch(l, r) && l.items == r.items);
+			}
+			case ValueType::NUMBER_TYPE:
+				return number_value(lhs) == number_value(rhs);
+			default:
+				return lhs.value == rhs.value;
+		}
+	}
+};
+
+constexpr LeptJSON::TapeArray LeptJSON::TapeView::get_array() const {
+	assert(get_type() == ValueType::ARRAY_TYPE);
+	return TapeArray(*this);
+}
+
+constexpr LeptJSON::TapeObject LeptJSON::TapeView::get_object() const {
+	assert(get_type() == ValueType::OBJECT_TYPE);
+	return TapeObject(*this);
+}
+
+constexpr std::optional<LeptJSON::TapeView> LeptJSON::TapeView::find(std::string_view key) const {
+	std::optional<TapeView> found;
+	for (auto [k, v] : get_object()) {
+		if (k == key) found = v;
+	}
+	return found;
+}
+
+/*
+ * Pull parser over the text of a document: the caller asks for one token at a time. Separators and
+ * nesting are checked as the cursor moves; skip_value() checks only brackets and quotes inside what
+ * it skips. Nothing is allocated except the buffer read_string(std::string_view&) reuses for strings
+ * with escapes. The first error sticks, after it every token is ERROR and status() tells why.
+ */
+class LeptJSON::Reader {
+public:
+	enum class Token {
+		BEGIN_ARRAY, END_ARRAY, BEGIN_OBJECT, END_OBJECT, KEY, STRING, NUMBER, TRUE_VALUE, FALSE_VALUE, NULL_VALUE,
+		END_DOCUMENT, ERROR
+	};
+
+	static constexpr std::size_t max_depth = 1024;
+
+	explicit Reader(std::string_view text, ParseFlag flags = ParseFlag::PARSE_DEFAULT) : parser(text) {
+		parser.parseFlags = flags;
+	}
+
+	/* kind of the next token, nothing is consumed */
+	[[nodiscard]] Token peek_type() {
+		return locate();
+	}
+
+	/* consumes one token: a bracket, or a whole key, string, number or literal */
+	Token next() {
+		const auto token = locate();
+		auto ret = Status::PARSE_OK;
+		switch (token) {
+			case Token::BEGIN_ARRAY:
+			case Token::BEGIN_OBJECT:
+				if (depth == max_depth) return fail(Status::PARSE_DEPTH_EXCEEDED);
+				objects[depth++] = token == Token::BEGIN_OBJECT;
+				parser.json.remove_prefix(1);
+				state = State::FIRST;
+				return token;
+			case Token::END_ARRAY:
+			case Token::END_OBJECT:
+				--depth;
+				parser.json.remove_prefix(1);
+				state = State::AFTER;
+				return token;
+			case Token::KEY:
+			case Token::STRING:
+			{
+				std::string_view s;
+				ret = string_token(s);
+				break;
+			}
+			case Token::NUMBER:
+			{
+				std::string_view judge = parser.json;
+				if (!scan_number(judge)) ret = Status::PARSE_INVALID_VALUE;
+				else parser.json = judge;
+				break;
+			}
+			case Token::TRUE_VALUE:
+				ret = parser.parse_literal("true", ValueType::TRUE_TYPE);
+				break;
+			case Token::FALSE_VALUE:
+				ret = parser.parse_literal("false", ValueType::FALSE_TYPE);
+				break;
+			case Token::NULL_VALUE:
+				ret = parser.parse_literal("null", ValueType::NULL_TYPE);
+				break;
+			default:
+				return token;
+		}
+		if (ret != Status::PARSE_OK) return fail(ret);
+		state = token == Token::KEY ? State::VALUE : State::AFTER;
+		return token;
+	}
+
+	/*
+	 * Consumes the next value, a key together with its value. Containers are skipped by a scan
+	 * that only matches brackets outside of strings.
+	 */
+	Status skip_value() {
+		auto token = locate();
+		if (token == Token::KEY) {
+			next();
+			token = locate();
+		}
+		if (token == Token::BEGIN_ARRAY || token == Token::BEGIN_OBJECT) {
+			if (!skip_container(parser.json)) {
+				return set_error(token == Token::BEGIN_ARRAY ? Status::PARSE_MISS_COMMA_OR_SQUARE_BRACKET : Status::PARSE_MISS_COMMA_OR_CURLY_BRACKET);
+			}
+			state = State::AFTER;
+			return Status::PARSE_OK;
+		}
+		if (token == Token::END_ARRAY || token == Token::END_OBJECT || token == Token::END_DOCUMENT) {
+			return Status::PARSE_EXPECT_VALUE;
+		}
+		next();
+		return error;
+	}
+
+	/*
+	 * Consumes a key or string. s views the input when the string has no escapes, otherwise a
+	 * buffer owned by the reader that the next such string overwrites.
+	 */
+	Status read_string(std::string_view& s) {
+		const auto token = locate();
+		if (token == Token::ERROR) return error;
+		if (token != Token::KEY && token != Token::STRING) return Status::PARSE_TYPE_MISMATCH;
+		if (const auto ret = string_token(s); ret != Status::PARSE_OK) return set_error(ret);
+		state = token == Token::KEY ? State::VALUE : State::AFTER;
+		return Status::PARSE_OK;
+	}
+
+	/* consumes a key or string, decoded into the caller's buffer */
+	Status read_string(std::string& s) {
+		std::string_view view;
+		const auto ret = read_string(view);
+		if (ret == Status::PARSE_OK) s.assign(view);
+		return ret;
+	}
+
+	Status read_number(double& d) {
+		const auto token = locate();
+		if (token == Token::ERROR) return error;
+		if (token != Token::NUMBER) return Status::PARSE_TYPE_MISMATCH;
+		std::string_view judge = parser.json;
+		if (!scan_number(judge)) return set_error(Status::PARSE_INVALID_VALUE);
+		if (!convert_number(parser.json.substr(0, parser.json.size() - judge.size()), d)) {
+			return set_error(Status::PARSE_NUMBER_TOO_BIG);
+		}
+		parser.json = judge;
+		state = State::AFTER;
+		return Status::PARSE_OK;
+	}
+
+	[[nodiscard]] Status status() const { return error; }
+
+	/* containers entered and not yet left */
+	[[nodiscard]] std::size_t get_depth() const { return depth; }
+
+private:
+	enum class State {
+		VALUE,		/* a value must follow */
+		KEY,		/* a member must follow */
+		FIRST,		/* just inside a bracket, which may close at once */
+		AFTER		/* a value ended, a separator, a closing bracket or the end follows */
+	};
+
+	/* moves past whitespace and separators to the next token, which stays in front */
+	Token locate() {
+		if (error != Status::PARSE_OK) return Token::ERROR;
+		auto& json = parser.json;
+		parser.parse_whitespace();
+		const bool object = depth > 0 && objects[depth - 1];
+		if (state == State::AFTER) {
+			if (depth == 0) {
+				return json.empty() || json.starts_with('\0') ? Token::END_DOCUMENT : fail(Status::PARSE_ROOT_NOT_SINGULAR);
+			}
+			if (json.starts_with(object ? '}' : ']')) return object ? Token::END_OBJECT : Token::END_ARRAY;
+			if (!json.starts_with(',')) {
+				return fail(object ? Status::PARSE_MISS_COMMA_OR_CURLY_BRACKET : Status::PARSE_MISS_COMMA_OR_SQUARE_BRACKET);
+			}
+			json.remove_prefix(1);
+			parser.parse_whitespace();
+			state = object ? State::KEY : State::VALUE;
+		}
+		else if (state == State::FIRST) {
+			if (json.starts_with(object ? '}' : ']')) return object ? Token::END_OBJECT : Token::END_ARRAY;
+			state = object ? State::KEY : State::VALUE;
+		}
+		if (state == State::KEY) {
+			return json.starts_with('\"') ? Token::KEY : fail(Status::PARSE_MISS_KEY);
+		}
+		if (json.empty()) return fail(Status::PARSE_EXPECT_VALUE);
+		switch (json[0]) {
+			case '[':
+				return Token::BEGIN_ARRAY;
+			case '{':
+				return Token::BEGIN_OBJECT;
+			case '\"':
+				return Token::STRING;
+			case 't':
+				return Token::TRUE_VALUE;
+			case 'f':
+				return Token::FALSE_VALUE;
+			case 'n':
+				return Token::NULL_VALUE;
+			case '\0':
+				return fail(Status::PARSE_EXPECT_VALUE);
+			default:
+				return Token::NUMBER;
+		}
+	}
+
+	/* reads the string in front, a key also takes its colon */
+	Status string_token(std::string_view& s) {
+		auto& json = parser.json;
+		const auto start = json;
+		json.remove_prefix(1);
+		std::size_t n{};
+		if (!parser.scan_string_run(n)) return Status::PARSE_INVALID_UTF8;
+		if (n < json.size() && json[n] == '\"') {
+			s = json.substr(0, n);
+			json.remove_prefix(n + 1);
+		}
+		else {
+			json = start;
+			parser.skipBuffer.clear();
+			if (const auto ret = parser.parse_string_raw(parser.skipBuffer); ret != Status::PARSE_OK) return ret;
+			s = parser.skipBuffer;
+		}
+		if (state == State::KEY) {
+			parser.parse_whitespace();
+			if (!json.starts_with(':')) return Status::PARSE_MISS_COLON;
+			json.remove_prefix(1);
+		}
+		return Status::PARSE_OK;
+	}
+
+	/* matches brackets up to the one closing the container in front, skipping strings by their quotes */
+	static bool skip_container(std::string_view& json) {
+		const char* p = json.data();
+		const char* const end = p + json.size();
+		std::size_t level = 0;
+		while (p != end) {
+			switch (*p++) {
+				case '\"':
+					while (true) {
+						p = static_cast<const char*>(std::memchr(p, '\"', static_cast<std::size_t>(end - p)));
+						if (p == nullptr) return false;
+						const char* q = p++;
+						while (q[-1] == '\\') --q;
+						if ((p - 1 - q) % 2 == 0) break;	/* an even run of backslashes escapes only itself */
 					}
 					break;
-				default:
-					if (static_cast<unsigned char>(json.front()) < 0x20) {
-						return Status::PARSE_INVALID_STRING_CHAR;
+				case '[':
+				case '{':
+					++level;
+					break;
+				case ']':
+				case '}':
+					if (--level == 0) {
+						json.remove_prefix(static_cast<std::size_t>(p - json.data()));
+						return true;
 					}
-					s += json.front();
+					break;
 			}
 		}
-		return Status::PARSE_MISS_QUOTATION_MARK;
+		return false;
 	}
 
-	bool parse_hex4(unsigned int& u) {
-		if (json.size() < 5)return false;
-		for (int i = 1; i < 5; i++) {
-			u <<= 4;
-			if (json[i] >= '0' && json[i] <= '9') u |= json[i] - '0';
-			else if (json[i] >= 'A' && json[i] <= 'F') u |= json[i] - 'A' + 10;
-			else if (json[i] >= 'a' && json[i] <= 'f') u |= json[i] - 'a' + 10;
-			else return false;
-		}
-		return true;
+	Status set_error(Status status) {
+		error = status;
+		return status;
 	}
 
-	static void encode_utf8(std::string& s, const unsigned int& u) {
-		if (u <= 0x7f) {
-			s += u & 0xff;
+	Token fail(Status status) {
+		set_error(status);
+		return Token::ERROR;
+	}
+
+	LeptJSON parser;
+	std::bitset<max_depth> objects;		/* per open container, set for an object */
+	std::size_t depth = 0;
+	State state = State::VALUE;
+	Status error = Status::PARSE_OK;
+};
+
+LEPTJSON_API bool is_equal(const LeptJSON& lhs, const LeptJSON& rhs);
+LEPTJSON_API void copy(LeptJSON& lhs, const LeptJSON& rhs);
+LEPTJSON_API void move(LeptJSON& lhs, LeptJSON&& rhs);
+LEPTJSON_API void swap(LeptJSON& lhs, LeptJSON& rhs);
+
+template <>
+struct std::hash<LeptJSON> {
+	std::size_t operator()(const LeptJSON& v) const {
+		return v.hash();
+	}
+};
+
+/* the containers every tree is built from are instantiated once, in LeptJSON.cpp */
+#ifndef LEPTJSON_HEADER_ONLY
+extern template class LEPTJSON_TEMPLATE_API LeptJSON::SmallVector<LeptJSON::JsonValue, LEPTJSON_SMALL_CAPACITY>;
+extern template class LEPTJSON_TEMPLATE_API LeptJSON::SmallMap<LeptJSON::JsonValue, LEPTJSON_SMALL_CAPACITY>;
+extern template class LEPTJSON_TEMPLATE_API LeptJSON::SmallVector<double, LEPTJSON_SMALL_CAPACITY>;
+#endif
+
+#if defined(LEPTJSON_HEADER_ONLY) || defined(LEPTJSON_IMPLEMENTATION)
+
+/* system headers stay out of the interface, a compiled-library build keeps them out of its users entirely */
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+LEPTJSON_INLINE LeptJSON::MappedFile::MappedFile(const char* path) {
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) return;
+	LARGE_INTEGER size;
+	if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping) {
+			data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+			if (data) length = static_cast<std::size_t>(size.QuadPart);
+			CloseHandle(mapping);
 		}
-		else if (u <= 0x7ff) {
-			s += 0xC0 | ((u >> 6) & 0xFF);
-			s += 0x80 | (u & 0x3F);
+	}
+	CloseHandle(file);
+#else
+	const int fd = ::open(path, O_RDONLY);
+	if (fd < 0) return;
+	struct stat st;
+	if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+		void* p = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		if (p != MAP_FAILED) {
+			data = static_cast<const char*>(p);
+			length = static_cast<std::size_t>(st.st_size);
 		}
-		else if (u <= 0xffff) {
-			s += 0xE0 | ((u >> 12) & 0xFF);
-			s += 0x80 | ((u >> 6) & 0x3F);
-			s += 0x80 | (u & 0x3F);
+	}
+	::close(fd);
+#endif
+}
+
+LEPTJSON_INLINE void LeptJSON::MappedFile::unmap() {
+	if (!data) return;
+#ifdef _WIN32
+	UnmapViewOfFile(data);
+#else
+	::munmap(const_cast<char*>(data), length);
+#endif
+	data = nullptr;
+	length = 0;
+}
+
+#ifndef _WIN32
+LEPTJSON_INLINE std::vector<iovec> LeptJSON::Segments::iovecs() const {
+	std::vector<iovec> out;
+	out.reserve(pieces.size());
+	for (auto&& piece : pieces) {
+		const auto v = view(piece);
+		out.push_back({ const_cast<char*>(v.data()), v.size() });
+	}
+	return out;
+}
+#endif
+
+LEPTJSON_INLINE LeptJSON::Status LeptJSON::parse(ParseFlag flags) {
+	LEPTJSON_STAT(stat_begin(); const auto start = std::chrono::steady_clock::now(); const auto size = json.size());
+	parseFlags = flags;
+	jsonValue.type = ValueType::NULL_TYPE;
+	parse_whitespace();
+	auto ret = Status::PARSE_OK;
+	if (!has_flag(ParseFlag::PARSE_PARALLEL) || !parse_array_parallel()) {
+		ret = parse_value();
+	}
+	if (ret == Status::PARSE_OK) {
+		parse_whitespace();
+		if (!json.empty() && !json.starts_with('\0')) {
+			jsonValue.type = ValueType::NULL_TYPE;
+			ret = Status::PARSE_ROOT_NOT_SINGULAR;
 		}
-		else {
-			assert(u <= 0x10ffff);
-			s += 0xF0 | ((u >> 18) & 0xFF);
-			s += 0x80 | ((u >> 12) & 0x3F);
-			s += 0x80 | ((u >> 6) & 0x3F);
-			s += 0x80 | (u & 0x3F);
+	}
+	LEPTJSON_STAT(stats.bytes = size - json.size(); stat_end(start));
+	return ret;
+}
+
+LEPTJSON_INLINE std::string LeptJSON::stringify(StringifyFlag flags) {
+	LEPTJSON_STAT(stat_begin(); const auto start = std::chrono::steady_clock::now());
+	std::string s;
+	if ((flags & StringifyFlag::STRINGIFY_PARALLEL) != StringifyFlag::STRINGIFY_DEFAULT) {
+		auto pieces = stringify_pieces();
+		std::size_t size = 0;
+		for (auto&& piece : pieces) size += piece.size();
+		s.reserve(size);
+		for (auto&& piece : pieces) s += piece;
+	}
+	else {
+		stringify_value(s, jsonValue);
+	}
+	LEPTJSON_STAT(stats.bytes = s.size(); stat_growth(statCapacity, s.capacity(), 1); stat_end(start));
+	return std::move(s);
+}
+
+LEPTJSON_INLINE LeptJSON::Status LeptJSON::parse_value() {
+	if (json.empty())return Status::PARSE_EXPECT_VALUE;
+	switch (json[0]) {
+		case 't':
+			return parse_literal("true", ValueType::TRUE_TYPE);
+		case 'f':
+			return parse_literal("false", ValueType::FALSE_TYPE);
+		case 'n':
+			return parse_literal("null", ValueType::NULL_TYPE);
+		case '\0':
+			return Status::PARSE_EXPECT_VALUE;
+		case '"':
+			return parse_string();
+		case '[':
+			return parse_array();
+		case '{':
+			return projection ? parse_object_projected() : parse_object();
+		default:
+			return parse_number();
+	}
+}
+
+LEPTJSON_INLINE LeptJSON::Status LeptJSON::parse_literal(std::string_view literal, ValueType type) {
+	if (json.size() < literal.size()) {
+		jsonValue.type = ValueType::NULL_TYPE;
+		return Status::PARSE_INVALID_VALUE;
+	}
+	for (size_t i = 0; i < literal.size(); ++i) {
+		if (json[i] != literal[i]) {
+			jsonValue.type = ValueType::NULL_TYPE;
+			return Status::PARSE_INVALID_VALUE;
 		}
 	}
+	json.remove_prefix(literal.size());
+	LEPTJSON_STAT(stat_node(type));
+	this->jsonValue.type = type;
+	if (type == ValueType::TRUE_TYPE)jsonValue.value = true;
+	else if (type == ValueType::FALSE_TYPE)jsonValue.value = false;
+	else jsonValue.value = nullptr;
+	return Status::PARSE_OK;
+}
 
-	/* array = %x5B ws [ value *( ws %x2C ws value ) ] ws %x5D */
-	Status parse_array() {
-		if (json.starts_with('[')) {
-			json.remove_prefix(1);
+LEPTJSON_INLINE LeptJSON::Status LeptJSON::parse_number() {
+	LEPTJSON_STAT(StatTimer timer{ stats.number_time });
+	std::string_view judge = json;
+	if (!scan_number(judge)) {
+		jsonValue.type = ValueType::NULL_TYPE;
+		return Status::PARSE_INVALID_VALUE;
+	}
+	if (has_flag(ParseFlag::PARSE_LAZY_NUMBERS)) {
+		jsonValue = { RawNumber(json.substr(0, json.size() - judge.size())), ValueType::NUMBER_TYPE };
+		json = judge;
+		LEPTJSON_STAT(stat_node(ValueType::NUMBER_TYPE));
+		return Status::PARSE_OK;
+	}
+	double d;
+	if (!convert_number(json.substr(0, json.size() - judge.size()), d)) {
+		return Status::PARSE_NUMBER_TOO_BIG;
+	}
+	json = judge;
+	LEPTJSON_STAT(stat_node(ValueType::NUMBER_TYPE));
+	jsonValue = { d, ValueType::NUMBER_TYPE };
+	return Status::PARSE_OK;
+}
+
+LEPTJSON_INLINE LeptJSON::Status LeptJSON::parse_string() {
+	std::string s;
+	auto ret = parse_string_raw(s);
+	if (ret == Status::PARSE_OK) {
+		LEPTJSON_STAT(stat_node(ValueType::STRING_TYPE));
+		jsonValue = { std::move(s), ValueType::STRING_TYPE };
+	}
+	return ret;
+}
+
+LEPTJSON_INLINE LeptJSON::Status LeptJSON::parse_string_raw(std::string& s) {
+	LEPTJSON_STAT(StatTimer timer{ stats.string_time });
+	if (json.starts_with('\"'))
+		json.remove_prefix(1);
+	while (!json.empty()) {
+		std::size_t n{};
+		if (!scan_string_run(n)) {
+			return Status::PARSE_INVALID_UTF8;
 		}
-		parse_whitespace();
-		if (json.starts_with(']')) {
-			json.remove_prefix(1);
-			jsonValue = { json_array_type{}, ValueType::ARRAY_TYPE };
-			return Status::PARSE_OK;
+		LEPTJSON_STAT(const auto capacity = s.capacity());
+		s.append(json.data(), n);
+		LEPTJSON_STAT(stat_growth(capacity, s.capacity(), 1));
+		json.remove_prefix(n);
+		if (json.empty()) {
+			break;
 		}
-		json_array_type v = json_array_type{};
-		while (!json.empty()) {
-			auto ret = parse_value();
-			if (ret != Status::PARSE_OK) {
-				return ret;
-			}
-			v.push_back(jsonValue);
-			parse_whitespace();
-			if (json.starts_with(',')) {
-				json.remove_prefix(1);
-				parse_whitespace();
-			}
-			else if (json.starts_with(']')) {
+		switch (json.front()) {
+			case '\"':
 				json.remove_prefix(1);
-				jsonValue = { std::move(v), ValueType::ARRAY_TYPE };
 				return Status::PARSE_OK;
-			}
-			else {
-				jsonValue.type = ValueType::NULL_TYPE;
-				return Status::PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
-			}
+			case '\\':
+				json.remove_prefix(1);
+				if (json.empty())return Status::PARSE_INVALID_STRING_ESCAPE;
+				switch (json.front()) {
+					default:
+						return Status::PARSE_INVALID_STRING_ESCAPE;
+					case '\"':
+						s += '\"';
+						break;
+					case '\\':
+						s += '\\';
+						break;
+					case '/':
+						s += '/';
+						break;
+					case 'b':
+						s += '\b';
+						break;
+					case 'f':
+						s += '\f';
+						break;
+					case 'n':
+						s += '\n';
+						break;
+					case 'r':
+						s += '\r';
+						break;
+					case 't':
+						s += '\t';
+						break;
+					case 'u':
+					{
+						auto ret = parse_unicode_run(s);
+						if (ret != Status::PARSE_OK) {
+							return ret;
+						}
+						continue;
+					}
+				}
+				json.remove_prefix(1);
+				break;
+			default:
+				return Status::PARSE_INVALID_STRING_CHAR;
 		}
-		jsonValue.type = ValueType::NULL_TYPE;
-		return Status::PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
 	}
+	return Status::PARSE_MISS_QUOTATION_MARK;
+}
 
-	Status parse_object() {
-		if (json.starts_with('{')) {
-			json.remove_prefix(1);
+LEPTJSON_INLINE LeptJSON::Status LeptJSON::parse_array() {
+	LEPTJSON_STAT(StatDepth depth{ *this });
+	if (json.starts_with('[')) {
+		json.remove_prefix(1);
+	}
+	parse_whitespace();
+	if (json.starts_with(']')) {
+		json.remove_prefix(1);
+		LEPTJSON_STAT(stat_node(ValueType::ARRAY_TYPE));
+		jsonValue = { json_array_type{}, ValueType::ARRAY_TYPE };
+		return Status::PARSE_OK;
+	}
+	json_array_type v = json_array_type{};
+	if (!has_flag(ParseFlag::PARSE_LAZY_NUMBERS) && starts_number(json)) {
+		json_numbers_type numbers;
+		bool closed = false;
+		auto ret = parse_numbers(numbers, closed);
+		if (ret != Status::PARSE_OK || closed) {
+			return ret;
+		}
+		/* a value other than a number follows, keep going with generic elements */
+		v = number_elements(numbers);
+	}
+	while (!json.empty()) {
+		auto ret = parse_value();
+		if (ret != Status::PARSE_OK) {
+			return ret;
 		}
+		LEPTJSON_STAT(const auto capacity = v.capacity());
+		v.push_back(std::move(jsonValue));
+		LEPTJSON_STAT(stat_growth(capacity, v.capacity(), sizeof(JsonValue)));
 		parse_whitespace();
-		if (json.starts_with('}')) {
+		if (json.starts_with(',')) {
+			json.remove_prefix(1);
+			parse_whitespace();
+		}
+		else if (json.starts_with(']')) {
 			json.remove_prefix(1);
-			jsonValue = { json_object_type{}, ValueType::OBJECT_TYPE };
+			LEPTJSON_STAT(stat_node(ValueType::ARRAY_TYPE));
+			jsonValue = { std::move(v), ValueType::ARRAY_TYPE };
 			return Status::PARSE_OK;
 		}
-		json_object_type v = json_object_type{};
-		while (true) {
-			if (!json.starts_with('\"')) {
-				jsonValue.type = ValueType::NULL_TYPE;
-				return Status::PARSE_MISS_KEY;
-			}
-			auto ret = parse_string();
-			if (ret != Status::PARSE_OK) {
-				return ret;
+		else {
+			jsonValue.type = ValueType::NULL_TYPE;
+			return Status::PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+		}
+	}
+	jsonValue.type = ValueType::NULL_TYPE;
+	return Status::PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+}
+
+LEPTJSON_INLINE LeptJSON::Status LeptJSON::parse_numbers(json_numbers_type& numbers, bool& closed) {
+	while (true) {
+		std::string_view judge = json;
+		double d;
+		{
+			LEPTJSON_STAT(StatTimer timer{ stats.number_time });
+			if (!scan_number(judge)) {
+				return Status::PARSE_OK;	/* parse_value() reports it */
 			}
-			std::string key = std::get<std::string>(jsonValue.value);
-			parse_whitespace();
-			if (!json.starts_with(':')) {
-				jsonValue.type = ValueType::NULL_TYPE;
-				return Status::PARSE_MISS_COLON;
+			if (!convert_number(json.substr(0, json.size() - judge.size()), d)) {
+				return Status::PARSE_NUMBER_TOO_BIG;
 			}
+		}
+		json = judge;
+		LEPTJSON_STAT(stat_node(ValueType::NUMBER_TYPE); const auto capacity = numbers.capacity());
+		numbers.push_back(d);
+		LEPTJSON_STAT(stat_growth(capacity, numbers.capacity(), sizeof(double)));
+		parse_whitespace();
+		if (json.starts_with(',')) {
 			json.remove_prefix(1);
 			parse_whitespace();
-			ret = parse_value();
-			if (ret != Status::PARSE_OK) {
-				return ret;
-			}
-			v[key] = jsonValue;
+			if (!starts_number(json)) return Status::PARSE_OK;
+		}
+		else if (json.starts_with(']')) {
+			json.remove_prefix(1);
+			LEPTJSON_STAT(stat_node(ValueType::ARRAY_TYPE));
+			jsonValue = { std::move(numbers), ValueType::ARRAY_TYPE };
+			closed = true;
+			return Status::PARSE_OK;
+		}
+		else {
+			jsonValue.type = ValueType::NULL_TYPE;
+			return Status::PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+		}
+	}
+}
+
+LEPTJSON_INLINE LeptJSON::Status LeptJSON::parse_object() {
+	LEPTJSON_STAT(StatDepth depth{ *this });
+	if (json.starts_with('{')) {
+		json.remove_prefix(1);
+	}
+	parse_whitespace();
+	if (json.starts_with('}')) {
+		json.remove_prefix(1);
+		LEPTJSON_STAT(stat_node(ValueType::OBJECT_TYPE));
+		jsonValue = { json_object_type{}, ValueType::OBJECT_TYPE };
+		return Status::PARSE_OK;
+	}
+	json_object_type v = json_object_type{};
+	while (true) {
+		if (!json.starts_with('\"')) {
+			jsonValue.type = ValueType::NULL_TYPE;
+			return Status::PARSE_MISS_KEY;
+		}
+		std::string key;
+		auto ret = parse_string_raw(key);
+		if (ret != Status::PARSE_OK) {
+			return ret;
+		}
+		parse_whitespace();
+		if (!json.starts_with(':')) {
+			jsonValue.type = ValueType::NULL_TYPE;
+			return Status::PARSE_MISS_COLON;
+		}
+		json.remove_prefix(1);
+		parse_whitespace();
+		ret = parse_value();
+		if (ret != Status::PARSE_OK) {
+			return ret;
+		}
+		LEPTJSON_STAT(const auto capacity = v.members.capacity());
+		v.append(std::move(key), std::move(jsonValue));
+		LEPTJSON_STAT(stat_growth(capacity, v.members.capacity(), sizeof(json_object_type::value_type)));
+		parse_whitespace();
+		if (json.starts_with(',')) {
+			json.remove_prefix(1);
 			parse_whitespace();
-			if (json.starts_with(',')) {
-				json.remove_prefix(1);
-				parse_whitespace();
-			}
-			else if (json.starts_with('}')) {
-				json.remove_prefix(1);
-				jsonValue = { std::move(v), ValueType::OBJECT_TYPE };
-				return Status::PARSE_OK;
-			}
-			else {
-				jsonValue.type = ValueType::NULL_TYPE;
-				return Status::PARSE_MISS_COMMA_OR_CURLY_BRACKET;
-			}
+		}
+		else if (json.starts_with('}')) {
+			json.remove_prefix(1);
+			LEPTJSON_STAT(stat_node(ValueType::OBJECT_TYPE));
+			v.sort();
+			jsonValue = { std::move(v), ValueType::OBJECT_TYPE };
+			return Status::PARSE_OK;
+		}
+		else {
+			jsonValue.type = ValueType::NULL_TYPE;
+			return Status::PARSE_MISS_COMMA_OR_CURLY_BRACKET;
 		}
 	}
+}
 
-	void stringify_value(std::string& s, const JsonValue& jv) {
-		bool judge;
-		switch (jv.type) {
-			case ValueType::NULL_TYPE:
-				s += "null";
-				break;
-			case ValueType::FALSE_TYPE:
-				s += "false";
-				break;
-			case ValueType::TRUE_TYPE:
-				s += "true";
-				break;
-			case ValueType::NUMBER_TYPE:
-			{
-				std::array<char, 50> buffer{};
-				auto [p, ec] = std::to_chars(buffer.data(), buffer.data() + buffer.size(), std::get<double>(jv.value),
-					std::chars_format::general, 17);
-				if (ec == std::errc()) {
-					s.append(buffer.data(), p);
-				}
-			}
+LEPTJSON_INLINE void LeptJSON::stringify_value(std::string& s, const JsonValue& jv) {
+	LEPTJSON_STAT(stat_node(jv.type); stat_growth(statCapacity, s.capacity(), 1); statCapacity = s.capacity());
+	bool judge;
+	switch (jv.type) {
+		case ValueType::NULL_TYPE:
+			s += "null";
 			break;
-			case ValueType::STRING_TYPE:
-				stringify_string(s, std::get<std::string>(jv.value));
-				break;
-			case ValueType::ARRAY_TYPE:
-				s += '[';
-				judge = false;
-				for (auto&& value : std::get<json_array_type>(jv.value)) {
+		case ValueType::FALSE_TYPE:
+			s += "false";
+			break;
+		case ValueType::TRUE_TYPE:
+			s += "true";
+			break;
+		case ValueType::NUMBER_TYPE:
+		{
+			LEPTJSON_STAT(StatTimer timer{ stats.number_time });
+			if (const auto* raw = std::get_if<RawNumber>(&jv.value)) s += raw->text();
+			else stringify_number(s, std::get<double>(jv.value));
+		}
+		break;
+		case ValueType::STRING_TYPE:
+		{
+			LEPTJSON_STAT(StatTimer timer{ stats.string_time });
+			const auto& str = std::get<std::string>(jv.value);
+			if (segments && str.size() >= segments->minReference && !needs_escape(str)) {
+				s += '\"';
+				segments->reference(str);
+				s += '\"';
+			}
+			else {
+				stringify_string(s, str);
+			}
+		}
+		break;
+		case ValueType::ARRAY_TYPE:
+		{
+			LEPTJSON_STAT(StatDepth depth{ *this });
+			s += '[';
+			judge = false;
+			if (const auto* numbers = as_numbers(jv)) {
+				LEPTJSON_STAT(StatTimer timer{ stats.number_time }; stats.nodes[static_cast<std::size_t>(ValueType::NUMBER_TYPE)] += numbers->size());
+				for (double d : *numbers) {
 					if (judge)s += ',';
 					else judge = true;
-					stringify_value(s, value);
+					stringify_number(s, d);
 				}
 				s += ']';
 				break;
-			case ValueType::OBJECT_TYPE:
-				s += '{';
-				judge = false;
-				for (auto&& [key, value] : std::get<json_object_type>(jv.value)) {
-					if (judge)s += ',';
-					else judge = true;
+			}
+			for (auto&& value : as_array(jv)) {
+				if (judge)s += ',';
+				else judge = true;
+				stringify_value(s, value);
+			}
+			s += ']';
+		}
+		break;
+		case ValueType::OBJECT_TYPE:
+		{
+			LEPTJSON_STAT(StatDepth depth{ *this });
+			s += '{';
+			judge = false;
+			for (auto&& [key, value] : as_object(jv)) {
+				if (judge)s += ',';
+				else judge = true;
+				{
+					LEPTJSON_STAT(StatTimer timer{ stats.string_time });
 					stringify_string(s, key);
-					s += ':';
-					stringify_value(s, value);
 				}
-				s += '}';
-				break;
-			default:
-				assert(0 && "invalid type");
-		}
-	}
-
-	static void stringify_string(std::string& s, const std::string& value) {
-		static const char* hex_digits = "0123456789ABCDEF";
-		s += '\"';
-		for (auto&& c : value) {
-			switch (c) {
-				case '\"':
-					s += "\\\"";
-					break;
-				case '\\':
-					s += "\\\\";
-					break;
-				case '\b':
-					s += "\\b";
-					break;
-				case '\f':
-					s += "\\f";
-					break;
-				case '\n':
-					s += "\\n";
-					break;
-				case '\r':
-					s += "\\r";
-					break;
-				case '\t':
-					s += "\\t";
-					break;
-				default:
-					if (static_cast<unsigned char>(c) < 0x20) {
-						s += "\\u00";
-						s += hex_digits[static_cast<unsigned char>(c) >> 4];
-						s += hex_digits[static_cast<unsigned char>(c) & 0x0F];
-					}
-					else {
-						s += c;
-					}
+				s += ':';
+				stringify_value(s, value);
 			}
+			s += '}';
 		}
-		s += '\"';
-	}
-
-	friend ValueType get_type(const JsonValue& jv) { return jv.type; }
-
-	friend bool get_boolean(const JsonValue& jv) {
-		assert(jv.type == ValueType::TRUE_TYPE || jv.type == ValueType::FALSE_TYPE);
-		return std::get<bool>(jv.value);
-	}
-
-	friend double get_number(const JsonValue& jv) {
-		assert(jv.type == ValueType::NUMBER_TYPE);
-		return std::get<double>(jv.value);
-	}
-
-	friend std::string_view get_string(const JsonValue& jv) {
-		assert(jv.type == ValueType::STRING_TYPE);
-		return std::string_view{ std::get<std::string>(jv.value).data(), std::get<std::string>(jv.value).size() };
-	}
-
-	friend auto&& get_array(const JsonValue& jv) {
-		assert(jv.type == ValueType::ARRAY_TYPE);
-		return std::get<json_array_type>(jv.value);
+		break;
+		default:
+			assert(0 && "invalid type");
 	}
+}
 
-	friend auto&& get_object(const JsonValue& jv) {
-		assert(jv.type == ValueType::OBJECT_TYPE);
-		return std::get<json_object_type>(jv.value);
+LEPTJSON_INLINE void LeptJSON::stringify_number(std::string& s, double d) {
+	std::array<char, 50> buffer{};
+	auto [p, ec] = std::to_chars(buffer.data(), buffer.data() + buffer.size(), d, std::chars_format::general, 17);
+	if (ec == std::errc()) {
+		s.append(buffer.data(), p);
 	}
+}
 
-	friend bool operator==(const JsonValue& lhs, const JsonValue& rhs) {
-		return lhs.type == rhs.type && lhs.value == rhs.value;
+LEPTJSON_INLINE void LeptJSON::stringify_string(std::string& s, std::string_view value) {
+	static const char* hex_digits = "0123456789ABCDEF";
+	s += '\"';
+	for (auto&& c : value) {
+		switch (c) {
+			case '\"':
+				s += "\\\"";
+				break;
+			case '\\':
+				s += "\\\\";
+				break;
+			case '\b':
+				s += "\\b";
+				break;
+			case '\f':
+				s += "\\f";
+				break;
+			case '\n':
+				s += "\\n";
+				break;
+			case '\r':
+				s += "\\r";
+				break;
+			case '\t':
+				s += "\\t";
+				break;
+			default:
+				if (static_cast<unsigned char>(c) < 0x20) {
+					s += "\\u00";
+					s += hex_digits[static_cast<unsigned char>(c) >> 4];
+					s += hex_digits[static_cast<unsigned char>(c) & 0x0F];
+				}
+				else {
+					s += c;
+				}
+		}
 	}
-};
+	s += '\"';
+}
 
-bool operator==(const LeptJSON& lhs, const LeptJSON& rhs) {
-	if (lhs.get_type() != rhs.get_type())return false;
-	switch (lhs.get_type()) {
-		case LeptJSON::ValueType::NULL_TYPE:
-		case LeptJSON::ValueType::FALSE_TYPE:
-		case LeptJSON::ValueType::TRUE_TYPE:
-			return true;
-		case LeptJSON::ValueType::NUMBER_TYPE:
-			return lhs.get_number() == rhs.get_number();
-		case LeptJSON::ValueType::STRING_TYPE:
-			return lhs.get_string() == rhs.get_string();
-		case LeptJSON::ValueType::ARRAY_TYPE:
-			return lhs.get_array() == rhs.get_array();
-		case LeptJSON::ValueType::OBJECT_TYPE:
-			return lhs.get_object() == rhs.get_object();
-		default:
-			assert(0 && "invalid type");
-	}
+LEPTJSON_INLINE bool operator==(const LeptJSON& lhs, const LeptJSON& rhs) {
+	return lhs.jsonValue == rhs.jsonValue;
 }
 
-bool is_equal(const LeptJSON& lhs, const LeptJSON& rhs) {
+LEPTJSON_INLINE bool is_equal(const LeptJSON& lhs, const LeptJSON& rhs) {
 	return lhs == rhs;
 }
 
-void copy(LeptJSON& lhs, const LeptJSON& rhs) {
+LEPTJSON_INLINE void copy(LeptJSON& lhs, const LeptJSON& rhs) {
 	lhs = rhs;
 }
 
-void move(LeptJSON& lhs, LeptJSON&& rhs) {
+LEPTJSON_INLINE void move(LeptJSON& lhs, LeptJSON&& rhs) {
 	lhs = std::move(rhs);
 }
 
-void swap(LeptJSON& lhs, LeptJSON& rhs) {
+LEPTJSON_INLINE void swap(LeptJSON& lhs, LeptJSON& rhs) {
 	lhs.swap(rhs);
 }
 
+#endif
+
 #endif/* _LEPTJSON_H_ */
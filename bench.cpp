@@ -0,0 +1,471 @@
+﻿#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <string>
+#include <vector>
+#include <fstream>
+
+#include "LeptJSON.hpp"
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+/*
+ * Throughput benchmark over a generated, reproducible corpus.
+ * Each corpus prints one JSON object per line so results can be diffed or tracked over time.
+ */
+
+using Status = LeptJSON::Status;
+using ParseFlag = LeptJSON::ParseFlag;
+using StringifyFlag = LeptJSON::StringifyFlag;
+
+static ParseFlag parse_flags = ParseFlag::PARSE_DEFAULT;
+static StringifyFlag stringify_flags = StringifyFlag::STRINGIFY_DEFAULT;
+static LeptJSON::Projection projection;
+static bool projected = false;
+static LeptJSON::JsonPath query_path;
+static const char* query_expression = nullptr;
+
+static std::atomic<bool> count_allocations{ false };
+static std::atomic<std::size_t> allocation_count{ 0 };
+static std::atomic<std::size_t> allocation_bytes{ 0 };
+
+void* operator new(std::size_t size) {
+    if (count_allocations.load(std::memory_order_relaxed)) {
+        allocation_count.fetch_add(1, std::memory_order_relaxed);
+        allocation_bytes.fetch_add(size, std::memory_order_relaxed);
+    }
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+namespace details {
+/* splitmix64, so the corpus is identical on every platform and standard library */
+struct Random {
+    std::uint64_t state;
+
+    std::uint64_t next() {
+        std::uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    std::uint64_t below(std::uint64_t n) { return next() % n; }
+
+    double unit() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+};
+
+void append_number(std::string& s, double d, int precision) {
+    char buffer[64];
+    auto [p, ec] = std::to_chars(buffer, buffer + sizeof(buffer), d, std::chars_format::general, precision);
+    s.append(buffer, p);
+}
+
+void append_word(std::string& s, Random& r) {
+    static const char* words[] = {
+        "json", "parser", "stream", "latency", "caf\xC3\xA9", "na\xC3\xAFve", "\xE6\x97\xA5\xE6\x9C\xAC",
+        "\xF0\x9F\x98\x80", "hello", "world", "tab\\t", "quote\\\"", "line\\n", "\\u00e9t\\u00e9", "https:\\/\\/t.co"
+    };
+    s += words[r.below(sizeof(words) / sizeof(words[0]))];
+}
+
+/* canada.json-like: one FeatureCollection of polygons made of long coordinate lists */
+std::string make_canada(double scale) {
+    Random r{ 1 };
+    std::string s = "{\"type\":\"FeatureCollection\",\"features\":[";
+    const int features = static_cast<int>(8 * scale) + 1;
+    for (int f = 0; f < features; f++) {
+        if (f) s += ',';
+        s += "{\"type\":\"Feature\",\"properties\":{\"name\":\"Canada\"},\"geometry\":{\"type\":\"Polygon\",\"coordinates\":[";
+        for (int ring = 0; ring < 60; ring++) {
+            if (ring) s += ',';
+            s += '[';
+            for (int point = 0; point < 200; point++) {
+                if (point) s += ',';
+                s += '[';
+                append_number(s, -141.0 + 88.0 * r.unit(), 17);
+                s += ',';
+                append_number(s, 41.0 + 42.0 * r.unit(), 17);
+                s += ']';
+            }
+            s += ']';
+        }
+        s += "]}}";
+    }
+    s += "]}";
+    return s;
+}
+
+/* twitter.json-like: statuses with nested users, escaped and non-ASCII text */
+std::string make_twitter(double scale) {
+    Random r{ 2 };
+    std::string s = "{\"statuses\":[";
+    const int statuses = static_cast<int>(4000 * scale) + 1;
+    for (int i = 0; i < statuses; i++) {
+        if (i) s += ',';
+        s += "{\"id\":";
+        append_number(s, static_cast<double>(505874924095815681ull + r.below(1000000)), 17);
+        s += ",\"text\":\"";
+        for (int w = 4 + static_cast<int>(r.below(20)); w > 0; w--) {
+            append_word(s, r);
+            s += ' ';
+        }
+        s += "\",\"user\":{\"id\":";
+        append_number(s, static_cast<double>(r.below(4000000000ull)), 17);
+        s += ",\"name\":\"";
+        append_word(s, r);
+        s += "\",\"screen_name\":\"user_";
+        s += std::to_string(r.below(100000));
+        s += "\",\"followers_count\":";
+        s += std::to_string(r.below(100000));
+        s += ",\"verified\":";
+        s += r.below(2) ? "true" : "false";
+        s += ",\"profile_image_url\":\"http:\\/\\/pbs.twimg.com\\/profile_images\\/";
+        s += std::to_string(r.below(1000000000));
+        s += "\\/normal.png\"},\"entities\":{\"hashtags\":[";
+        for (int h = static_cast<int>(r.below(3)); h > 0; h--) {
+            s += "{\"text\":\"";
+            append_word(s, r);
+            s += "\",\"indices\":[";
+            s += std::to_string(r.below(100));
+            s += ',';
+            s += std::to_string(r.below(140));
+            s += "]}";
+            if (h > 1) s += ',';
+        }
+        s += "]},\"geo\":null,\"retweet_count\":";
+        s += std::to_string(r.below(1000));
+        s += ",\"favorited\":false,\"lang\":\"ja\"}";
+    }
+    s += "]}";
+    return s;
+}
+
+/* strings written entirely as \uXXXX escapes, surrogate pairs included */
+std::string make_escapes(double scale) {
+    Random r{ 3 };
+    std::string s = "[";
+    const int strings = static_cast<int>(20000 * scale) + 1;
+    for (int i = 0; i < strings; i++) {
+        if (i) s += ',';
+        s += '\"';
+        for (int j = 0; j < 40; j++) {
+            char buffer[16];
+            switch (r.below(3)) {
+                case 0:
+                    std::snprintf(buffer, sizeof(buffer), "\\u%04X", static_cast<unsigned>(0x4E00 + r.below(0x5000)));
+                    break;
+                case 1:
+                    std::snprintf(buffer, sizeof(buffer), "\\u%04x", static_cast<unsigned>(0xA0 + r.below(0x60)));
+                    break;
+                default:
+                    std::snprintf(buffer, sizeof(buffer), "\\uD83D\\uDE%02X", static_cast<unsigned>(r.below(0x50)));
+            }
+            s += buffer;
+        }
+        s += '\"';
+    }
+    s += ']';
+    return s;
+}
+
+/* many documents nested hundreds of levels deep */
+std::string make_nested(double scale) {
+    Random r{ 4 };
+    std::string s = "[";
+    const int trees = static_cast<int>(400 * scale) + 1;
+    for (int t = 0; t < trees; t++) {
+        if (t) s += ',';
+        const int depth = 100 + static_cast<int>(r.below(400));
+        for (int d = 0; d < depth; d++) {
+            s += (d & 1) ? "[" : "{\"k\":";
+        }
+        s += std::to_string(r.below(1000));
+        for (int d = depth - 1; d >= 0; d--) {
+            s += (d & 1) ? "]" : "}";
+        }
+    }
+    s += ']';
+    return s;
+}
+
+/* newline-delimited small records, parsed one line at a time */
+std::string make_ndjson(double scale) {
+    Random r{ 5 };
+    std::string s;
+    const int lines = static_cast<int>(60000 * scale) + 1;
+    for (int i = 0; i < lines; i++) {
+        s += "{\"ts\":";
+        s += std::to_string(1700000000 + i);
+        s += ",\"level\":\"";
+        s += r.below(4) ? "info" : "warn";
+        s += "\",\"latency\":";
+        append_number(s, r.unit() * 100.0, 6);
+        s += ",\"tags\":[\"";
+        append_word(s, r);
+        s += "\"],\"ok\":";
+        s += r.below(10) ? "true" : "false";
+        s += "}\n";
+    }
+    return s;
+}
+
+struct Corpus {
+    const char* name;
+    std::string (*make)(double);
+    bool ndjson;
+};
+
+const Corpus corpora[] = {
+    { "canada", make_canada, false },
+    { "twitter", make_twitter, false },
+    { "escapes", make_escapes, false },
+    { "nested", make_nested, false },
+    { "ndjson", make_ndjson, true },
+};
+
+std::vector<std::string_view> split_documents(const std::string& text, bool ndjson) {
+    std::vector<std::string_view> docs;
+    if (!ndjson) {
+        docs.emplace_back(text);
+        return docs;
+    }
+    std::string_view rest = text;
+    while (!rest.empty()) {
+        auto n = rest.find('\n');
+        if (n == std::string_view::npos) n = rest.size();
+        if (n) docs.emplace_back(rest.substr(0, n));
+        rest.remove_prefix(n == rest.size() ? n : n + 1);
+    }
+    return docs;
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+long peak_rss_kb() {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters{};
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return static_cast<long>(counters.PeakWorkingSetSize / 1024);
+#else
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+#endif
+}
+}
+
+/* encode/decode rates are in megabytes of JSON text per second so they line up with parse_mbps */
+struct BinaryResult {
+    std::size_t bytes = 0;
+    double encode_mbps = 0;
+    double decode_mbps = 0;
+};
+
+static bool run_binary(const char* corpus, const char* format, const std::vector<LeptJSON>& values,
+    std::size_t text_bytes, int iterations, std::string(LeptJSON::* encode)() const,
+    Status(LeptJSON::* decode)(std::string_view), BinaryResult& result) {
+    std::vector<std::string> encoded(values.size());
+    LeptJSON decoded;
+    double encode_best = 1e30, decode_best = 1e30;
+    for (int i = 0; i < iterations; i++) {
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t d = 0; d < values.size(); d++) {
+            encoded[d] = (values[d].*encode)();
+        }
+        encode_best = std::min(encode_best, details::seconds_since(start));
+
+        start = std::chrono::steady_clock::now();
+        for (std::size_t d = 0; d < values.size(); d++) {
+            if ((decoded.*decode)(encoded[d]) != Status::PARSE_OK || (i == 0 && !is_equal(decoded, values[d]))) {
+                std::fprintf(stderr, "%s: document %zu does not round-trip through %s\n", corpus, d, format);
+                return false;
+            }
+        }
+        decode_best = std::min(decode_best, details::seconds_since(start));
+    }
+    result.bytes = 0;
+    for (auto&& bytes : encoded) result.bytes += bytes.size();
+    result.encode_mbps = text_bytes / encode_best / 1e6;
+    result.decode_mbps = text_bytes / decode_best / 1e6;
+    return true;
+}
+
+/* the same compiled query over the parsed trees and over the raw text, both in megabytes of text per second */
+static bool run_query(const char* corpus, const std::vector<std::string_view>& docs, const std::vector<LeptJSON>& values,
+    std::size_t text_bytes, int iterations) {
+    std::size_t dom_matches = 0, text_matches = 0;
+    std::vector<std::string_view> matches;
+    double dom_best = 1e30, text_best = 1e30;
+    for (int i = 0; i < iterations; i++) {
+        dom_matches = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (auto&& v : values) {
+            dom_matches += v.query(query_path).size();
+        }
+        dom_best = std::min(dom_best, details::seconds_since(start));
+
+        text_matches = 0;
+        start = std::chrono::steady_clock::now();
+        for (auto&& doc : docs) {
+            if (LeptJSON::query(doc, query_path, matches, parse_flags) != Status::PARSE_OK) {
+                std::fprintf(stderr, "%s: query over the text failed\n", corpus);
+                return false;
+            }
+            text_matches += matches.size();
+        }
+        text_best = std::min(text_best, details::seconds_since(start));
+    }
+    std::printf("{\"corpus\":\"%s\",\"query\":\"%s\",\"dom_matches\":%zu,\"text_matches\":%zu,"
+        "\"query_dom_mbps\":%.2f,\"query_text_mbps\":%.2f}\n",
+        corpus, query_expression, dom_matches, text_matches, text_bytes / dom_best / 1e6, text_bytes / text_best / 1e6);
+    return true;
+}
+
+static bool run_corpus(const details::Corpus& corpus, double scale, int iterations, const char* dump_dir) {
+    const std::string text = corpus.make(scale);
+    if (dump_dir) {
+        std::ofstream(std::string(dump_dir) + "/" + corpus.name + (corpus.ndjson ? ".ndjson" : ".json"),
+            std::ios::binary) << text;
+    }
+    const auto docs = details::split_documents(text, corpus.ndjson);
+    std::vector<LeptJSON> values;
+    values.reserve(docs.size());
+
+    double parse_best = 1e30, stringify_best = 1e30;
+    std::size_t allocations = 0, allocated = 0, output_bytes = 0;
+    for (int i = 0; i < iterations; i++) {
+        /* the previous iteration's trees are freed here, outside the timed and counted region */
+        values.clear();
+        allocation_count = 0;
+        allocation_bytes = 0;
+        count_allocations = true;
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t d = 0; d < docs.size(); d++) {
+            auto& value = values.emplace_back(docs[d]);
+            const auto ret = projected ? value.parse(projection, parse_flags) : value.parse(parse_flags);
+            if (ret != Status::PARSE_OK) {
+                count_allocations = false;
+                std::fprintf(stderr, "%s: document %zu does not parse\n", corpus.name, d);
+                return false;
+            }
+        }
+        parse_best = std::min(parse_best, details::seconds_since(start));
+        count_allocations = false;
+        allocations = allocation_count;
+        allocated = allocation_bytes;
+
+        output_bytes = 0;
+        start = std::chrono::steady_clock::now();
+        for (auto& v : values) {
+            output_bytes += v.stringify(stringify_flags).size();
+        }
+        stringify_best = std::min(stringify_best, details::seconds_since(start));
+    }
+
+    BinaryResult msgpack, cbor;
+    if (!run_binary(corpus.name, "msgpack", values, text.size(), iterations,
+            &LeptJSON::to_msgpack, &LeptJSON::from_msgpack, msgpack) ||
+        !run_binary(corpus.name, "cbor", values, text.size(), iterations,
+            &LeptJSON::to_cbor, &LeptJSON::from_cbor, cbor)) {
+        return false;
+    }
+
+    std::printf("{\"corpus\":\"%s\",\"bytes\":%zu,\"documents\":%zu,\"iterations\":%d,"
+        "\"parse_mbps\":%.2f,\"stringify_mbps\":%.2f,\"stringify_bytes\":%zu,"
+        "\"allocations_per_document\":%.1f,\"allocated_bytes_per_document\":%.1f,\"peak_rss_kb\":%ld,"
+        "\"msgpack_bytes\":%zu,\"msgpack_encode_mbps\":%.2f,\"msgpack_decode_mbps\":%.2f,"
+        "\"cbor_bytes\":%zu,\"cbor_encode_mbps\":%.2f,\"cbor_decode_mbps\":%.2f}\n",
+        corpus.name, text.size(), docs.size(), iterations,
+        text.size() / parse_best / 1e6, output_bytes / stringify_best / 1e6, output_bytes,
+        static_cast<double>(allocations) / docs.size(), static_cast<double>(allocated) / docs.size(),
+        details::peak_rss_kb(),
+        msgpack.bytes, msgpack.encode_mbps, msgpack.decode_mbps, cbor.bytes, cbor.encode_mbps, cbor.decode_mbps);
+    const bool ret = !query_expression || run_query(corpus.name, docs, values, text.size(), iterations);
+    std::fflush(stdout);
+    return ret;
+}
+
+static void usage() {
+    std::fprintf(stderr,
+        "usage: leptjson_bench [--corpus NAME]... [--iterations N] [--scale X] [--dump DIR] [--parallel] [--lazy] [--project POINTER]... [--query JSONPATH]\n"
+        "corpora: canada twitter escapes nested ndjson\n");
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string_view> selected;
+    int iterations = 5;
+    double scale = 1.0;
+    const char* dump_dir = nullptr;
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if (i + 1 < argc && arg == "--corpus") {
+            selected.emplace_back(argv[++i]);
+        }
+        else if (i + 1 < argc && arg == "--iterations") {
+            iterations = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (i + 1 < argc && arg == "--scale") {
+            scale = std::atof(argv[++i]);
+        }
+        else if (i + 1 < argc && arg == "--dump") {
+            dump_dir = argv[++i];
+        }
+        else if (i + 1 < argc && arg == "--project" && projection.add(argv[i + 1])) {
+            projected = true;
+            i++;
+        }
+        else if (i + 1 < argc && arg == "--query" && LeptJSON::JsonPath::compile(argv[i + 1], query_path) == Status::PARSE_OK) {
+            query_expression = argv[++i];
+        }
+        else if (arg == "--lazy") {
+            parse_flags = parse_flags | ParseFlag::PARSE_LAZY_NUMBERS;
+        }
+        else if (arg == "--parallel") {
+            parse_flags = parse_flags | ParseFlag::PARSE_PARALLEL;
+            stringify_flags = stringify_flags | StringifyFlag::STRINGIFY_PARALLEL;
+        }
+        else {
+            usage();
+            return 2;
+        }
+    }
+
+    int ret = 0;
+    for (auto&& corpus : details::corpora) {
+        bool wanted = selected.empty();
+        for (auto&& name : selected) {
+            wanted = wanted || name == corpus.name;
+        }
+        if (wanted && !run_corpus(corpus, scale, iterations, dump_dir)) {
+            ret = 1;
+        }
+    }
+    return ret;
+}
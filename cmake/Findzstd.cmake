@@ -0,0 +1,30 @@
+# 查找 zstd，提供导入目标 zstd::libzstd。优先使用 zstd 自带的 CMake 包，
+# 没有时按头文件和库文件查找。随 leptjson 包一起安装，供使用者重新查找 zstd。
+include(FindPackageHandleStandardArgs)
+
+find_package(zstd CONFIG QUIET)
+if (zstd_FOUND AND NOT TARGET zstd::libzstd)
+  # zstd 1.5.6 之前的包只有 libzstd_shared 和 libzstd_static
+  if (TARGET zstd::libzstd_shared)
+    add_library(zstd::libzstd INTERFACE IMPORTED)
+    set_target_properties(zstd::libzstd PROPERTIES INTERFACE_LINK_LIBRARIES zstd::libzstd_shared)
+  elseif (TARGET zstd::libzstd_static)
+    add_library(zstd::libzstd INTERFACE IMPORTED)
+    set_target_properties(zstd::libzstd PROPERTIES INTERFACE_LINK_LIBRARIES zstd::libzstd_static)
+  endif()
+endif()
+if (TARGET zstd::libzstd)
+  set(zstd_FOUND TRUE)
+  return()
+endif()
+
+find_path(zstd_INCLUDE_DIR zstd.h)
+find_library(zstd_LIBRARY NAMES zstd zstd_static)
+mark_as_advanced(zstd_INCLUDE_DIR zstd_LIBRARY)
+find_package_handle_standard_args(zstd REQUIRED_VARS zstd_LIBRARY zstd_INCLUDE_DIR)
+if (zstd_FOUND)
+  add_library(zstd::libzstd UNKNOWN IMPORTED)
+  set_target_properties(zstd::libzstd PROPERTIES
+    IMPORTED_LOCATION "${zstd_LIBRARY}"
+    INTERFACE_INCLUDE_DIRECTORIES "${zstd_INCLUDE_DIR}")
+endif()
@@ -1,7 +1,18 @@
 ﻿#include <cstdio>
 
 #include "LeptJSON.hpp"
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <map>
+#include <optional>
 #include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#ifndef _WIN32
+#include <sys/uio.h>
+#endif
 
 static int main_ret = 0;
 static int test_count = 0;
@@ -9,6 +20,7 @@ static int test_pass = 0;
 
 using Status = LeptJSON::Status;
 using ValueType = LeptJSON::ValueType;
+using ParseFlag = LeptJSON::ParseFlag;
 
 #define EXPECT_EQ_BASE(equality, expect, actual, format) \
     do {\
@@ -42,13 +54,21 @@ void test_error(Status error, const char* json) {
     EXPECT_EQ_INT(ValueType::NULL_TYPE, v.get_type());
 }
 
-void test_string(std::string_view expect_string, const char* json) {
+void test_string(std::string_view expect_string, const char* json, ParseFlag flags = ParseFlag::PARSE_DEFAULT) {
     LeptJSON v(json);
-    EXPECT_EQ_INT(Status::PARSE_OK, v.parse());
+    EXPECT_EQ_INT(Status::PARSE_OK, v.parse(flags));
     EXPECT_EQ_INT(ValueType::STRING_TYPE, v.get_type());
     EXPECT_EQ_STRING(expect_string, v.get_string());
 }
 
+void test_strict_error(Status error, const char* json) {
+    LeptJSON v(json, ValueType::FALSE_TYPE);
+    EXPECT_EQ_INT(Status::PARSE_OK, v.parse());
+    v.set_json(json);
+    EXPECT_EQ_INT(error, v.parse(ParseFlag::PARSE_STRICT_UTF8));
+    EXPECT_EQ_INT(ValueType::NULL_TYPE, v.get_type());
+}
+
 void test_round_trip(const char* json) {
     LeptJSON v1(json);
     EXPECT_EQ_INT(Status::PARSE_OK, v1.parse());
@@ -68,6 +88,145 @@ void test_equal(const char* lhs, const char* rhs, bool result) {
     EXPECT_EQ_INT(Status::PARSE_OK, v2.parse());
     EXPECT_EQ_INT(result, is_equal(v1, v2));
 }
+
+struct Point {
+    double x;
+    double y;
+};
+LEPTJSON_DESCRIBE(Point, x, y)
+
+struct Shape {
+    std::string name;
+    int sides;
+    bool filled;
+    std::vector<Point> points;
+    std::optional<std::string> label;
+    std::map<std::string, std::int64_t> tags;
+    std::optional<Point> center;
+    LeptJSON extra;
+};
+LEPTJSON_DESCRIBE(Shape, name, sides, filled, points, label, tags, center, extra)
+
+void test_bind_error(Status error, const char* json) {
+    LeptJSON v(json);
+    Shape shape;
+    EXPECT_EQ_INT(error, v.parse_into(shape));
+}
+
+LeptJSON parsed(std::string_view json) {
+    LeptJSON v(json);
+    EXPECT_EQ_INT(Status::PARSE_OK, v.parse());
+    return v;
+}
+
+void test_patch(const char* expect, const char* doc, const char* patch) {
+    LeptJSON v = parsed(doc);
+    EXPECT_EQ_INT(Status::PARSE_OK, v.apply_patch(parsed(patch)));
+    EXPECT_TRUE(is_equal(parsed(expect), v));
+}
+
+void test_patch_error(Status error, const char* doc, const char* patch) {
+    LeptJSON v = parsed(doc);
+    EXPECT_EQ_INT(error, v.apply_patch(parsed(patch)));
+    EXPECT_TRUE(is_equal(parsed(doc), v));
+}
+
+void test_merge_patch(const char* expect, const char* doc, const char* patch) {
+    LeptJSON v = parsed(doc);
+    v.apply_merge_patch(parsed(patch));
+    EXPECT_TRUE(is_equal(parsed(expect), v));
+}
+
+void test_query(const char* expect, const char* json, const char* expression) {
+    LeptJSON::JsonPath path;
+    EXPECT_EQ_INT(Status::PARSE_OK, LeptJSON::JsonPath::compile(expression, path));
+    const LeptJSON doc = parsed(json);
+    LeptJSON dom = parsed("[]"), text = parsed("[]");
+    for (auto* value : doc.query(path)) dom.push_back(*value);
+    std::vector<std::string_view> matches;
+    EXPECT_EQ_INT(Status::PARSE_OK, LeptJSON::query(json, path, matches));
+    for (auto match : matches) text.push_back(parsed(match).get_value());
+    EXPECT_TRUE(is_equal(parsed(expect), dom));
+    EXPECT_TRUE(is_equal(parsed(expect), text));
+}
+
+void test_query_error(const char* expression) {
+    LeptJSON::JsonPath path;
+    EXPECT_EQ_INT(Status::PATH_INVALID_EXPRESSION, LeptJSON::JsonPath::compile(expression, path));
+}
+
+void test_schema(Status expect, const char* error_path, const char* schema, const char* json) {
+    LeptJSON::Schema compiled;
+    EXPECT_EQ_INT(Status::PARSE_OK, LeptJSON::Schema::compile(parsed(schema), compiled));
+    LeptJSON v(json);
+    EXPECT_EQ_INT(expect, v.parse(compiled));
+    EXPECT_EQ_STRING(std::string(error_path), v.get_schema_error_path());
+    if (expect == Status::PARSE_OK) {
+        EXPECT_TRUE(is_equal(parsed(json), v));
+    }
+    else {
+        EXPECT_EQ_INT(ValueType::NULL_TYPE, v.get_type());
+    }
+}
+
+void test_diff(const char* from, const char* to) {
+    LeptJSON v = parsed(from);
+    const LeptJSON target = parsed(to);
+    const auto patch = v.diff(target);
+    EXPECT_EQ_INT(Status::PARSE_OK, v.apply_patch(patch));
+    EXPECT_TRUE(is_equal(target, v));
+}
+
+std::string to_hex(std::string_view bytes) {
+    static const char* digits = "0123456789abcdef";
+    std::string hex;
+    for (unsigned char c : bytes) {
+        hex += digits[c >> 4];
+        hex += digits[c & 0x0f];
+    }
+    return hex;
+}
+
+std::string from_hex(std::string_view hex) {
+    std::string bytes;
+    for (std::size_t i = 0; i + 1 < hex.size(); i += 2) {
+        bytes += static_cast<char>(std::stoi(std::string(hex.substr(i, 2)), nullptr, 16));
+    }
+    return bytes;
+}
+
+void test_binary(const char* json, const char* msgpack, const char* cbor) {
+    LeptJSON v(json);
+    EXPECT_EQ_INT(Status::PARSE_OK, v.parse());
+    EXPECT_EQ_STRING(msgpack, to_hex(v.to_msgpack()));
+    EXPECT_EQ_STRING(cbor, to_hex(v.to_cbor()));
+    LeptJSON v2;
+    EXPECT_EQ_INT(Status::PARSE_OK, v2.from_msgpack(from_hex(msgpack)));
+    EXPECT_TRUE(is_equal(v, v2));
+    EXPECT_EQ_INT(Status::PARSE_OK, v2.from_cbor(from_hex(cbor)));
+    EXPECT_TRUE(is_equal(v, v2));
+}
+
+void test_cbor(const char* json, const char* cbor) {
+    LeptJSON expect(json);
+    EXPECT_EQ_INT(Status::PARSE_OK, expect.parse());
+    LeptJSON v;
+    EXPECT_EQ_INT(Status::PARSE_OK, v.from_cbor(from_hex(cbor)));
+    EXPECT_TRUE(is_equal(expect, v));
+}
+
+/* msgpack may be nullptr for CBOR-only framing errors */
+void test_binary_error(Status error, const char* msgpack, const char* cbor) {
+    LeptJSON v;
+    if (msgpack) {
+        v.set_boolean(true);
+        EXPECT_EQ_INT(error, v.from_msgpack(from_hex(msgpack)));
+        EXPECT_EQ_INT(ValueType::NULL_TYPE, v.get_type());
+    }
+    v.set_boolean(true);
+    EXPECT_EQ_INT(error, v.from_cbor(from_hex(cbor)));
+    EXPECT_EQ_INT(ValueType::NULL_TYPE, v.get_type());
+}
 }
 
 static void test_parse_null() {
@@ -131,6 +290,16 @@ void test_parse_string() {
     details::test_string("\xE2\x82\xAC", "\"\\u20AC\""); /* Euro sign U+20AC */
     details::test_string("\xF0\x9D\x84\x9E", "\"\\uD834\\uDD1E\"");  /* G clef sign U+1D11E */
     details::test_string("\xF0\x9D\x84\x9E", "\"\\ud834\\udd1e\"");  /* G clef sign U+1D11E */
+    details::test_string("A\xE2\x82\xAC\n\xF0\x9D\x84\x9E$", "\"A\\u20ac\\n\\uD834\\uDD1E\\u0024\"");
+
+    /* escape runs longer than the decode buffer */
+    std::string expect, json = "\"";
+    for (int i = 0; i < 40; i++) {
+        expect += "\xE2\x82\xAC\xF0\x9D\x84\x9E";
+        json += "\\u20AC\\uD834\\uDD1E";
+    }
+    json += '\"';
+    details::test_string(expect, json.c_str());
 }
 
 static void test_parse_array() {
@@ -289,6 +458,24 @@ static void test_parse_invalid_unicode_surrogate() {
     details::test_error(Status::PARSE_INVALID_UNICODE_SURROGATE, "\"\\uD800\\uE000\"");
 }
 
+static void test_parse_invalid_utf8() {
+    details::test_string("\xC2\xA2\xE2\x82\xAC\xF0\x9D\x84\x9E", "\"\xC2\xA2\xE2\x82\xAC\xF0\x9D\x84\x9E\"", ParseFlag::PARSE_STRICT_UTF8);
+    details::test_string("0123456789abcdef\xEF\xBF\xBD" "0123456789", "\"0123456789abcdef\xEF\xBF\xBD" "0123456789\"", ParseFlag::PARSE_STRICT_UTF8);
+    details::test_string("\xF4\x8F\xBF\xBF", "\"\xF4\x8F\xBF\xBF\"", ParseFlag::PARSE_STRICT_UTF8);  /* U+10FFFF */
+
+    details::test_strict_error(Status::PARSE_INVALID_UTF8, "\"\x80\"");                 /* lone continuation */
+    details::test_strict_error(Status::PARSE_INVALID_UTF8, "\"\xFF\"");
+    details::test_strict_error(Status::PARSE_INVALID_UTF8, "\"\xC0\xAF\"");             /* overlong '/' */
+    details::test_strict_error(Status::PARSE_INVALID_UTF8, "\"\xE0\x80\xAF\"");
+    details::test_strict_error(Status::PARSE_INVALID_UTF8, "\"\xF0\x80\x80\xAF\"");
+    details::test_strict_error(Status::PARSE_INVALID_UTF8, "\"\xED\xA0\x80\"");         /* encoded surrogate U+D800 */
+    details::test_strict_error(Status::PARSE_INVALID_UTF8, "\"\xF4\x90\x80\x80\"");     /* U+110000 */
+    details::test_strict_error(Status::PARSE_INVALID_UTF8, "\"\xE2\x82\"");             /* truncated before quote */
+    details::test_strict_error(Status::PARSE_INVALID_UTF8, "\"\xE2\x82\\n\"");          /* truncated before escape */
+    details::test_strict_error(Status::PARSE_INVALID_UTF8, "\"0123456789abcdef\xC2\"");
+    details::test_strict_error(Status::PARSE_INVALID_UNICODE_SURROGATE, "\"\\uDC00\"");  /* lone low surrogate */
+}
+
 static void test_parse_miss_comma_or_square_bracket() {
     details::test_error(Status::PARSE_MISS_COMMA_OR_SQUARE_BRACKET, "[1");
     details::test_error(Status::PARSE_MISS_COMMA_OR_SQUARE_BRACKET, "[1}");
@@ -319,6 +506,45 @@ static void test_parse_miss_comma_or_curly_bracket() {
     details::test_error(Status::PARSE_MISS_COMMA_OR_CURLY_BRACKET, "{\"a\":{}");
 }
 
+static void test_parse_parallel() {
+    std::string json = "[";
+    for (int i = 0; i < 2000; i++) {
+        if (i) json += " , ";
+        switch (i % 5) {
+            case 0: json += std::to_string(i); break;
+            case 1: json += "\"a,b]\\\"}" + std::to_string(i) + "\""; break;
+            case 2: json += "{\"k\":[" + std::to_string(i) + ",{\"x\":\"[\"}],\"t\":true}"; break;
+            case 3: json += "[null,[false,[]],{}]"; break;
+            default: json += "\"\\u20AC\""; break;
+        }
+    }
+    json += "]\n";
+    LeptJSON sequential(json);
+    EXPECT_EQ_INT(Status::PARSE_OK, sequential.parse());
+    LeptJSON parallel(json);
+    parallel.set_parallel_threshold(0);
+    EXPECT_EQ_INT(Status::PARSE_OK, parallel.parse(ParseFlag::PARSE_PARALLEL));
+    EXPECT_EQ_SIZE_T(std::size_t{ 2000 }, parallel.get_array().size());
+    EXPECT_TRUE(is_equal(sequential, parallel));
+    EXPECT_EQ_STRING(sequential.stringify(), parallel.stringify());
+
+    /* below the threshold or not an array: sequential */
+    LeptJSON small("[1,2,3]");
+    EXPECT_EQ_INT(Status::PARSE_OK, small.parse(ParseFlag::PARSE_PARALLEL));
+    EXPECT_EQ_SIZE_T(std::size_t{ 3 }, small.get_array().size());
+
+    /* errors fall back to the sequential parser and its status */
+    const char* errors[] = { "[1,2,{\"a\":}]", "[1,2,3", "[1,2,3} ", "[1,,2]", "[1,2] x", "[\"\xC0\xAF\",1]" };
+    for (auto&& error : errors) {
+        LeptJSON expect(error);
+        LeptJSON actual(error, ValueType::TRUE_TYPE);
+        actual.set_parallel_threshold(0);
+        EXPECT_EQ_INT(expect.parse(ParseFlag::PARSE_STRICT_UTF8),
+            actual.parse(ParseFlag::PARSE_STRICT_UTF8 | ParseFlag::PARSE_PARALLEL));
+        EXPECT_EQ_INT(ValueType::NULL_TYPE, actual.get_type());
+    }
+}
+
 static void test_parse() {
     test_parse_null();
     test_parse_true();
@@ -337,10 +563,12 @@ static void test_parse() {
     test_parse_invalid_string_char();
     test_parse_invalid_unicode_hex();
     test_parse_invalid_unicode_surrogate();
+    test_parse_invalid_utf8();
     test_parse_miss_comma_or_square_bracket();
     test_parse_miss_key();
     test_parse_miss_colon();
     test_parse_miss_comma_or_curly_bracket();
+    test_parse_parallel();
 }
 
 static void test_access_null() {
@@ -380,7 +608,7 @@ static void test_access_array() {
         v.set_array({});
         v.get_array().reserve(i);
         EXPECT_EQ_SIZE_T(std::size_t{ 0 }, v.get_array().size());
-        EXPECT_EQ_SIZE_T(i, v.get_array().capacity());
+        EXPECT_EQ_SIZE_T(std::max<std::size_t>(i, LEPTJSON_SMALL_CAPACITY), v.get_array().capacity());
         for (int j = 0; j < 10; j++) {
             temp.set_number(j);
             v.get_array().push_back(std::move(temp.get_value()));
@@ -441,7 +669,7 @@ static void test_access_array() {
     EXPECT_EQ_SIZE_T(0, v.get_array().size());
     EXPECT_EQ_SIZE_T(old_capacity, v.get_array().capacity());
     v.get_array().shrink_to_fit();
-    EXPECT_EQ_SIZE_T(0, v.get_array().capacity());
+    EXPECT_EQ_SIZE_T(LEPTJSON_SMALL_CAPACITY, v.get_array().capacity());
 }
 
 static void test_access_object() {
@@ -469,6 +697,102 @@ static void test_access_object() {
     EXPECT_EQ_SIZE_T(std::size_t{}, v.get_object().size());
 }
 
+static void test_access_small() {
+    constexpr std::size_t n = LEPTJSON_SMALL_CAPACITY;
+    LeptJSON v;
+    v.set_array({});
+    auto& a = v.get_array();
+    EXPECT_EQ_SIZE_T(n, a.capacity());
+    for (std::size_t i = 0; i < n; i++) a.emplace_back(nullptr, ValueType::NULL_TYPE);
+    a.emplace_back(std::string(32, 's'), ValueType::STRING_TYPE);
+    /* the element pushed may live in the buffer being replaced */
+    while (a.size() < a.capacity()) a.push_back(a[n]);
+    a.push_back(a.back());
+    EXPECT_TRUE(a.capacity() > n + 1);
+    for (std::size_t i = n; i < a.size(); i++) EXPECT_EQ_STRING(std::string(32, 's'), get_string(a[i]));
+    LeptJSON moved(std::move(v));
+    EXPECT_EQ_INT(ValueType::STRING_TYPE, get_type(moved.get_array().back()));
+    moved.get_array().resize(1);
+    moved.get_array().shrink_to_fit();
+    EXPECT_EQ_SIZE_T(std::max<std::size_t>(n, 1), moved.get_array().capacity());
+    EXPECT_EQ_SIZE_T(std::size_t{ 1 }, moved.get_array().size());
+
+    /* members are sorted by key and the last of equal keys wins, however many there are */
+    for (int size : { 3, 40, 1000 }) {
+        std::string json = "{";
+        for (int i = size; i-- > 0;) json += "\"k" + std::to_string(i % (size / 2 + 1)) + "\":" + std::to_string(i) + ",";
+        json.back() = '}';
+        LeptJSON o(json.c_str());
+        EXPECT_EQ_INT(Status::PARSE_OK, o.parse());
+        const auto& members = std::as_const(o).get_object();
+        EXPECT_EQ_SIZE_T(static_cast<std::size_t>(size / 2 + 1), members.size());
+        EXPECT_TRUE(std::is_sorted(members.begin(), members.end(), [](auto& lhs, auto& rhs) { return lhs.first < rhs.first; }));
+        EXPECT_EQ_DOUBLE(0.0, get_number(members.at("k0")));
+        EXPECT_TRUE(o == details::parsed(o.stringify()));
+    }
+
+    LeptJSON o;
+    o.insert_or_assign("c", 1);
+    o.insert_or_assign("a", 2);
+    o.emplace("b", 3);
+    o.emplace("a", 4);
+    EXPECT_EQ_STRING("{\"a\":2,\"b\":3,\"c\":1}", o.stringify());
+    EXPECT_EQ_SIZE_T(std::size_t{ 1 }, o.get_object().erase("b"));
+    EXPECT_EQ_SIZE_T(std::size_t{ 0 }, o.get_object().erase("b"));
+    EXPECT_TRUE(o.get_object().find("b") == o.get_object().end());
+    EXPECT_EQ_STRING("{\"a\":2,\"c\":1}", o.stringify());
+}
+
+static void test_access_large_object() {
+    /* out-of-order inserts move a large object into a tree, so none of these builders is quadratic */
+    constexpr int n = 40000;
+    const auto start = std::chrono::steady_clock::now();
+    LeptJSON built, even, odd, ops;
+    ops.set_array({});
+    for (int i = n; i-- > 0;) {
+        const auto key = "k" + std::to_string(i);
+        built.insert_or_assign(key, i);
+        (i % 2 ? odd : even).insert_or_assign(key, i);
+        LeptJSON op;
+        op.insert_or_assign("op", "add");
+        op.insert_or_assign("path", "/" + key);
+        op.insert_or_assign("value", i);
+        ops.emplace_back(std::move(op));
+    }
+    even.apply_merge_patch(odd);
+    LeptJSON patched = details::parsed("{}");
+    EXPECT_EQ_INT(Status::PARSE_OK, patched.apply_patch(ops));
+    LeptJSON restored;
+    EXPECT_EQ_INT(Status::PARSE_OK, restored.from_tape(built.to_tape()));
+    LeptJSON::Schema schema;
+    EXPECT_EQ_INT(Status::PARSE_OK, LeptJSON::Schema::compile(details::parsed("{\"type\":\"object\",\"required\":[\"k0\"]}"), schema));
+    std::string json = "{";
+    for (int i = n; i-- > 0;) json += "\"k" + std::to_string(i) + "\":" + std::to_string(i) + ",";
+    json.back() = '}';
+    LeptJSON checked(json.c_str());
+    EXPECT_EQ_INT(Status::PARSE_OK, checked.parse(schema));
+    EXPECT_TRUE(std::chrono::steady_clock::now() - start < std::chrono::seconds(20));
+
+    const auto& members = std::as_const(built).get_object();
+    EXPECT_EQ_SIZE_T(static_cast<std::size_t>(n), members.size());
+    EXPECT_TRUE(std::is_sorted(members.begin(), members.end(), [](auto& lhs, auto& rhs) { return lhs.first < rhs.first; }));
+    EXPECT_EQ_DOUBLE(1234.0, get_number(members.at("k1234")));
+    for (const LeptJSON* v : { &even, &patched, &restored, &checked }) EXPECT_TRUE(built == *v);
+    EXPECT_TRUE(built == details::parsed(json));
+
+    /* erasing and copying work the same way on the tree */
+    auto& object = built.get_object();
+    std::size_t erased = 0;
+    for (int i = 0; i < n; i += 2) erased += object.erase("k" + std::to_string(i));
+    EXPECT_EQ_SIZE_T(static_cast<std::size_t>(n / 2), erased);
+    object.erase(object.find("k1"), std::next(object.find("k1")));
+    LeptJSON copy(built);
+    copy.insert_or_assign("k1", 1);
+    EXPECT_EQ_SIZE_T(static_cast<std::size_t>(n / 2 - 1), built.get_object().size());
+    EXPECT_EQ_SIZE_T(static_cast<std::size_t>(n / 2), copy.get_object().size());
+    EXPECT_TRUE(copy == odd);
+}
+
 static void test_access() {
     test_access_null();
     test_access_boolean();
@@ -476,6 +800,8 @@ static void test_access() {
     test_access_string();
     test_access_array();
     test_access_object();
+    test_access_small();
+    test_access_large_object();
 }
 
 static void test_stringify_number() {
@@ -520,6 +846,82 @@ static void test_stringify_object() {
         "{\"n\":null,\"f\":false,\"t\":true,\"i\":123,\"s\":\"abc\",\"a\":[1,2,3],\"o\":{\"1\":1,\"2\":2,\"3\":3}}");
 }
 
+static void test_stringify_parallel() {
+    std::string json = "{\"big\":[";
+    for (int i = 0; i < 300; i++) {
+        if (i) json += ',';
+        json += "{\"id\":" + std::to_string(i) + ",\"s\":\"\\n" + std::to_string(i) + "\",\"a\":[true,null,[1,2,{}]]}";
+    }
+    json += "],\"small\":1,\"nested\":{\"x\":[[[[1]]]],\"y\":\"z\"},\"list\":[";
+    for (int i = 0; i < 100; i++) {
+        if (i) json += ',';
+        json += std::to_string(i * 0.5);
+    }
+    json += "]}";
+    LeptJSON v(json.c_str());
+    EXPECT_EQ_INT(Status::PARSE_OK, v.parse());
+    const std::string expect = v.stringify();
+    for (std::size_t threshold : { 1, 2, 7, 64, 1000, 100000 }) {
+        v.set_parallel_stringify_threshold(threshold);
+        EXPECT_EQ_STRING(expect, v.stringify(LeptJSON::StringifyFlag::STRINGIFY_PARALLEL));
+        std::string joined;
+        bool empty_chunk = false;
+        for (auto&& chunk : v.stringify_chunks()) {
+            empty_chunk = empty_chunk || chunk.empty();
+            joined += chunk;
+        }
+        EXPECT_FALSE(empty_chunk);
+        EXPECT_EQ_STRING(expect, joined);
+    }
+
+    LeptJSON scalar("\"text\"");
+    EXPECT_EQ_INT(Status::PARSE_OK, scalar.parse());
+    scalar.set_parallel_stringify_threshold(1);
+    EXPECT_EQ_STRING("\"text\"", scalar.stringify(LeptJSON::StringifyFlag::STRINGIFY_PARALLEL));
+}
+
+static void test_stringify_segments() {
+    const std::string plain(2000, 'x');
+    const std::string json = "{\"a\":[\"" + plain + "\",\"short\",1.5,true],\"b\":\"" + plain + "\\n\",\"c\":\"" + plain + "\"}";
+    LeptJSON v(json.c_str());
+    EXPECT_EQ_INT(Status::PARSE_OK, v.parse());
+    const std::string expect = v.stringify();
+
+    const auto segments = v.stringify_segments();
+    EXPECT_EQ_STRING(expect, segments.str());
+    EXPECT_EQ_SIZE_T(expect.size(), segments.size());
+    const auto views = segments.views();
+    const auto& object = std::as_const(v).get_object();
+    const char* long_a = get_string(get_array(object.at("a"))[0]).data();
+    const char* long_b = get_string(object.at("b")).data();
+    const char* long_c = get_string(object.at("c")).data();
+    std::size_t referenced = 0;
+    for (auto&& view : views) {
+        EXPECT_FALSE(view.empty());
+        EXPECT_TRUE(view.data() != long_b);
+        if (view.data() == long_a || view.data() == long_c) {
+            EXPECT_EQ_SIZE_T(plain.size(), view.size());
+            referenced++;
+        }
+    }
+    EXPECT_EQ_SIZE_T(2, referenced);
+#ifndef _WIN32
+    std::size_t total = 0;
+    for (auto&& iov : segments.iovecs()) total += iov.iov_len;
+    EXPECT_EQ_SIZE_T(expect.size(), total);
+#endif
+
+    const auto copied = v.stringify_segments(plain.size() + 1);
+    EXPECT_EQ_SIZE_T(1, copied.views().size());
+    EXPECT_EQ_STRING(expect, copied.str());
+
+    LeptJSON scalar;
+    scalar.set_string(plain);
+    const auto alone = scalar.stringify_segments(1);
+    EXPECT_EQ_SIZE_T(3, alone.views().size());
+    EXPECT_EQ_STRING("\"" + plain + "\"", alone.str());
+}
+
 static void test_stringify() {
     details::test_round_trip("null");
     details::test_round_trip("false");
@@ -528,6 +930,8 @@ static void test_stringify() {
     test_stringify_string();
     test_stringify_array();
     test_stringify_object();
+    test_stringify_parallel();
+    test_stringify_segments();
 }
 
 static void test_equal() {
@@ -588,6 +992,1030 @@ void test_swap() {
     EXPECT_EQ_STRING("World", v2.get_string());
 }
 
+static void test_copy_on_write() {
+    LeptJSON v1("{\"a\":{\"b\":[1,2,{\"c\":true}]},\"big\":[0,1,2,3,4,5,6,7,8,9]}");
+    EXPECT_EQ_INT(Status::PARSE_OK, v1.parse());
+    LeptJSON v2(v1);
+    const LeptJSON& c1 = v1;
+    const LeptJSON& c2 = v2;
+    EXPECT_TRUE(&c1.get_object() == &c2.get_object());
+
+    /* a write three levels down clones the root, "a" and "b" but leaves "big" shared */
+    LeptJSON ten, no;
+    ten.set_number(10);
+    no.set_boolean(false);
+    auto& root = v2.get_object();
+    auto& b = mutable_array(mutable_object(root.at("a")).at("b"));
+    b[0] = ten.get_value();
+    mutable_object(b[2])["c"] = no.get_value();
+    EXPECT_TRUE(&c1.get_object() != &c2.get_object());
+    EXPECT_TRUE(&get_object(c1.get_object().at("a")) != &get_object(c2.get_object().at("a")));
+    EXPECT_TRUE(&get_array(c1.get_object().at("big")) == &get_array(c2.get_object().at("big")));
+    EXPECT_EQ_DOUBLE(1.0, get_number(get_array(get_object(c1.get_object().at("a")).at("b"))[0]));
+    EXPECT_EQ_DOUBLE(10.0, get_number(get_array(get_object(c2.get_object().at("a")).at("b"))[0]));
+    EXPECT_EQ_INT(ValueType::TRUE_TYPE, get_type(get_object(get_array(get_object(c1.get_object().at("a")).at("b"))[2]).at("c")));
+    EXPECT_EQ_INT(ValueType::FALSE_TYPE, get_type(get_object(get_array(get_object(c2.get_object().at("a")).at("b"))[2]).at("c")));
+    EXPECT_FALSE(is_equal(v1, v2));
+
+    /* an unshared value is written in place */
+    const auto* before = &c2.get_object();
+    v2.get_object().erase("big");
+    EXPECT_TRUE(&c2.get_object() == before);
+    EXPECT_EQ_SIZE_T(std::size_t{ 10 }, get_array(c1.get_object().at("big")).size());
+
+    LeptJSON v3;
+    v3 = v1;
+    EXPECT_TRUE(is_equal(v3, v1));
+    v3.get_object().at("big") = ten.get_value();
+    EXPECT_EQ_INT(ValueType::ARRAY_TYPE, get_type(c1.get_object().at("big")));
+}
+
+static void test_hash() {
+    using details::parsed;
+    LeptJSON v1 = parsed("{\"b\":[1,2,{\"c\":null}],\"a\":\"x\"}");
+    LeptJSON v2 = parsed(" { \"a\" : \"x\" , \"b\" : [ 1 , 2 , { \"c\" : null } ] } ");
+    EXPECT_TRUE(v1.hash() == v2.hash());
+    EXPECT_TRUE(parsed("0").hash() == parsed("-0").hash());
+    EXPECT_TRUE(parsed("[1,2]").hash() != parsed("[2,1]").hash());
+    EXPECT_TRUE(parsed("[[]]").hash() != parsed("[{}]").hash());
+    EXPECT_TRUE(parsed("{\"a\":1}").hash() != parsed("{\"a\":2}").hash());
+
+    /* the cached hash follows writes */
+    LeptJSON v3(v1);
+    const auto before = v3.hash();
+    v3.get_object().at("a") = parsed("\"y\"").get_value();
+    EXPECT_TRUE(v3.hash() != before);
+    EXPECT_TRUE(v3.hash() == parsed("{\"a\":\"y\",\"b\":[1,2,{\"c\":null}]}").hash());
+    EXPECT_TRUE(v1.hash() == before);
+    EXPECT_FALSE(is_equal(v1, v3));
+    mutable_object(mutable_array(v3.get_object().at("b"))[2])["c"] = parsed("true").get_value();
+    EXPECT_TRUE(v3.hash() == parsed("{\"a\":\"y\",\"b\":[1,2,{\"c\":true}]}").hash());
+
+    /* a write through a reference held across hash() is still seen by hash() and == */
+    LeptJSON held = parsed("[1,\"x\"]");
+    const LeptJSON expect = parsed("[1,\"x\",\"x\"]");
+    auto& elements = held.get_array();
+    EXPECT_TRUE(held.hash() != expect.hash());
+    EXPECT_FALSE(held == expect);
+    elements.push_back(elements[1]);
+    EXPECT_TRUE(held == expect);
+    EXPECT_TRUE(held.hash() == expect.hash());
+    LeptJSON outer = parsed("{\"a\":[]}");
+    auto& inner = mutable_array(outer.get_object().at("a"));
+    const auto empty = outer.hash();
+    inner.push_back(parsed("1").get_value());
+    EXPECT_TRUE(outer.hash() != empty);
+    EXPECT_TRUE(outer.hash() == parsed("{\"a\":[1]}").hash());
+    std::unordered_set<LeptJSON> same{ held, expect };
+    EXPECT_EQ_SIZE_T(std::size_t{ 1 }, same.size());
+
+    /* equal documents collapse in hashed containers */
+    std::unordered_set<LeptJSON> set;
+    set.insert(v1);
+    set.insert(v2);
+    set.insert(v3);
+    set.insert(parsed("null"));
+    EXPECT_EQ_SIZE_T(std::size_t{ 3 }, set.size());
+    EXPECT_TRUE(set.count(parsed("{\"a\":\"x\",\"b\":[1,2,{\"c\":null}]}")) == 1);
+}
+
+static void test_patch() {
+    using details::parsed;
+    /* RFC 6902 appendix A */
+    details::test_patch("{\"baz\":\"qux\",\"foo\":\"bar\"}", "{\"foo\":\"bar\"}", "[{\"op\":\"add\",\"path\":\"/baz\",\"value\":\"qux\"}]");
+    details::test_patch("{\"foo\":[\"bar\",\"qux\",\"baz\"]}", "{\"foo\":[\"bar\",\"baz\"]}", "[{\"op\":\"add\",\"path\":\"/foo/1\",\"value\":\"qux\"}]");
+    details::test_patch("{\"foo\":[\"bar\",\"baz\",\"qux\"]}", "{\"foo\":[\"bar\",\"baz\"]}", "[{\"op\":\"add\",\"path\":\"/foo/-\",\"value\":\"qux\"}]");
+    details::test_patch("{\"foo\":\"bar\"}", "{\"baz\":\"qux\",\"foo\":\"bar\"}", "[{\"op\":\"remove\",\"path\":\"/baz\"}]");
+    details::test_patch("{\"foo\":[\"bar\",\"baz\"]}", "{\"foo\":[\"bar\",\"qux\",\"baz\"]}", "[{\"op\":\"remove\",\"path\":\"/foo/1\"}]");
+    details::test_patch("{\"baz\":\"boo\",\"foo\":\"bar\"}", "{\"baz\":\"qux\",\"foo\":\"bar\"}", "[{\"op\":\"replace\",\"path\":\"/baz\",\"value\":\"boo\"}]");
+    details::test_patch("{\"foo\":{\"bar\":\"baz\"},\"qux\":{\"corge\":\"grault\",\"thud\":\"fred\"}}",
+        "{\"foo\":{\"bar\":\"baz\",\"waldo\":\"fred\"},\"qux\":{\"corge\":\"grault\"}}",
+        "[{\"op\":\"move\",\"from\":\"/foo/waldo\",\"path\":\"/qux/thud\"}]");
+    details::test_patch("{\"foo\":[\"all\",\"cows\",\"eat\",\"grass\"]}", "{\"foo\":[\"all\",\"grass\",\"cows\",\"eat\"]}",
+        "[{\"op\":\"move\",\"from\":\"/foo/1\",\"path\":\"/foo/3\"}]");
+    details::test_patch("{\"baz\":\"qux\",\"foo\":[\"a\",2,\"c\"]}", "{\"baz\":\"qux\",\"foo\":[\"a\",2,\"c\"]}",
+        "[{\"op\":\"test\",\"path\":\"/baz\",\"value\":\"qux\"},{\"op\":\"test\",\"path\":\"/foo/1\",\"value\":2}]");
+    details::test_patch("{\"/\":9,\"~1\":10}", "{\"/\":9,\"~1\":10}", "[{\"op\":\"test\",\"path\":\"/~01\",\"value\":10}]");
+    details::test_patch("{\"a\":[1],\"b\":[1]}", "{\"a\":[1]}", "[{\"op\":\"copy\",\"from\":\"/a\",\"path\":\"/b\"}]");
+    details::test_patch("[1]", "{\"a\":1}", "[{\"op\":\"add\",\"path\":\"\",\"value\":[1]}]");
+    details::test_patch("{\"a\":2,\"b\":3}", "{\"a\":1}", "[{\"op\":\"replace\",\"path\":\"/a\",\"value\":2},{\"op\":\"add\",\"path\":\"/b\",\"value\":3}]");
+
+    /* a failing operation anywhere leaves the whole document as it was */
+    details::test_patch_error(Status::PATCH_TEST_FAILED, "{\"baz\":\"qux\"}", "[{\"op\":\"test\",\"path\":\"/baz\",\"value\":\"bar\"}]");
+    details::test_patch_error(Status::PATCH_TEST_FAILED, "{\"a\":1}",
+        "[{\"op\":\"remove\",\"path\":\"/a\"},{\"op\":\"test\",\"path\":\"\",\"value\":null}]");
+    details::test_patch_error(Status::PATCH_PATH_NOT_FOUND, "{\"foo\":\"bar\"}", "[{\"op\":\"add\",\"path\":\"/baz/bat\",\"value\":\"qux\"}]");
+    details::test_patch_error(Status::PATCH_PATH_NOT_FOUND, "[1,2]", "[{\"op\":\"add\",\"path\":\"/3\",\"value\":3}]");
+    details::test_patch_error(Status::PATCH_PATH_NOT_FOUND, "[1,2]", "[{\"op\":\"remove\",\"path\":\"/01\"}]");
+    details::test_patch_error(Status::PATCH_PATH_NOT_FOUND, "[1,2]", "[{\"op\":\"move\",\"from\":\"/0\",\"path\":\"/2\"}]");
+    details::test_patch_error(Status::PATCH_PATH_NOT_FOUND, "{\"a\":1}", "[{\"op\":\"move\",\"from\":\"/zz\",\"path\":\"/zz\"}]");
+    details::test_patch_error(Status::PATCH_PATH_NOT_FOUND, "{\"a\":1}", "[{\"op\":\"move\",\"from\":\"/zz\",\"path\":\"/zz/y\"}]");
+    details::test_patch_error(Status::PATCH_PATH_NOT_FOUND, "{\"a\":1}", "[{\"op\":\"replace\",\"path\":\"/b\",\"value\":2}]");
+    details::test_patch_error(Status::PATCH_INVALID_OPERATION, "{\"a\":{}}", "[{\"op\":\"move\",\"from\":\"/a\",\"path\":\"/a/b\"}]");
+    details::test_patch_error(Status::PATCH_INVALID_OPERATION, "{\"a\":1}", "[{\"op\":\"add\",\"path\":\"/b\"}]");
+    details::test_patch_error(Status::PATCH_INVALID_OPERATION, "{\"a\":1}", "[{\"op\":\"launch\",\"path\":\"/a\"}]");
+    details::test_patch_error(Status::PATCH_INVALID_OPERATION, "{\"a\":1}", "[{\"op\":\"remove\",\"path\":\"a\"}]");
+    details::test_patch_error(Status::PATCH_INVALID_OPERATION, "{\"a\":1}", "[{\"op\":\"remove\",\"path\":\"/~2\"}]");
+    details::test_patch_error(Status::PATCH_INVALID_OPERATION, "{\"a\":1}", "{\"op\":\"remove\",\"path\":\"/a\"}");
+
+    /* copies sharing subtrees with the patched document keep their values */
+    LeptJSON v1 = parsed("{\"a\":{\"b\":[1,2]},\"c\":[3]}");
+    const LeptJSON v2(v1);
+    EXPECT_EQ_INT(Status::PARSE_OK, v1.apply_patch(parsed("[{\"op\":\"add\",\"path\":\"/a/b/-\",\"value\":3}]")));
+    EXPECT_TRUE(is_equal(parsed("{\"a\":{\"b\":[1,2]},\"c\":[3]}"), v2));
+    EXPECT_TRUE(&get_array(v1.get_object().at("c")) == &get_array(v2.get_object().at("c")));
+
+    /* RFC 7386 */
+    details::test_merge_patch("{\"a\":\"z\",\"c\":{\"d\":\"e\"}}", "{\"a\":\"b\",\"c\":{\"d\":\"e\",\"f\":\"g\"}}", "{\"a\":\"z\",\"c\":{\"f\":null}}");
+    details::test_merge_patch("{\"a\":\"c\"}", "{\"a\":\"b\"}", "{\"a\":\"c\"}");
+    details::test_merge_patch("{\"b\":\"c\"}", "{\"a\":\"b\"}", "{\"a\":null,\"b\":\"c\"}");
+    details::test_merge_patch("{\"a\":[\"b\"]}", "{\"a\":\"foo\"}", "{\"a\":[\"b\"]}");
+    details::test_merge_patch("{\"a\":{\"b\":\"c\"}}", "{\"a\":[{\"b\":\"c\"}]}", "{\"a\":{\"b\":\"c\"}}");
+    details::test_merge_patch("[\"c\"]", "{\"a\":\"foo\"}", "[\"c\"]");
+    details::test_merge_patch("{\"e\":null,\"a\":1}", "{\"e\":null}", "{\"a\":1}");
+    details::test_merge_patch("{\"a\":{\"bb\":{}}}", "{}", "{\"a\":{\"bb\":{\"ccc\":null}}}");
+
+    details::test_diff("{\"a\":1}", "{\"a\":1}");
+    details::test_diff("{\"a\":1,\"b\":[1,2,3],\"c\":{\"d\":true}}", "{\"a\":2,\"b\":[1,3],\"c\":{\"e\":null},\"f\":\"x\"}");
+    details::test_diff("[1,2,3,4,5]", "[0,1,2,9,4,5,6]");
+    details::test_diff("[[1,{\"a/b~\":1}],2]", "[[1,{\"a/b~\":2}],2,3]");
+    details::test_diff("[1,2,3]", "[]");
+    details::test_diff("{\"a\":[1]}", "[{\"a\":1}]");
+    EXPECT_EQ_SIZE_T(std::size_t{ 0 }, parsed("{\"a\":[1,2]}").diff(parsed("{\"a\":[1,2]}")).get_array().size());
+    EXPECT_TRUE(is_equal(parsed("[{\"op\":\"replace\",\"path\":\"/a/1\",\"value\":3}]"),
+        parsed("{\"a\":[1,2],\"b\":{}}").diff(parsed("{\"a\":[1,3],\"b\":{}}"))));
+
+    /* hashes kept by one diff() do not hide a later write through a held reference */
+    LeptJSON edited = parsed("{\"a\":[1,2],\"b\":{}}");
+    const LeptJSON original = parsed("{\"a\":[1,2],\"b\":{}}");
+    auto& elements = mutable_array(edited.get_object().at("a"));
+    EXPECT_EQ_SIZE_T(std::size_t{ 0 }, edited.diff(original).get_array().size());
+    elements[1] = parsed("3").get_value();
+    EXPECT_TRUE(is_equal(parsed("[{\"op\":\"replace\",\"path\":\"/a/1\",\"value\":2}]"), edited.diff(original)));
+}
+
+static void test_projection() {
+    using details::parsed;
+    const char* doc = "{\"id\":7,\"user\":{\"name\":\"n\",\"bio\":\"long text\",\"tags\":[1,2]},"
+        "\"items\":[{\"price\":1.5,\"sku\":\"a\"},{\"sku\":\"b\"},{\"price\":{\"amount\":2}}],"
+        "\"a/b\":true,\"skipped\":[{\"deep\":[null,false,\"\\u00e9\",-1e40]}]}";
+    LeptJSON::Projection projection;
+    EXPECT_TRUE(projection.add("/id"));
+    EXPECT_TRUE(projection.add("/user/name"));
+    EXPECT_TRUE(projection.add("/items/price"));
+    EXPECT_TRUE(projection.add("/a~1b"));
+    EXPECT_TRUE(projection.add("/missing/field"));
+    EXPECT_FALSE(projection.add("id"));
+    EXPECT_FALSE(projection.add("/~"));
+    LeptJSON v(doc);
+    EXPECT_EQ_INT(Status::PARSE_OK, v.parse(projection));
+    EXPECT_TRUE(is_equal(parsed("{\"id\":7,\"user\":{\"name\":\"n\"},\"items\":[{\"price\":1.5},{},{\"price\":{\"amount\":2}}],\"a/b\":true}"), v));
+
+    /* a selected path keeps its subtree, and a path below it adds nothing */
+    LeptJSON::Projection user;
+    EXPECT_TRUE(user.add("/user"));
+    EXPECT_TRUE(user.add("/user/name"));
+    LeptJSON v2(doc);
+    EXPECT_EQ_INT(Status::PARSE_OK, v2.parse(user));
+    EXPECT_TRUE(is_equal(parsed("{\"user\":{\"name\":\"n\",\"bio\":\"long text\",\"tags\":[1,2]}}"), v2));
+
+    LeptJSON::Projection all;
+    EXPECT_TRUE(all.add(""));
+    LeptJSON v3(doc);
+    EXPECT_EQ_INT(Status::PARSE_OK, v3.parse(all, ParseFlag::PARSE_PARALLEL));
+    EXPECT_EQ_INT(ValueType::ARRAY_TYPE, get_type(v3.get_object().at("skipped")));
+
+    /* skipped members are still validated */
+    LeptJSON v4("{\"id\":1,\"skipped\":[1,2,}");
+    EXPECT_EQ_INT(Status::PARSE_INVALID_VALUE, v4.parse(projection));
+    EXPECT_EQ_INT(ValueType::NULL_TYPE, v4.get_type());
+    LeptJSON v5("{\"skipped\":\"\\x\",\"id\":1}");
+    EXPECT_EQ_INT(Status::PARSE_INVALID_STRING_ESCAPE, v5.parse(projection));
+    LeptJSON v6("{\"id\":1} 2");
+    EXPECT_EQ_INT(Status::PARSE_ROOT_NOT_SINGULAR, v6.parse(projection));
+
+    /* the projection only applies to the call it is given to */
+    LeptJSON v7(doc);
+    EXPECT_EQ_INT(Status::PARSE_OK, v7.parse());
+    EXPECT_EQ_SIZE_T(std::size_t{ 5 }, v7.get_object().size());
+}
+
+static void test_query() {
+    /* keys in sorted order, so source order and the tree's map order agree */
+    const char* store = "{\"id\":0,\"store\":{\"bicycle\":{\"color\":\"red\",\"id\":4,\"price\":19.95},\"book\":["
+        "{\"author\":\"Rees\",\"category\":\"reference\",\"id\":1,\"price\":8.95,\"title\":\"Sayings\"},"
+        "{\"author\":\"Waugh\",\"category\":\"fiction\",\"id\":2,\"isbn\":\"0-553\",\"price\":12.99,\"title\":\"Sword\"},"
+        "{\"author\":\"Tolkien\",\"category\":\"fiction\",\"id\":3,\"isbn\":\"0-395\",\"price\":22.99,\"title\":\"Rings\"}]}}";
+    details::test_query("[[\"Rees\",\"Waugh\",\"Tolkien\"]]", "{\"a\":[\"Rees\",\"Waugh\",\"Tolkien\"]}", "$.a");
+    details::test_query("[\"Rees\",\"Waugh\",\"Tolkien\"]", store, "$.store.book[*].author");
+    details::test_query("[\"Rees\",\"Waugh\",\"Tolkien\"]", store, "$..author");
+    details::test_query("[0,4,1,2,3]", store, "$..id");
+    details::test_query("[19.95,8.95,12.99,22.99]", store, "$.store..price");
+    details::test_query("[\"Rings\"]", store, "$['store']['book'][-1].title");
+    details::test_query("[\"Sword\"]", store, "$..book[1]['title']");
+    details::test_query("[]", store, "$..book[3]");
+    details::test_query("[\"Sayings\"]", store, "$.store.book[?(@.price < 10)].title");
+    details::test_query("[\"Sword\",\"Rings\"]", store, "$..book[?(@.isbn)].title");
+    details::test_query("[\"Sword\",\"Rings\"]", store, "$..[?(@.category == 'fiction')].title");
+    details::test_query("[\"Rees\"]", store, "$..book[?@.category != \"fiction\"].author");
+    details::test_query("[2,3]", store, "$.store.book[?(@.price >= 12.99)].id");
+    details::test_query("[{\"color\":\"red\",\"id\":4,\"price\":19.95}]", store, "$.store[?(@.color)]");
+    details::test_query("[2]", "[{\"a\":[1,2]},{\"a\":[3]}]", "$[?(@.a[1])].a[1]");
+    details::test_query("[{\"b\":true}]", "[{\"b\":true},{\"b\":false},{\"b\":null}]", "$[?(@.b == true)]");
+    details::test_query("[{\"b\":null}]", "[{\"b\":true},{\"b\":false},{\"b\":null}]", "$[?(@.b == null)]");
+    details::test_query("[[[1]],[1],1]", "[[[1]]]", "$..*");
+    details::test_query("[1,[2],2]", "{\"x\":[1,[2]]}", "$.x..*");
+    details::test_query("[{\"a\":{\"a\":1}},{\"a\":1},1]", "{\"a\":{\"a\":{\"a\":1}}}", "$..a");
+    details::test_query("[{\"k\":1}]", "{\"k\":1}", "$");
+    details::test_query("[1]", "{\"a b\":{\"c'd\":1}}", "$['a b']['c\\'d']");
+
+    /* text matches are the exact source of each value, and the input is still validated */
+    LeptJSON::JsonPath path;
+    EXPECT_EQ_INT(Status::PARSE_OK, LeptJSON::JsonPath::compile("$.a", path));
+    std::vector<std::string_view> matches;
+    EXPECT_EQ_INT(Status::PARSE_OK, LeptJSON::query("{ \"a\" : [1, 2] , \"b\":{}} ", path, matches));
+    EXPECT_EQ_SIZE_T(std::size_t{ 1 }, matches.size());
+    EXPECT_EQ_STRING("[1, 2]", std::string(matches[0]));
+    EXPECT_EQ_INT(Status::PARSE_MISS_COMMA_OR_CURLY_BRACKET, LeptJSON::query("{\"a\":1,\"b\":[2] ", path, matches));
+    EXPECT_EQ_SIZE_T(std::size_t{ 0 }, matches.size());
+    EXPECT_EQ_INT(Status::PARSE_ROOT_NOT_SINGULAR, LeptJSON::query("{\"a\":1} x", path, matches));
+    EXPECT_EQ_INT(Status::PARSE_EXPECT_VALUE, LeptJSON::query(" ", path, matches));
+
+    details::test_query_error("");
+    details::test_query_error("a.b");
+    details::test_query_error("$.");
+    details::test_query_error("$..");
+    details::test_query_error("$[1");
+    details::test_query_error("$['a]");
+    details::test_query_error("$[a]");
+    details::test_query_error("$[?(@.a > )]");
+    details::test_query_error("$[?(@.a == 1]");
+    details::test_query_error("$[?(a)]");
+    details::test_query_error("$[?(@[-1])]");
+    details::test_query_error("$[0:2]");
+    details::test_query_error("$['a','b']");
+}
+
+static void test_schema() {
+    const Status ok = Status::PARSE_OK, violation = Status::PARSE_SCHEMA_VIOLATION;
+    const char* order = "{\"type\":\"object\",\"required\":[\"id\",\"lines\"],\"properties\":{"
+        "\"id\":{\"type\":\"integer\",\"minimum\":1},"
+        "\"status\":{\"enum\":[\"open\",\"paid\",null]},"
+        "\"note\":{\"type\":[\"string\",\"null\"],\"minLength\":1,\"maxLength\":3},"
+        "\"lines\":{\"type\":\"array\",\"minItems\":1,\"maxItems\":2,\"items\":{\"type\":\"object\",\"required\":[\"qty\"],"
+        "\"properties\":{\"qty\":{\"type\":\"number\",\"exclusiveMinimum\":0,\"maximum\":10}}}}}}";
+    details::test_schema(ok, "", order, "{\"id\":1,\"lines\":[{\"qty\":0.5}],\"extra\":[1,{}]}");
+    details::test_schema(ok, "", order, "{\"id\":2,\"status\":null,\"note\":\"\\u00e9t\\u00e9\",\"lines\":[{\"qty\":10},{\"qty\":1,\"sku\":\"x\"}]}");
+    details::test_schema(violation, "", order, "[1]");
+    details::test_schema(violation, "/id", order, "{\"id\":1.5,\"lines\":[{\"qty\":1}]}");
+    details::test_schema(violation, "/id", order, "{\"id\":0,\"lines\":[{\"qty\":1}]}");
+    details::test_schema(violation, "/id", order, "{\"id\":\"1\",\"lines\":[{\"qty\":1}]}");
+    details::test_schema(violation, "/status", order, "{\"id\":1,\"status\":\"lost\",\"lines\":[{\"qty\":1}]}");
+    details::test_schema(violation, "/note", order, "{\"id\":1,\"note\":\"\",\"lines\":[{\"qty\":1}]}");
+    details::test_schema(violation, "/note", order, "{\"id\":1,\"note\":\"four\",\"lines\":[{\"qty\":1}]}");
+    details::test_schema(violation, "/lines", order, "{\"id\":1,\"lines\":[]}");
+    details::test_schema(violation, "/lines/2", order, "{\"id\":1,\"lines\":[{\"qty\":1},{\"qty\":1},{\"qty\":1}]}");
+    details::test_schema(violation, "/lines/1/qty", order, "{\"id\":1,\"lines\":[{\"qty\":1},{\"qty\":0}]}");
+    details::test_schema(violation, "/lines/0/qty", order, "{\"id\":1,\"lines\":[{\"qty\":10.5}]}");
+    details::test_schema(violation, "/lines/0/qty", order, "{\"id\":1,\"lines\":[{}]}");
+    details::test_schema(violation, "/lines", order, "{\"id\":1}");
+
+    /* a violation stops the parse before later syntax errors are reached, and syntax errors keep their status */
+    details::test_schema(violation, "/id", order, "{\"id\":\"x\",\"lines\":[}");
+    details::test_schema(Status::PARSE_MISS_COMMA_OR_SQUARE_BRACKET, "", order, "{\"id\":1,\"lines\":[{\"qty\":1}}");
+    details::test_schema(Status::PARSE_INVALID_VALUE, "", order, "{\"id\":?}");
+    details::test_schema(Status::PARSE_ROOT_NOT_SINGULAR, "", order, "{\"id\":1,\"lines\":[{\"qty\":1}]} 1");
+
+    details::test_schema(ok, "", "true", "[{\"a\":null}]");
+    details::test_schema(violation, "", "false", "0");
+    details::test_schema(ok, "", "{\"enum\":[[1,{\"a\":2}],3]}", "[1,{\"a\":2}]");
+    details::test_schema(violation, "", "{\"enum\":[[1,{\"a\":2}],3]}", "[1,{\"a\":3}]");
+    details::test_schema(violation, "/a~1b", "{\"properties\":{\"a/b\":{\"type\":\"boolean\"}}}", "{\"a/b\":1}");
+    details::test_schema(ok, "", "{\"required\":[\"id\",\"id\"]}", "{\"id\":1}");
+    details::test_schema(violation, "/id", "{\"required\":[\"id\",\"id\"]}", "{\"ID\":1}");
+
+    /* a default-constructed schema accepts anything */
+    LeptJSON::Schema compiled;
+    LeptJSON any("{\"a\":[1,null]}");
+    EXPECT_EQ_INT(Status::PARSE_OK, any.parse(compiled));
+    EXPECT_TRUE(is_equal(details::parsed("{\"a\":[1,null]}"), any));
+    LeptJSON::Schema taken(std::move(compiled));
+    EXPECT_EQ_INT(Status::SCHEMA_INVALID, any.parse(compiled));
+    EXPECT_EQ_INT(ValueType::NULL_TYPE, any.get_type());
+    EXPECT_EQ_INT(Status::SCHEMA_INVALID, LeptJSON::Schema::compile(details::parsed("{\"type\":\"float\"}"), compiled));
+    EXPECT_EQ_INT(Status::SCHEMA_INVALID, LeptJSON::Schema::compile(details::parsed("{\"required\":\"id\"}"), compiled));
+    EXPECT_EQ_INT(Status::SCHEMA_INVALID, LeptJSON::Schema::compile(details::parsed("{\"maxLength\":-1}"), compiled));
+    EXPECT_EQ_INT(Status::SCHEMA_INVALID, LeptJSON::Schema::compile(details::parsed("{\"items\":{\"minimum\":\"0\"}}"), compiled));
+    EXPECT_EQ_INT(Status::SCHEMA_INVALID, LeptJSON::Schema::compile(details::parsed("1"), compiled));
+}
+
+static void test_lazy_number() {
+    const char* json = "[1.10,12345678901234567890.123456789,-0,1e400,9007199254740993,2.5E0,-9223372036854775808]";
+    LeptJSON v(json);
+    EXPECT_EQ_INT(Status::PARSE_OK, v.parse(ParseFlag::PARSE_LAZY_NUMBERS));
+    EXPECT_EQ_STRING(std::string(json), v.stringify());
+    const auto& a = std::as_const(v).get_array();
+    EXPECT_EQ_DOUBLE(1.1, get_number(a[0]));
+    EXPECT_EQ_DOUBLE(1.1, get_number(a[0]));
+    EXPECT_EQ_DOUBLE(12345678901234567890.123456789, get_number(a[1]));
+    EXPECT_EQ_DOUBLE(HUGE_VAL, get_number(a[3]));
+    EXPECT_TRUE(get_int64(a[4]) == 9007199254740993);
+    EXPECT_TRUE(get_int64(a[5]) == 2);
+    EXPECT_TRUE(get_int64(a[6]) == std::numeric_limits<std::int64_t>::min());
+    EXPECT_TRUE(get_int64(a[3]) == std::numeric_limits<std::int64_t>::max());
+
+    /* lazy and eager trees compare and hash by value */
+    LeptJSON lazy("{\"a\":[1.50,-0.0,100e-2]}"), eager("{\"a\":[1.5,0,1]}");
+    EXPECT_EQ_INT(Status::PARSE_OK, lazy.parse(ParseFlag::PARSE_LAZY_NUMBERS));
+    EXPECT_EQ_INT(Status::PARSE_OK, eager.parse());
+    EXPECT_TRUE(is_equal(lazy, eager));
+    EXPECT_TRUE(lazy.hash() == eager.hash());
+
+    /* copies and writes keep long texts intact, and a tape round trip keeps the text */
+    LeptJSON copy(v);
+    copy.get_array().push_back(copy.get_array()[1]);
+    copy.get_array().erase(copy.get_array().begin());
+    EXPECT_EQ_STRING(std::string("[12345678901234567890.123456789,-0,1e400,9007199254740993,2.5E0,-9223372036854775808,12345678901234567890.123456789]"),
+        copy.stringify());
+    EXPECT_EQ_STRING(std::string(json), v.stringify());
+    LeptJSON restored;
+    EXPECT_EQ_INT(Status::PARSE_OK, restored.from_tape(v.to_tape()));
+    EXPECT_EQ_STRING(std::string(json), restored.stringify());
+    EXPECT_TRUE(is_equal(v, restored));
+
+    LeptJSON bad("01");
+    EXPECT_EQ_INT(Status::PARSE_ROOT_NOT_SINGULAR, bad.parse(ParseFlag::PARSE_LAZY_NUMBERS));
+    LeptJSON big("1e400");
+    EXPECT_EQ_INT(Status::PARSE_NUMBER_TOO_BIG, big.parse());
+}
+
+static void test_number_array() {
+    LeptJSON v("[[1.5, -2,0 ,1e3],[1,\"x\",2],[],[3]]");
+    EXPECT_EQ_INT(Status::PARSE_OK, v.parse());
+    const auto& a = std::as_const(v).get_array();
+    EXPECT_TRUE(is_number_array(a[0]));
+    const auto numbers = get_numbers(a[0]);
+    EXPECT_EQ_SIZE_T(4, numbers.size());
+    EXPECT_EQ_DOUBLE(1.5, numbers[0]);
+    EXPECT_EQ_DOUBLE(-2.0, numbers[1]);
+    EXPECT_EQ_DOUBLE(1000.0, numbers[3]);
+    EXPECT_FALSE(is_number_array(a[1]));
+    EXPECT_FALSE(is_number_array(a[2]));
+    EXPECT_TRUE(is_number_array(a[3]));
+    EXPECT_FALSE(v.is_number_array());
+    EXPECT_EQ_STRING(std::string("[[1.5,-2,0,1000],[1,\"x\",2],[],[3]]"), v.stringify());
+
+    /* generic readers see ordinary elements */
+    EXPECT_EQ_SIZE_T(4, get_array(a[0]).size());
+    EXPECT_EQ_DOUBLE(-2.0, get_number(get_array(a[0])[1]));
+
+    /* both storages compare and hash by value */
+    LeptJSON generic;
+    generic.set_array({});
+    for (double d : { 1.5, -2.0, 0.0, 1000.0 }) generic.emplace_back(d);
+    LeptJSON numeric;
+    numeric.set_numbers({ 1.5, -2.0, -0.0, 1e3 });
+    EXPECT_TRUE(numeric.is_number_array());
+    EXPECT_TRUE(is_equal(numeric, generic));
+    EXPECT_TRUE(is_equal(generic, numeric));
+    EXPECT_TRUE(numeric.hash() == generic.hash());
+    EXPECT_TRUE(hash(a[0]) == generic.hash());
+    LeptJSON other;
+    other.set_numbers({ 1.5, -2.0, 0.0 });
+    EXPECT_FALSE(is_equal(numeric, other));
+
+    /* a write converts the storage, a copy keeps the numbers */
+    LeptJSON copy(numeric);
+    copy.emplace_back("tail");
+    EXPECT_FALSE(copy.is_number_array());
+    EXPECT_TRUE(numeric.is_number_array());
+    EXPECT_EQ_STRING(std::string("[1.5,-2,-0,1000,\"tail\"]"), copy.stringify());
+    EXPECT_EQ_STRING(std::string("[1.5,-2,-0,1000]"), numeric.stringify());
+
+    /* binary formats write the numbers without expanding them */
+    LeptJSON restored;
+    EXPECT_EQ_INT(Status::PARSE_OK, restored.from_msgpack(v.to_msgpack()));
+    EXPECT_TRUE(is_equal(v, restored));
+    EXPECT_EQ_INT(Status::PARSE_OK, restored.from_cbor(v.to_cbor()));
+    EXPECT_TRUE(is_equal(v, restored));
+    EXPECT_EQ_INT(Status::PARSE_OK, restored.from_tape(v.to_tape()));
+    EXPECT_TRUE(is_equal(v, restored));
+
+    LeptJSON lazy("[1,2]");
+    EXPECT_EQ_INT(Status::PARSE_OK, lazy.parse(ParseFlag::PARSE_LAZY_NUMBERS));
+    EXPECT_FALSE(lazy.is_number_array());
+
+    /* the parallel and the streaming parser pick the same storage as parse() */
+    std::string large = "[";
+    for (int i = 0; i < 200000; i++) {
+        if (i) large += ',';
+        large += std::to_string(i % 1000);
+    }
+    large += ']';
+    const auto streamed = [](LeptJSON& s, std::string_view text, std::size_t size) {
+        std::size_t offset = 0;
+        return s.parse_stream([&](std::string& block) {
+            block = text.substr(offset, size);
+            offset += block.size();
+            return Status::PARSE_OK;
+        });
+    };
+    for (const std::string& text : { large, std::string("[[1,2],[3,\"x\"],[],[4.5]]"), std::string("[1,\"x\"]") }) {
+        LeptJSON expect(text);
+        EXPECT_EQ_INT(Status::PARSE_OK, expect.parse());
+        LeptJSON parallel(text);
+        parallel.set_parallel_threshold(0);
+        EXPECT_EQ_INT(Status::PARSE_OK, parallel.parse(ParseFlag::PARSE_PARALLEL));
+        LeptJSON stream;
+        EXPECT_EQ_INT(Status::PARSE_OK, streamed(stream, text, text.size() < 64 ? 3 : 256));
+        for (const LeptJSON* actual : { &parallel, &stream }) {
+            EXPECT_TRUE(expect.is_number_array() == actual->is_number_array());
+            EXPECT_TRUE(is_equal(expect, *actual));
+            if (expect.is_number_array()) continue;
+            const auto& elements = std::as_const(expect).get_array();
+            for (std::size_t i = 0; i < elements.size(); i++) {
+                EXPECT_TRUE(is_number_array(elements[i]) == is_number_array(actual->get_array()[i]));
+            }
+        }
+    }
+    LeptJSON sequential(large);
+    EXPECT_EQ_INT(Status::PARSE_OK, sequential.parse());
+    EXPECT_TRUE(sequential.is_number_array());
+    LeptJSON big("[1,1e400]");
+    EXPECT_EQ_INT(Status::PARSE_NUMBER_TOO_BIG, big.parse());
+    LeptJSON bad("[1,2 3]");
+    EXPECT_EQ_INT(Status::PARSE_MISS_COMMA_OR_SQUARE_BRACKET, bad.parse());
+    LeptJSON invalid("[1,-]");
+    EXPECT_EQ_INT(Status::PARSE_INVALID_VALUE, invalid.parse());
+}
+
+static void test_build() {
+    LeptJSON v;
+    v.reserve(8);
+    EXPECT_EQ_INT(ValueType::ARRAY_TYPE, v.get_type());
+    EXPECT_TRUE(v.get_array().capacity() >= 8);
+    v.emplace_back(nullptr);
+    v.emplace_back(true);
+    v.emplace_back(1.5);
+    v.emplace_back(2);
+    v.emplace_back("abc");
+    std::string long_string(100, 'x');
+    const char* buffer = long_string.data();
+    v.emplace_back(std::move(long_string));
+    EXPECT_TRUE(get_string(v.get_array().back()).data() == buffer);
+
+    LeptJSON child;
+    child.insert_or_assign("k", std::string_view("v"));
+    child.emplace(std::string("n"), 1);
+    EXPECT_FALSE(child.emplace("n", 2).second);
+    EXPECT_FALSE(child.insert_or_assign("n", 3).second);
+    LeptJSON list;
+    list.push_back(child.get_value());
+    const auto* members = &child.get_object();
+    v.emplace_back(std::move(child));
+    EXPECT_EQ_INT(ValueType::NULL_TYPE, child.get_type());
+    EXPECT_TRUE(&get_object(v.get_array().back()) == members);
+    v.push_back(std::move(list).get_value());
+    EXPECT_EQ_STRING("[null,true,1.5,2,\"abc\",\"" + std::string(100, 'x') + "\",{\"k\":\"v\",\"n\":3},[{\"k\":\"v\",\"n\":3}]]",
+        v.stringify());
+
+    LeptJSON s;
+    std::string text(50, 'y');
+    buffer = text.data();
+    s.set_string(std::move(text));
+    EXPECT_TRUE(s.get_string().data() == buffer);
+    s.set_string(std::string_view("abcdef", 3));
+    EXPECT_EQ_STRING("abc", s.get_string());
+    s.set_json(std::string_view("[1,2]"));
+    EXPECT_EQ_INT(Status::PARSE_OK, s.parse());
+    EXPECT_EQ_SIZE_T(std::size_t{ 2 }, s.get_array().size());
+}
+
+static void test_binary() {
+    details::test_binary("null", "c0", "f6");
+    details::test_binary("false", "c2", "f4");
+    details::test_binary("true", "c3", "f5");
+    details::test_binary("0", "00", "00");
+    details::test_binary("23", "17", "17");
+    details::test_binary("24", "18", "1818");
+    details::test_binary("127", "7f", "187f");
+    details::test_binary("128", "cc80", "1880");
+    details::test_binary("1000", "cd03e8", "1903e8");
+    details::test_binary("1000000", "ce000f4240", "1a000f4240");
+    details::test_binary("1000000000000", "cf000000e8d4a51000", "1b000000e8d4a51000");
+    details::test_binary("-1", "ff", "20");
+    details::test_binary("-32", "e0", "381f");
+    details::test_binary("-33", "d0df", "3820");
+    details::test_binary("-100", "d09c", "3863");
+    details::test_binary("-129", "d1ff7f", "3880");
+    details::test_binary("-1000", "d1fc18", "3903e7");
+    details::test_binary("-100000", "d2fffe7960", "3a0001869f");
+    details::test_binary("-1e12", "d3ffffff172b5af000", "3b000000e8d4a50fff");
+    details::test_binary("-0", "ca80000000", "fa80000000");
+    details::test_binary("1.5", "ca3fc00000", "fa3fc00000");
+    details::test_binary("1.1", "cb3ff199999999999a", "fb3ff199999999999a");
+    details::test_binary("1e300", "cb7e37e43c8800759c", "fb7e37e43c8800759c");
+    details::test_binary("1.8446744073709552e19", "ca5f800000", "fa5f800000");
+    details::test_binary("\"\"", "a0", "60");
+    details::test_binary("\"a\\u0000b\"", "a3610062", "63610062");
+    details::test_binary("[]", "90", "80");
+    details::test_binary("{}", "80", "a0");
+    details::test_binary("[1,[2,3],[4,5]]", "9301920203920405", "8301820203820405");
+    details::test_binary("{\"a\":1,\"b\":[2,3]}", "82a16101a162920203", "a26161016162820203");
+
+    std::string json = "[\"" + std::string(40, 'x') + "\"";
+    for (int i = 1; i < 300; i++) json += "," + std::to_string(i);
+    json += "]";
+    LeptJSON v(json);
+    EXPECT_EQ_INT(Status::PARSE_OK, v.parse());
+    const auto msgpack = v.to_msgpack();
+    EXPECT_EQ_STRING("dc012cd928", details::to_hex(msgpack.substr(0, 5)));
+    const auto cbor = v.to_cbor();
+    EXPECT_EQ_STRING("99012c7828", details::to_hex(cbor.substr(0, 5)));
+    LeptJSON v2;
+    EXPECT_EQ_INT(Status::PARSE_OK, v2.from_msgpack(msgpack));
+    EXPECT_TRUE(is_equal(v, v2));
+    EXPECT_EQ_INT(Status::PARSE_OK, v2.from_cbor(cbor));
+    EXPECT_TRUE(is_equal(v, v2));
+
+    /* decode-only forms: RFC 8949 appendix A, and MessagePack widths the encoder never picks */
+    details::test_cbor("1", "f93c00");
+    details::test_cbor("65504", "f97bff");
+    details::test_cbor("5.960464477539063e-8", "f90001");
+    details::test_cbor("-4", "f9c400");
+    details::test_cbor("null", "f7");
+    details::test_cbor("\"2013-03-21T20:04:00Z\"", "c074323031332d30332d32315432303a30343a30305a");
+    details::test_cbor("\"streaming\"", "7f657374726561646d696e67ff");
+    details::test_cbor("[1,[2,3],[4,5]]", "9f018202039f0405ffff");
+    details::test_cbor("{\"Fun\":true,\"Amt\":-2}", "bf6346756ef563416d7421ff");
+    details::test_cbor("{\"a\":2}", "a2616101616102");
+    LeptJSON m;
+    EXPECT_EQ_INT(Status::PARSE_OK, m.from_msgpack(details::from_hex("dd00000002d90161dc0000")));
+    EXPECT_EQ_STRING("[\"a\",[]]", m.stringify());
+
+    details::test_binary_error(Status::PARSE_EXPECT_VALUE, "", "");
+    details::test_binary_error(Status::PARSE_ROOT_NOT_SINGULAR, "c0c0", "f6f6");
+    details::test_binary_error(Status::PARSE_INVALID_BINARY, "cd01", "1901");
+    details::test_binary_error(Status::PARSE_INVALID_BINARY, "a36162", "636162");
+    details::test_binary_error(Status::PARSE_INVALID_BINARY, "930102", "830102");
+    details::test_binary_error(Status::PARSE_INVALID_BINARY, "810102", "a10102");
+    details::test_binary_error(Status::PARSE_INVALID_BINARY, "c1", "ff");
+    details::test_binary_error(Status::PARSE_INVALID_BINARY, "c40161", "4161");
+    details::test_binary_error(Status::PARSE_INVALID_BINARY, "d40100", "f0");
+    details::test_binary_error(Status::PARSE_INVALID_BINARY, "dd7fffffff", "9b7fffffffffffffff");
+    details::test_binary_error(Status::PARSE_INVALID_BINARY, nullptr, "7f6161");
+    details::test_binary_error(Status::PARSE_INVALID_BINARY, nullptr, "7f01ff");
+    details::test_binary_error(Status::PARSE_INVALID_BINARY, nullptr, "1c");
+}
+
+static void test_tape() {
+    LeptJSON v("{\"n\":null,\"f\":false,\"t\":true,\"i\":123,\"d\":-0.5,\"s\":\"abc\",\"e\":\"\","
+        "\"a\":[1,\"abc\",[],{},[[2]]],\"o\":{\"abc\":\"abc\",\"x\":{\"y\":\"z\"}}}");
+    EXPECT_EQ_INT(Status::PARSE_OK, v.parse());
+    const std::string tape = v.to_tape();
+    EXPECT_EQ_STRING("LEPTTAPE", tape.substr(0, 8));
+    /* "abc" is stored once although it appears three times */
+    EXPECT_EQ_SIZE_T(15, static_cast<unsigned char>(tape[24]));
+
+    const char* path = "leptjson_test.tape";
+    FILE* fp = fopen(path, "wb");
+    EXPECT_TRUE(fp != nullptr);
+    if (fp) {
+        fwrite(tape.data(), 1, tape.size(), fp);
+        fclose(fp);
+    }
+    {
+        LeptJSON::MappedFile file(path);
+        EXPECT_TRUE(file.is_open());
+        EXPECT_EQ_SIZE_T(tape.size(), file.bytes().size());
+        LeptJSON::TapeView root;
+        EXPECT_EQ_INT(Status::PARSE_OK, LeptJSON::TapeView::load(file.bytes(), root));
+        EXPECT_EQ_INT(ValueType::OBJECT_TYPE, root.get_type());
+        EXPECT_EQ_SIZE_T(9, root.get_object().size());
+        std::string keys;
+        for (auto [key, value] : root.get_object()) keys += key;
+        EXPECT_EQ_STRING("adefinost", keys);
+        EXPECT_EQ_INT(ValueType::NULL_TYPE, root.find("n")->get_type());
+        EXPECT_FALSE(root.find("f")->get_boolean());
+        EXPECT_TRUE(root.find("t")->get_boolean());
+        EXPECT_EQ_DOUBLE(123.0, root.find("i")->get_number());
+        EXPECT_EQ_DOUBLE(-0.5, root.find("d")->get_number());
+        EXPECT_EQ_STRING("abc", root.find("s")->get_string());
+        EXPECT_EQ_SIZE_T(0, root.find("e")->get_string().size());
+        EXPECT_FALSE(root.find("missing").has_value());
+
+        auto a = root.find("a")->get_array();
+        EXPECT_EQ_SIZE_T(5, a.size());
+        EXPECT_EQ_DOUBLE(1.0, a[0].get_number());
+        EXPECT_TRUE(a[1].get_string().data() == root.find("s")->get_string().data());
+        EXPECT_TRUE(a[2].get_array().empty());
+        EXPECT_TRUE(a[3].get_object().empty());
+        EXPECT_EQ_DOUBLE(2.0, a[4].get_array()[0].get_array()[0].get_number());
+        std::size_t count = 0;
+        for (auto element : a) count += element.get_type() == ValueType::ARRAY_TYPE;
+        EXPECT_EQ_SIZE_T(2, count);
+        EXPECT_EQ_STRING("z", root.find("o")->find("x")->find("y")->get_string());
+
+        LeptJSON v2;
+        EXPECT_EQ_INT(Status::PARSE_OK, v2.from_tape(file.bytes()));
+        EXPECT_TRUE(is_equal(v, v2));
+    }
+    remove(path);
+
+    LeptJSON scalar("\"x\"");
+    EXPECT_EQ_INT(Status::PARSE_OK, scalar.parse());
+    const std::string scalar_tape = scalar.to_tape();
+    LeptJSON::TapeView view;
+    EXPECT_EQ_INT(Status::PARSE_OK, LeptJSON::TapeView::load(scalar_tape, view));
+    EXPECT_EQ_STRING("x", view.get_string());
+
+    LeptJSON bad;
+    bad.set_boolean(true);
+    EXPECT_EQ_INT(Status::PARSE_INVALID_TAPE, bad.from_tape(""));
+    EXPECT_EQ_INT(ValueType::NULL_TYPE, bad.get_type());
+    EXPECT_EQ_INT(Status::PARSE_INVALID_TAPE, bad.from_tape(tape.substr(0, tape.size() - 1)));
+    std::string corrupt = tape;
+    corrupt[0] = 'X';
+    EXPECT_EQ_INT(Status::PARSE_INVALID_TAPE, bad.from_tape(corrupt));
+    corrupt = tape;
+    corrupt[8] = 2;
+    EXPECT_EQ_INT(Status::PARSE_INVALID_TAPE, bad.from_tape(corrupt));
+    corrupt = tape;
+    corrupt[32] = 0;
+    EXPECT_EQ_INT(Status::PARSE_INVALID_TAPE, bad.from_tape(corrupt));
+
+    /* a flipped bit in any node is rejected or leaves a tape that still reads within its bounds */
+    const std::size_t nodes = static_cast<unsigned char>(tape[16]);
+    std::size_t rejected = 0, read = 0;
+    for (std::size_t bit = 32 * 8; bit < (32 + nodes * 8) * 8; bit++) {
+        corrupt = tape;
+        corrupt[bit / 8] = static_cast<char>(corrupt[bit / 8] ^ (1 << bit % 8));
+        LeptJSON flipped;
+        if (flipped.from_tape(corrupt) == Status::PARSE_INVALID_TAPE) rejected++;
+        else read += !flipped.stringify().empty();
+    }
+    EXPECT_EQ_SIZE_T(nodes * 64, rejected + read);
+    EXPECT_TRUE(rejected > 0 && read > 0);
+}
+
+static void test_freeze() {
+    LeptJSON v("{\"name\":\"svc\",\"ports\":[80,443],\"limits\":{\"rps\":1.5}}");
+    EXPECT_EQ_INT(Status::PARSE_OK, v.parse());
+    const auto frozen = v.freeze();
+    v.insert_or_assign("name", std::string_view("changed"));
+    const auto root = frozen->root();
+    EXPECT_EQ_STRING("svc", root.find("name")->get_string());
+    EXPECT_EQ_DOUBLE(443.0, root.find("ports")->get_array()[1].get_number());
+    EXPECT_EQ_DOUBLE(1.5, root.find("limits")->find("rps")->get_number());
+    EXPECT_EQ_SIZE_T(0, frozen->size_bytes() % 8);
+    LeptJSON thawed;
+    thawed.from_tape(root);
+    EXPECT_EQ_STRING(std::string("{\"limits\":{\"rps\":1.5},\"name\":\"svc\",\"ports\":[80,443]}"), thawed.stringify());
+
+    /* readers always see one whole version while a writer keeps publishing new ones */
+    auto version = [](int n) {
+        LeptJSON doc;
+        doc.insert_or_assign("version", n);
+        doc.insert_or_assign("twice", 2 * n);
+        return doc.freeze();
+    };
+    LeptJSON::FrozenSlot slot(version(0));
+    std::atomic<bool> done{ false };
+    std::atomic<int> torn{ 0 };
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; i++) {
+        readers.emplace_back([&] {
+            while (!done.load()) {
+                const auto snapshot = slot.load();
+                const auto r = snapshot->root();
+                if (r.find("twice")->get_number() != 2 * r.find("version")->get_number()) ++torn;
+            }
+        });
+    }
+    for (int n = 1; n <= 200; n++) slot.store(version(n));
+    done = true;
+    for (auto& t : readers) t.join();
+    EXPECT_EQ_INT(0, torn.load());
+    EXPECT_EQ_DOUBLE(200.0, slot.load()->root().find("version")->get_number());
+}
+
+static void test_reader() {
+    using Token = LeptJSON::Reader::Token;
+    const std::string_view text = " {\"id\": 7, \"tags\": [\"a\\\"]b\", {\"x\": \"}\"}], \"name\" : \"plain\", \"ok\": true, \"e\": []} ";
+    LeptJSON::Reader r(text);
+    EXPECT_EQ_INT(Token::BEGIN_OBJECT, r.peek_type());
+    EXPECT_EQ_INT(Token::BEGIN_OBJECT, r.peek_type());
+    EXPECT_EQ_INT(Token::BEGIN_OBJECT, r.next());
+    EXPECT_EQ_SIZE_T(1, r.get_depth());
+    std::string_view key;
+    EXPECT_EQ_INT(Status::PARSE_OK, r.read_string(key));
+    EXPECT_EQ_STRING("id", key);
+    EXPECT_TRUE(key.data() > text.data() && key.data() < text.data() + text.size());
+    double d = 0;
+    EXPECT_EQ_INT(Status::PARSE_TYPE_MISMATCH, r.read_string(key));
+    EXPECT_EQ_INT(Status::PARSE_OK, r.read_number(d));
+    EXPECT_EQ_DOUBLE(7.0, d);
+    EXPECT_EQ_INT(Token::KEY, r.next());
+    EXPECT_EQ_INT(Token::BEGIN_ARRAY, r.next());
+    std::string own;
+    EXPECT_EQ_INT(Status::PARSE_OK, r.read_string(own));
+    EXPECT_EQ_STRING("a\"]b", own);
+    /* the bracket inside the string does not end the skipped object */
+    EXPECT_EQ_INT(Status::PARSE_OK, r.skip_value());
+    EXPECT_EQ_INT(Token::END_ARRAY, r.next());
+    /* skipping at a key drops the whole member */
+    EXPECT_EQ_INT(Status::PARSE_OK, r.skip_value());
+    EXPECT_EQ_INT(Token::KEY, r.peek_type());
+    EXPECT_EQ_INT(Status::PARSE_OK, r.skip_value());
+    EXPECT_EQ_INT(Token::KEY, r.next());
+    EXPECT_EQ_INT(Token::BEGIN_ARRAY, r.next());
+    EXPECT_EQ_INT(Token::END_ARRAY, r.next());
+    EXPECT_EQ_INT(Token::END_OBJECT, r.next());
+    EXPECT_EQ_SIZE_T(0, r.get_depth());
+    EXPECT_EQ_INT(Token::END_DOCUMENT, r.next());
+    EXPECT_EQ_INT(Status::PARSE_OK, r.status());
+
+    LeptJSON::Reader skipped("[[1,[2]],\"\\\\\",{}]");
+    EXPECT_EQ_INT(Token::BEGIN_ARRAY, skipped.next());
+    EXPECT_EQ_INT(Status::PARSE_OK, skipped.skip_value());
+    EXPECT_EQ_INT(Status::PARSE_OK, skipped.skip_value());
+    EXPECT_EQ_INT(Token::BEGIN_OBJECT, skipped.next());
+    EXPECT_EQ_INT(Token::END_OBJECT, skipped.next());
+    EXPECT_EQ_INT(Status::PARSE_EXPECT_VALUE, skipped.skip_value());
+    EXPECT_EQ_INT(Token::END_ARRAY, skipped.next());
+    EXPECT_EQ_INT(Token::END_DOCUMENT, skipped.next());
+
+    auto error = [](std::string_view json) {
+        LeptJSON::Reader reader(json);
+        while (true) {
+            const auto token = reader.next();
+            if (token == Token::ERROR || token == Token::END_DOCUMENT) break;
+        }
+        return reader.status();
+    };
+    EXPECT_EQ_INT(Status::PARSE_OK, error("[1,{\"a\":[null,false]}]"));
+    EXPECT_EQ_INT(Status::PARSE_EXPECT_VALUE, error(""));
+    EXPECT_EQ_INT(Status::PARSE_INVALID_VALUE, error("[1,]"));
+    EXPECT_EQ_INT(Status::PARSE_MISS_COMMA_OR_SQUARE_BRACKET, error("[1 2]"));
+    EXPECT_EQ_INT(Status::PARSE_MISS_COMMA_OR_CURLY_BRACKET, error("{\"a\":1]"));
+    EXPECT_EQ_INT(Status::PARSE_MISS_KEY, error("{1:2}"));
+    EXPECT_EQ_INT(Status::PARSE_MISS_COLON, error("{\"a\" 2}"));
+    EXPECT_EQ_INT(Status::PARSE_INVALID_VALUE, error("[-]"));
+    EXPECT_EQ_INT(Status::PARSE_INVALID_VALUE, error("nul"));
+    EXPECT_EQ_INT(Status::PARSE_INVALID_STRING_ESCAPE, error("\"\\x\""));
+    EXPECT_EQ_INT(Status::PARSE_ROOT_NOT_SINGULAR, error("1 2"));
+    EXPECT_EQ_INT(Status::PARSE_DEPTH_EXCEEDED, error(std::string(LeptJSON::Reader::max_depth + 1, '[')));
+    LeptJSON::Reader open("[[1,\"]\"]");
+    EXPECT_EQ_INT(Token::BEGIN_ARRAY, open.next());
+    EXPECT_EQ_INT(Status::PARSE_OK, open.skip_value());
+    EXPECT_EQ_INT(Status::PARSE_MISS_COMMA_OR_SQUARE_BRACKET, open.skip_value());
+    EXPECT_EQ_INT(Token::ERROR, open.next());
+    LeptJSON::Reader big("1e400");
+    EXPECT_EQ_INT(Status::PARSE_NUMBER_TOO_BIG, big.read_number(d));
+}
+
+static void test_stream() {
+    /* every block size gives the tree and the status of a plain parse() */
+    auto streamed = [](LeptJSON& v, std::string_view text, std::size_t size) {
+        std::size_t offset = 0;
+        return v.parse_stream([&](std::string& block) {
+            block = text.substr(offset, size);
+            offset += block.size();
+            return Status::PARSE_OK;
+        });
+    };
+    const char* documents[] = {
+        " [1, \"a,]\\\"\", {\"k\": [2, {}]}, [], null] ", "{\"a\": {\"b\": \"}\"}, \"c\": [true]}", "[]", " { } ", "\"x\"", "12",
+        "[1,]", "[1 2]", "[1}", "[[1}]", "[1]]", "[1] x", "[", "{\"a\":1,}", "{\"a\" 1}", "{1:2}", "", "  ", "[\"\\x\"]", "[1,2] \t",
+    };
+    for (const char* document : documents) {
+        LeptJSON expect(document);
+        const auto status = expect.parse();
+        for (std::size_t size : { 1, 2, 3, 7, 64 }) {
+            LeptJSON v;
+            EXPECT_EQ_INT(status, streamed(v, document, size));
+            EXPECT_TRUE(is_equal(expect, v));
+        }
+    }
+
+    /* a failing source aborts with its status and stops being called */
+    LeptJSON v;
+    int calls = 0;
+    EXPECT_EQ_INT(Status::PARSE_INVALID_COMPRESSED, v.parse_stream([&](std::string& block) {
+        block = "[1,";
+        return ++calls > 2 ? Status::PARSE_INVALID_COMPRESSED : Status::PARSE_OK;
+    }));
+    EXPECT_EQ_INT(3, calls);
+    EXPECT_EQ_INT(ValueType::NULL_TYPE, v.get_type());
+
+    /* a parse error closes the queue while the source still has more */
+    EXPECT_EQ_INT(Status::PARSE_INVALID_VALUE, v.parse_stream([](std::string& block) {
+        block = "[x,";
+        return Status::PARSE_OK;
+    }));
+
+#if defined(LEPTJSON_WITH_ZLIB) || defined(LEPTJSON_WITH_ZSTD)
+    std::string text = "[";
+    for (int i = 0; i < 20000; i++) text += "{\"id\":" + std::to_string(i) + ",\"name\":\"item\"},";
+    text += "{}]";
+    LeptJSON expect(text);
+    EXPECT_EQ_INT(Status::PARSE_OK, expect.parse());
+    const char* path = "leptjson_test.compressed";
+#endif
+#ifdef LEPTJSON_WITH_ZLIB
+    gzFile gz = gzopen(path, "wb");
+    gzwrite(gz, text.data(), static_cast<unsigned>(text.size()));
+    gzclose(gz);
+    EXPECT_EQ_INT(Status::PARSE_OK, v.parse_gzip(path));
+    EXPECT_TRUE(is_equal(expect, v));
+    gz = gzopen(path, "wb");
+    gzwrite(gz, text.data(), static_cast<unsigned>(text.size() / 2));
+    gzclose(gz);
+    if (FILE* fp = fopen(path, "r+b")) {
+        fseek(fp, -8, SEEK_END);
+        fwrite("corrupt!", 1, 8, fp);
+        fclose(fp);
+    }
+    EXPECT_EQ_INT(Status::PARSE_INVALID_COMPRESSED, v.parse_gzip(path));
+#endif
+#ifdef LEPTJSON_WITH_ZSTD
+    std::string frame(ZSTD_compressBound(text.size()), '\0');
+    frame.resize(ZSTD_compress(frame.data(), frame.size(), text.data(), text.size(), 3));
+    for (std::size_t size : { frame.size(), frame.size() - 4 }) {
+        if (FILE* fp = fopen(path, "wb")) {
+            fwrite(frame.data(), 1, size, fp);
+            fclose(fp);
+        }
+        EXPECT_EQ_INT(size == frame.size() ? Status::PARSE_OK : Status::PARSE_INVALID_COMPRESSED, v.parse_zstd(path));
+        EXPECT_EQ_INT(size == frame.size() ? ValueType::ARRAY_TYPE : ValueType::NULL_TYPE, v.get_type());
+    }
+    remove(path);
+    EXPECT_EQ_INT(Status::PARSE_INVALID_COMPRESSED, v.parse_zstd(path));
+#endif
+#ifdef LEPTJSON_WITH_ZLIB
+    remove(path);
+    EXPECT_EQ_INT(Status::PARSE_INVALID_COMPRESSED, v.parse_gzip(path));
+#endif
+}
+
+static void test_bind() {
+    LeptJSON v(" { \"unknown\" : {\"a\":[1,\"\\u00e9\",{\"b\":null}],\"c\":true} , \"sides\":3, \"name\":\"tri\\nangle\","
+        "\"filled\":true,\"points\":[{\"y\":0,\"x\":0,\"z\":9},{\"x\":1,\"y\":0.5}],\"center\":null,"
+        "\"tags\":{\"b\":-2,\"a\":1},\"extra\":[1,\"x\"]} ");
+    details::Shape shape;
+    shape.label = "stale";
+    EXPECT_EQ_INT(Status::PARSE_OK, v.parse_into(shape));
+    EXPECT_EQ_STRING("tri\nangle", shape.name);
+    EXPECT_EQ_INT(3, shape.sides);
+    EXPECT_TRUE(shape.filled);
+    EXPECT_EQ_SIZE_T(2, shape.points.size());
+    EXPECT_EQ_DOUBLE(1.0, shape.points[1].x);
+    EXPECT_EQ_DOUBLE(0.5, shape.points[1].y);
+    EXPECT_FALSE(shape.label.has_value());
+    EXPECT_FALSE(shape.center.has_value());
+    EXPECT_EQ_SIZE_T(2, shape.tags.size());
+    EXPECT_TRUE(shape.tags["b"] == -2);
+    EXPECT_EQ_INT(ValueType::ARRAY_TYPE, shape.extra.get_type());
+    EXPECT_EQ_SIZE_T(2, shape.extra.get_array().size());
+
+    const std::string json = LeptJSON::stringify_from(shape);
+    EXPECT_EQ_STRING("{\"name\":\"tri\\nangle\",\"sides\":3,\"filled\":true,\"points\":[{\"x\":0,\"y\":0},{\"x\":1,\"y\":0.5}],"
+        "\"tags\":{\"a\":1,\"b\":-2},\"extra\":[1,\"x\"]}", json);
+    shape.label = "L";
+    shape.center = details::Point{ 2, 3 };
+    const std::string json2 = LeptJSON::stringify_from(shape);
+    details::Shape shape2;
+    LeptJSON v2(json2);
+    EXPECT_EQ_INT(Status::PARSE_OK, v2.parse_into(shape2));
+    EXPECT_EQ_STRING(json2, LeptJSON::stringify_from(shape2));
+    EXPECT_EQ_STRING("L", *shape2.label);
+    EXPECT_EQ_DOUBLE(3.0, shape2.center->y);
+
+    std::vector<int> numbers;
+    LeptJSON v3("[1, -2, 30]");
+    EXPECT_EQ_INT(Status::PARSE_OK, v3.parse_into(numbers));
+    EXPECT_EQ_SIZE_T(3, numbers.size());
+    EXPECT_EQ_INT(-2, numbers[1]);
+    EXPECT_EQ_STRING("[1,-2,30]", LeptJSON::stringify_from(numbers));
+
+    /* integers convert from their digits rather than through a double, floats reject values out of range */
+    std::vector<std::int64_t> wide;
+    LeptJSON v5("[9007199254740993,9223372036854775807,-9223372036854775808,1e3,-0]");
+    EXPECT_EQ_INT(Status::PARSE_OK, v5.parse_into(wide));
+    EXPECT_EQ_SIZE_T(5, wide.size());
+    EXPECT_TRUE(wide[0] == 9007199254740993);
+    EXPECT_TRUE(wide[1] == std::numeric_limits<std::int64_t>::max());
+    EXPECT_TRUE(wide[2] == std::numeric_limits<std::int64_t>::min());
+    EXPECT_TRUE(wide[3] == 1000 && wide[4] == 0);
+    std::vector<std::uint64_t> unsigned_numbers;
+    LeptJSON v6("[18446744073709551615,-0]");
+    EXPECT_EQ_INT(Status::PARSE_OK, v6.parse_into(unsigned_numbers));
+    EXPECT_TRUE(unsigned_numbers[0] == std::numeric_limits<std::uint64_t>::max() && unsigned_numbers[1] == 0);
+    for (const char* json : { "[18446744073709551616]", "[-1]" }) {
+        LeptJSON bad(json);
+        EXPECT_EQ_INT(Status::PARSE_TYPE_MISMATCH, bad.parse_into(unsigned_numbers));
+    }
+    std::vector<float> floats;
+    LeptJSON v7("[1.5,-3e38]");
+    EXPECT_EQ_INT(Status::PARSE_OK, v7.parse_into(floats));
+    EXPECT_EQ_DOUBLE(1.5, static_cast<double>(floats[0]));
+    LeptJSON v8("[1e300]");
+    EXPECT_EQ_INT(Status::PARSE_TYPE_MISMATCH, v8.parse_into(floats));
+    std::map<std::string, std::vector<std::optional<bool>>> flags;
+    LeptJSON v4("{\"a\":[true,null,false],\"b\":[]}");
+    EXPECT_EQ_INT(Status::PARSE_OK, v4.parse_into(flags));
+    EXPECT_FALSE(flags["a"][1].has_value());
+    EXPECT_EQ_STRING("{\"a\":[true,null,false],\"b\":[]}", LeptJSON::stringify_from(flags));
+
+    const char* base = "\"name\":\"n\",\"filled\":false,\"points\":[],\"tags\":{},\"extra\":null";
+    details::test_bind_error(Status::PARSE_MISSING_FIELD, (std::string("{") + base + "}").c_str());
+    details::test_bind_error(Status::PARSE_TYPE_MISMATCH, (std::string("{") + base + ",\"sides\":\"3\"}").c_str());
+    details::test_bind_error(Status::PARSE_TYPE_MISMATCH, (std::string("{") + base + ",\"sides\":1.5}").c_str());
+    details::test_bind_error(Status::PARSE_TYPE_MISMATCH, (std::string("{") + base + ",\"sides\":1e10}").c_str());
+    details::test_bind_error(Status::PARSE_TYPE_MISMATCH, (std::string("{") + base + ",\"sides\":[3]}").c_str());
+    details::test_bind_error(Status::PARSE_TYPE_MISMATCH, "[]");
+    details::test_bind_error(Status::PARSE_INVALID_VALUE, (std::string("{") + base + ",\"sides\":tru}").c_str());
+    details::test_bind_error(Status::PARSE_INVALID_VALUE, (std::string("{") + base + ",\"sides\":1,\"zz\":[1,]}").c_str());
+    details::test_bind_error(Status::PARSE_MISS_COLON, "{\"sides\" 1}");
+    details::test_bind_error(Status::PARSE_MISS_COMMA_OR_CURLY_BRACKET, (std::string("{") + base + ",\"sides\":1").c_str());
+    details::test_bind_error(Status::PARSE_ROOT_NOT_SINGULAR, (std::string("{") + base + ",\"sides\":1} x").c_str());
+    details::test_bind_error(Status::PARSE_EXPECT_VALUE, " ");
+}
+
+static void test_embed() {
+    constexpr auto root = LeptJSON::embed<" {\"n\":null, \"b\":[true,false], \"pi\":3.14159, \"s\":\"caf\\u00e9 \\ud834\\udd1e\\n\","
+        " \"o\":{\"z\":[],\"a\":{}}, \"k\":0.1} ">();
+    static_assert(root.get_type() == ValueType::OBJECT_TYPE);
+    static_assert(root.get_object().size() == 6);
+    static_assert(root.find("n")->get_type() == ValueType::NULL_TYPE);
+    static_assert(root.find("b")->get_array()[0].get_boolean());
+    static_assert(!root.find("b")->get_array()[1].get_boolean());
+    static_assert(root.find("pi")->get_number() == 3.14159);
+    static_assert(root.find("k")->get_number() == 0.1);
+    static_assert(root.find("s")->get_string() == "caf\xC3\xA9 \xF0\x9D\x84\x9E\n");
+    static_assert((*root.find("o")->get_object().begin()).first == "z");
+    static_assert(!root.find("missing"));
+
+    const char* json = "[0, -0, 0.1, 1e22, 1e23, 9007199254740993, 12345678901234567890123, 2.2250738585072014e-308,"
+        " 1.7976931348623157e308, 5e-324, -12.5e-3, 0e5, 123.456e-7, 1E+2, 0.30000000000000004, 1e-400]";
+    constexpr auto numbers = LeptJSON::embed<"[0, -0, 0.1, 1e22, 1e23, 9007199254740993, 12345678901234567890123, 2.2250738585072014e-308,"
+        " 1.7976931348623157e308, 5e-324, -12.5e-3, 0e5, 123.456e-7, 1E+2, 0.30000000000000004, 1e-400]">();
+    LeptJSON expect(json);
+    EXPECT_EQ_INT(Status::PARSE_OK, expect.parse());
+    std::size_t i = 0;
+    bool same = true;
+    for (auto number : numbers.get_array()) {
+        const double lhs = get_number(expect.get_array()[i++]), rhs = number.get_number();
+        same = same && lhs == rhs && std::signbit(lhs) == std::signbit(rhs);
+    }
+    EXPECT_TRUE(same);
+    EXPECT_EQ_SIZE_T(expect.get_array().size(), i);
+
+    LeptJSON v;
+    v.from_tape(root);
+    LeptJSON v2("{\"o\":{\"a\":{},\"z\":[]},\"s\":\"caf\\u00e9 \\ud834\\udd1e\\n\",\"pi\":3.14159,\"n\":null,\"k\":0.1,\"b\":[true,false]}");
+    EXPECT_EQ_INT(Status::PARSE_OK, v2.parse());
+    EXPECT_TRUE(is_equal(v, v2));
+    /* a repeated key reads as its last value, in the tape as in the tree */
+    constexpr auto repeated = LeptJSON::embed<"{\"a\":1,\"b\":2,\"a\":3}">();
+    static_assert(repeated.find("a")->get_number() == 3);
+    LeptJSON thawed;
+    thawed.from_tape(repeated);
+    EXPECT_EQ_STRING("{\"a\":3,\"b\":2}", thawed.stringify());
+
+    EXPECT_EQ_STRING("\"x\"", [] {
+        LeptJSON scalar;
+        scalar.from_tape(LeptJSON::embed<"\"x\"">());
+        return scalar.stringify();
+    }());
+}
+
+#ifdef LEPTJSON_ENABLE_STATS
+static void test_stats() {
+    LeptJSON v("{\"a\":[1,2,{\"b\":null}],\"s\":\"a string longer than the small buffer\",\"t\":true}");
+    EXPECT_EQ_INT(Status::PARSE_OK, v.parse());
+    auto&& stats = v.get_stats();
+    EXPECT_EQ_SIZE_T(std::size_t{ 75 }, stats.bytes);
+    EXPECT_EQ_SIZE_T(std::size_t{ 1 }, stats.nodes[static_cast<std::size_t>(ValueType::NULL_TYPE)]);
+    EXPECT_EQ_SIZE_T(std::size_t{ 1 }, stats.nodes[static_cast<std::size_t>(ValueType::TRUE_TYPE)]);
+    EXPECT_EQ_SIZE_T(std::size_t{ 2 }, stats.nodes[static_cast<std::size_t>(ValueType::NUMBER_TYPE)]);
+    EXPECT_EQ_SIZE_T(std::size_t{ 1 }, stats.nodes[static_cast<std::size_t>(ValueType::STRING_TYPE)]);
+    EXPECT_EQ_SIZE_T(std::size_t{ 1 }, stats.nodes[static_cast<std::size_t>(ValueType::ARRAY_TYPE)]);
+    EXPECT_EQ_SIZE_T(std::size_t{ 2 }, stats.nodes[static_cast<std::size_t>(ValueType::OBJECT_TYPE)]);
+    EXPECT_EQ_SIZE_T(std::size_t{ 3 }, stats.max_depth);
+    /* the array and both objects fit in their inline buffers, which leaves the long string */
+    if (LEPTJSON_SMALL_CAPACITY >= 3) EXPECT_EQ_SIZE_T(std::size_t{ 1 }, stats.allocations);
+    else EXPECT_TRUE(stats.allocations > 1);
+    EXPECT_TRUE(stats.allocated_bytes > 0);
+
+    std::string json = v.stringify();
+    EXPECT_EQ_SIZE_T(json.size(), v.get_stats().bytes);
+    EXPECT_EQ_SIZE_T(std::size_t{ 3 }, v.get_stats().max_depth);
+    EXPECT_EQ_SIZE_T(std::size_t{ 2 }, v.get_stats().nodes[static_cast<std::size_t>(ValueType::NUMBER_TYPE)]);
+    EXPECT_TRUE(v.get_stats().allocations >= 1);
+}
+#endif
+
 int main() {
 #ifdef _WINDOWS
     _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
@@ -599,6 +2027,25 @@ int main() {
     test_copy();
     test_move();
     test_swap();
+    test_copy_on_write();
+    test_hash();
+    test_patch();
+    test_projection();
+    test_query();
+    test_schema();
+    test_lazy_number();
+    test_number_array();
+    test_build();
+    test_binary();
+    test_tape();
+    test_freeze();
+    test_reader();
+    test_stream();
+    test_bind();
+    test_embed();
+#ifdef LEPTJSON_ENABLE_STATS
+    test_stats();
+#endif
     printf("%d/%d (%3.2f%%) passed\n", test_pass, test_count, test_pass * 100.0 / test_count);
     return main_ret;
 }
\ No newline at end of file